@@ -0,0 +1,98 @@
+/*
+ * Startup code and output helpers shared by every benchmark image.
+ */
+#include "bench.h"
+
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+extern int main(void);
+
+void Reset_Handler(void);
+
+static void Default_Handler(void)
+{
+    bench_puts("unexpected exception\n");
+    bench_exit(2);
+}
+
+void __attribute__((weak)) bench_irq_handler(void)
+{
+    Default_Handler();
+}
+
+void NMI_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void HardFault_Handler(void) __attribute__((weak, alias("Default_Handler")));
+
+#define NUM_IRQ     96
+
+typedef void (*vector_t)(void);
+
+__attribute__((section(".vectors"), used))
+const vector_t bench_vectors[16 + NUM_IRQ] = {
+    (vector_t)&_estack,
+    Reset_Handler,
+    NMI_Handler,
+    HardFault_Handler,
+    Default_Handler,            /* MemManage */
+    Default_Handler,            /* BusFault */
+    Default_Handler,            /* UsageFault */
+    Default_Handler,            /* SecureFault */
+    0, 0, 0,
+    Default_Handler,            /* SVCall */
+    Default_Handler,            /* DebugMon */
+    0,
+    Default_Handler,            /* PendSV */
+    Default_Handler,            /* SysTick */
+    [16 ... 16 + NUM_IRQ - 1] = bench_irq_handler,
+};
+
+void Reset_Handler(void)
+{
+    uint32_t *src = &_sidata, *dst = &_sdata;
+
+    while (dst < &_edata) {
+        *dst++ = *src++;
+    }
+    for (dst = &_sbss; dst < &_ebss; dst++) {
+        *dst = 0;
+    }
+    bench_board_init();
+    bench_exit(main());
+}
+
+uint32_t bench_param(uint32_t dflt)
+{
+    uint32_t v = REG32(BENCH_PARAM_ADDR);
+
+    return v ? v : dflt;
+}
+
+void bench_puts(const char *s)
+{
+    while (*s) {
+        bench_putc(*s++);
+    }
+}
+
+void bench_put_u64(uint64_t v)
+{
+    char buf[21];
+    int i = sizeof(buf) - 1;
+
+    buf[i] = 0;
+    do {
+        buf[--i] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    bench_puts(&buf[i]);
+}
+
+void bench_result(const char *name, uint64_t value, const char *unit)
+{
+    bench_puts("RESULT ");
+    bench_puts(name);
+    bench_putc(' ');
+    bench_put_u64(value);
+    bench_putc(' ');
+    bench_puts(unit);
+    bench_putc('\n');
+}
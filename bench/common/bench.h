@@ -0,0 +1,42 @@
+/*
+ * Shared helpers for the bare-metal benchmark firmware.
+ *
+ * Results are printed as "RESULT <name> <value> <unit>" lines on the
+ * board's first UART so bench/run.py can collect them, and a run ends
+ * through the board's test status register with the given exit code.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#define REG32(addr)     (*(volatile uint32_t *)(uintptr_t)(addr))
+
+#define TEST_STATUS_MAGIC   0x7E57
+
+/* Provided by the board file */
+void bench_board_init(void);
+void bench_putc(char c);
+void bench_exit(int code) __attribute__((noreturn));
+
+/* Word written by -device loader at BENCH_PARAM_ADDR, see the Makefile */
+uint32_t bench_param(uint32_t dflt);
+
+void bench_puts(const char *s);
+void bench_put_u64(uint64_t v);
+void bench_result(const char *name, uint64_t value, const char *unit);
+
+static inline void bench_irq_enable(int irq)
+{
+    REG32(0xE000E100 + (irq / 32) * 4) = 1u << (irq % 32);
+}
+
+static inline void bench_irq_disable(int irq)
+{
+    REG32(0xE000E180 + (irq / 32) * 4) = 1u << (irq % 32);
+}
+
+/* Overridden by benchmarks that take interrupts, IPSR says which */
+void bench_irq_handler(void);
+
+#endif
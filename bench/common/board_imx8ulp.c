@@ -0,0 +1,39 @@
+/*
+ * imx8ulp-m33: output on LPUART0, exit through the verilog_debug
+ * VERILOG_EXIT command.
+ */
+#include "bench.h"
+
+#define LPUART0_BASE        0x38032000
+#define LPUART_STAT         (LPUART0_BASE + 0x14)
+#define LPUART_CTRL         (LPUART0_BASE + 0x18)
+#define LPUART_DATA         (LPUART0_BASE + 0x1C)
+#define LPUART_STAT_TDRE    (1 << 23)
+#define LPUART_CTRL_TE      (1 << 19)
+
+#define VERILOG_DEBUG       0x3004EFF0
+#define VERILOG_EXIT        0x46
+
+void bench_board_init(void)
+{
+    REG32(LPUART_CTRL) = LPUART_CTRL_TE;
+}
+
+void bench_putc(char c)
+{
+    while (!(REG32(LPUART_STAT) & LPUART_STAT_TDRE)) {
+    }
+    REG32(LPUART_DATA) = c;
+}
+
+void bench_exit(int code)
+{
+    /* Let the UART drain before the process goes away */
+    while (!(REG32(LPUART_STAT) & LPUART_STAT_TDRE)) {
+    }
+    REG32(VERILOG_DEBUG) = VERILOG_EXIT;
+    REG32(VERILOG_DEBUG) = (TEST_STATUS_MAGIC << 16) | (code & 0xFF);
+    REG32(VERILOG_DEBUG) = 0;
+    for (;;) {
+    }
+}
@@ -0,0 +1,31 @@
+/*
+ * mysoc_evb: output on the PL011, exit and host time through my_test_ip.
+ */
+#include "bench.h"
+#include "mysoc.h"
+
+void bench_board_init(void)
+{
+}
+
+void bench_putc(char c)
+{
+    while (REG32(PL011_BASE + PL011_FR) & PL011_FR_TXFF) {
+    }
+    REG32(PL011_BASE + PL011_DR) = c;
+}
+
+void bench_exit(int code)
+{
+    REG32(TEST_IP_BASE + TEST_IP_STATUS) = (TEST_STATUS_MAGIC << 16) |
+                                           (code & 0xFF);
+    for (;;) {
+    }
+}
+
+uint64_t mysoc_host_ns(void)
+{
+    uint32_t lo = REG32(TEST_IP_BASE + TEST_IP_HOST_LO);
+
+    return ((uint64_t)REG32(TEST_IP_BASE + TEST_IP_HOST_HI) << 32) | lo;
+}
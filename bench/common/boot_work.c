@@ -0,0 +1,37 @@
+/*
+ * Stand-in for a boot path: checksum the image the way a loader verifies
+ * what it is about to run, with enough calls and branches that most of
+ * the time goes into fetching and translating code from where it lives.
+ */
+#include "bench.h"
+
+extern const uint32_t _etext;
+extern const uint32_t bench_vectors[];
+
+static uint32_t crc32_update(uint32_t crc, uint8_t b)
+{
+    int i;
+
+    crc ^= b;
+    for (i = 0; i < 8; i++) {
+        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return crc;
+}
+
+uint32_t boot_work(uint32_t rounds)
+{
+    const uint8_t *p = (const uint8_t *)bench_vectors;
+    const uint8_t *end = (const uint8_t *)&_etext;
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t r;
+
+    for (r = 0; r < rounds; r++) {
+        const uint8_t *q;
+
+        for (q = p; q < end; q++) {
+            crc = crc32_update(crc, *q);
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,42 @@
+/*
+ * mysoc_evb register map used by the benchmarks.
+ */
+#ifndef MYSOC_H
+#define MYSOC_H
+
+#include <stdint.h>
+
+#define PL011_BASE          0x40000000
+#define PL011_DR            0x00
+#define PL011_FR            0x18
+#define PL011_FR_TXFF       (1 << 5)
+
+#define TEST_IP_BASE        0x40001000
+#define TEST_IP_IRQ         2
+#define TEST_IP_NOP         0x20
+#define TEST_IP_DB_DELAY    0x24
+#define TEST_IP_DOORBELL    0x28
+#define TEST_IP_IRQ_STATUS  0x2c
+#define TEST_IP_HOST_LO     0x30
+#define TEST_IP_HOST_HI     0x34
+#define TEST_IP_IRQ_LO      0x38
+#define TEST_IP_IRQ_HI      0x3c
+#define TEST_IP_VIRT_LO     0x40
+#define TEST_IP_VIRT_HI     0x44
+#define TEST_IP_STATUS      0x4c
+
+/* mysoc_evb_mp only */
+#define MBOX_BASE           0x40002000
+#define MBOX_IRQ            1
+#define MBOX_CPUID          0x0
+#define MBOX_NUM_CORES      0x4
+#define MBOX_INBOX(n)       (0x100 + (n) * 0x10)
+#define MBOX_INBOX_DATA     0x0
+#define MBOX_INBOX_STATUS   0x4
+#define MBOX_INBOX_DB_SET   0x8
+#define MBOX_INBOX_DB_CLR   0xc
+
+/* Host monotonic time in ns, from my_test_ip */
+uint64_t mysoc_host_ns(void);
+
+#endif
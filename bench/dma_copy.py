@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""eDMA against CPU copy bandwidth on imx8ulp-m33.
+
+The board has no host timer the firmware can read, so each mode is run
+with a zero-round baseline and with --rounds copies of a 64K buffer; the
+difference in wall time is the copy time, from which MB/s follows.
+
+    dma_copy.py QEMU BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure
+
+MODES = (("cpu", 1), ("dma", 2))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--rounds", type=int, default=4096)
+    args = ap.parse_args()
+
+    def run(mode, rounds):
+        return measure([args.qemu, "-M", "imx8ulp-m33", "-display", "none",
+                        "-monitor", "none", "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % (mode << 24 | rounds),
+                        "-kernel", os.path.join(args.build, "dma_copy.elf")],
+                       args.runs)
+
+    mbps = {}
+    for name, mode in MODES:
+        base = run(mode, 0)["wall"]
+        m = run(mode, args.rounds)
+        nbytes = m["results"][name + "_bytes"][0]
+        mbps[name] = nbytes / (m["wall"] - base) / 1e6
+        print("%-4s %10.1f MB/s  (%.1f ms for %d MB)" %
+              (name, mbps[name], (m["wall"] - base) * 1e3, nbytes / 2**20))
+    print("eDMA / CPU: %.2fx" % (mbps["dma"] / mbps["cpu"]))
+
+
+if __name__ == "__main__":
+    main()
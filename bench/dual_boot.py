@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Boot time of imx8ulp-m33 against imx8ulp-dual.
+
+Boots the same M33 application (boot_rom.elf) on imx8ulp-m33 and on
+imx8ulp-dual, where the A35 domain is either idle (no a35-image, all
+cores powered off) or spinning on a35_spin.bin.  The spinning case is
+run with MTTCG and with single-threaded round-robin TCG, which is where
+a second busy core shows up in the M33's time to first output.
+
+    dual_boot.py QEMU_AARCH64 BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=10)
+    ap.add_argument("--rounds", type=int, default=64,
+                    help="checksum passes over the image")
+    args = ap.parse_args()
+
+    spin = os.path.join(args.build, "a35_spin.bin")
+
+    def boot(machine, accel="tcg"):
+        return measure([args.qemu, "-M", machine, "-accel", accel,
+                        "-display", "none", "-monitor", "none",
+                        "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % args.rounds,
+                        "-kernel", os.path.join(args.build, "boot_rom.elf")],
+                       args.runs)
+
+    runs = [
+        ("imx8ulp-m33", boot("imx8ulp-m33")),
+        ("dual, A35 idle", boot("imx8ulp-dual")),
+        ("dual, A35 busy, MTTCG",
+         boot("imx8ulp-dual,a35-image=" + spin, "tcg,thread=multi")),
+        ("dual, A35 busy, 1 thread",
+         boot("imx8ulp-dual,a35-image=" + spin, "tcg,thread=single")),
+    ]
+    base = runs[0][1]["first"]
+    for label, m in runs:
+        report(label, m)
+        print("    first output vs imx8ulp-m33: %.2fx" % (m["first"] / base))
+
+
+if __name__ == "__main__":
+    main()
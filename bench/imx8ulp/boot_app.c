@@ -0,0 +1,18 @@
+/*
+ * Boot benchmark application.  The same source is linked to run from
+ * the ROM (boot_rom.elf) and in place from FlexSPI NOR (boot_xip.bin);
+ * the first UART line marks the end of the boot path.
+ */
+#include "bench.h"
+
+uint32_t boot_work(uint32_t rounds);
+
+int main(void)
+{
+    uint32_t crc = boot_work(bench_param(64));
+
+    bench_puts("boot done ");
+    bench_put_u64(crc);
+    bench_putc('\n');
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * eDMA against CPU copy on imx8ulp-m33.  Copies a 64K buffer in the TCM
+ * rounds times, either with a CPU word loop or as a single eDMA minor
+ * loop started by software (which the model runs in bulk with one
+ * mapped memmove).  There is no usable host timer on this board, so
+ * dma_copy.py times whole runs and subtracts a zero-round run.
+ *
+ * Parameter: mode << 24 | rounds, mode 1 = CPU, 2 = eDMA.
+ */
+#include "bench.h"
+
+#define EDMA0_BASE          0x38000000
+#define EDMA_CH(n)          (EDMA0_BASE + 0x1000 * ((n) + 1))
+#define EDMA_CH_CSR         0x00
+#define EDMA_CH_ES          0x04
+#define EDMA_CH_CSR_DONE    (1 << 30)
+#define TCD_SADDR           0x20
+#define TCD_SOFF_ATTR       0x24
+#define TCD_NBYTES          0x28
+#define TCD_SLAST           0x2C
+#define TCD_DADDR           0x30
+#define TCD_DOFF_CITER      0x34
+#define TCD_DLAST_SGA       0x38
+#define TCD_CSR_BITER       0x3C
+#define TCD_CSR_START       (1 << 0)
+
+#define MODE_CPU            1
+#define MODE_DMA            2
+
+#define BUF_SIZE            (64 * 1024)
+#define WORDS               (BUF_SIZE / 4)
+
+/* 32-byte beats, the largest transfer size the model accepts per side */
+#define BEAT                32
+#define BEAT_SIZE_CODE      5
+
+static uint32_t src[WORDS] __attribute__((aligned(BEAT)));
+static uint32_t dst[WORDS] __attribute__((aligned(BEAT)));
+
+static void cpu_copy(void)
+{
+    volatile uint32_t *d = dst;
+    uint32_t i;
+
+    for (i = 0; i < WORDS; i++) {
+        d[i] = src[i];
+    }
+}
+
+static int dma_copy(void)
+{
+    uint32_t ch = EDMA_CH(0);
+
+    REG32(ch + TCD_SADDR) = (uint32_t)(uintptr_t)src;
+    REG32(ch + TCD_SOFF_ATTR) = BEAT |
+        ((BEAT_SIZE_CODE << 8 | BEAT_SIZE_CODE) << 16);
+    REG32(ch + TCD_NBYTES) = BUF_SIZE;
+    REG32(ch + TCD_SLAST) = -BUF_SIZE;
+    REG32(ch + TCD_DADDR) = (uint32_t)(uintptr_t)dst;
+    REG32(ch + TCD_DOFF_CITER) = BEAT | (1 << 16);
+    REG32(ch + TCD_DLAST_SGA) = -BUF_SIZE;
+    REG32(ch + TCD_CSR_BITER) = TCD_CSR_START | (1 << 16);
+
+    while (!(REG32(ch + EDMA_CH_CSR) & EDMA_CH_CSR_DONE)) {
+    }
+    REG32(ch + EDMA_CH_CSR) = EDMA_CH_CSR_DONE;
+    return REG32(ch + EDMA_CH_ES) ? -1 : 0;
+}
+
+int main(void)
+{
+    uint32_t param = bench_param(MODE_CPU << 24 | 256);
+    uint32_t mode = param >> 24, rounds = param & 0xffffff;
+    uint32_t i;
+
+    for (i = 0; i < WORDS; i++) {
+        src[i] = i * 0x9e3779b9;
+    }
+    for (i = 0; i < rounds; i++) {
+        if (mode == MODE_DMA) {
+            if (dma_copy()) {
+                bench_puts("eDMA error\n");
+                return 1;
+            }
+        } else {
+            cpu_copy();
+        }
+    }
+    for (i = 0; rounds && i < WORDS; i++) {
+        if (dst[i] != src[i]) {
+            bench_puts("copy mismatch\n");
+            return 1;
+        }
+    }
+    bench_result(mode == MODE_DMA ? "dma_bytes" : "cpu_bytes",
+                 (uint64_t)rounds * BUF_SIZE, "B");
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Console log flood on imx8ulp-m33.  Prints 64-byte log lines on LPUART0
+ * as fast as TDRE allows until the requested amount has gone out.  The
+ * model hands the TX FIFO to the chardev in batches, so uart_flood.py
+ * gets the sustained rate from the wall time against a 1K baseline run.
+ *
+ * Parameter: kilobytes to print.
+ */
+#include "bench.h"
+
+#define LINE_LEN            64
+
+int main(void)
+{
+    uint32_t kb = bench_param(4096);
+    uint32_t lines = kb * 1024 / LINE_LEN, i;
+    char line[LINE_LEN + 1];
+    int j;
+
+    /* "log 0123abcd ........\n", the sequence number keeps lines apart */
+    for (j = 0; j < LINE_LEN - 1; j++) {
+        line[j] = '.';
+    }
+    line[0] = 'l';
+    line[1] = 'o';
+    line[2] = 'g';
+    line[3] = ' ';
+    line[LINE_LEN - 1] = '\n';
+    line[LINE_LEN] = 0;
+
+    for (i = 0; i < lines; i++) {
+        for (j = 0; j < 8; j++) {
+            line[4 + j] = "0123456789abcdef"[(i >> (28 - 4 * j)) & 0xf];
+        }
+        bench_puts(line);
+    }
+    bench_result("uart_bytes", (uint64_t)lines * LINE_LEN, "B");
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * uPower power-switch transitions on imx8ulp-m33, waited for by polling
+ * RSR or by WFI on the uPower interrupt.  Each transition flips one
+ * power switch and waits for the response, which the model sends
+ * delay-ns of virtual time later.  upower_wait.py compares the host CPU
+ * time of both modes to get the CPU saved per transition.
+ *
+ * Parameter: mode << 24 | transitions, mode 1 = poll, 2 = WFI.
+ */
+#include "bench.h"
+
+#define UPOWER_BASE         0x28350000
+#define UPOWER_IRQ          78
+#define UPWR_MU_RCR         (UPOWER_BASE + 0x128)
+#define UPWR_MU_RSR         (UPOWER_BASE + 0x12C)
+#define UPWR_MU_TR(n)       (UPOWER_BASE + 0x200 + 4 * (n))
+#define UPWR_MU_RR(n)       (UPOWER_BASE + 0x280 + 4 * (n))
+
+/* Header: service group [4:1], function [8:5], response error [12:9] */
+#define UPWR_SG_PWRMGMT     1
+#define UPWR_PWM_SWITCH     1
+#define UPWR_HDR(sg, fn)    ((sg) << 1 | (fn) << 5)
+#define UPWR_RESP_ERR(hdr)  (((hdr) >> 9) & 0xF)
+
+#define NVIC_ICPR(irq)      (0xE000E280 + ((irq) / 32) * 4)
+
+#define MODE_POLL           1
+#define MODE_WFI            2
+
+/* A switch nothing in this image runs from */
+#define SWITCH_BIT          (1u << 20)
+
+static int transition(uint32_t mode, uint32_t on)
+{
+    uint32_t hdr;
+
+    REG32(UPWR_MU_TR(1)) = SWITCH_BIT;
+    REG32(UPWR_MU_TR(2)) = on ? SWITCH_BIT : 0;
+    REG32(UPWR_MU_TR(0)) = UPWR_HDR(UPWR_SG_PWRMGMT, UPWR_PWM_SWITCH);
+
+    /* With PRIMASK set a pending interrupt still ends WFI, untaken */
+    while (!(REG32(UPWR_MU_RSR) & 1)) {
+        if (mode == MODE_WFI) {
+            __asm__ volatile("wfi");
+        }
+    }
+    hdr = REG32(UPWR_MU_RR(0));
+    (void)REG32(UPWR_MU_RR(1));
+    REG32(NVIC_ICPR(UPOWER_IRQ)) = 1u << (UPOWER_IRQ % 32);
+    return UPWR_RESP_ERR(hdr) ? -1 : 0;
+}
+
+int main(void)
+{
+    uint32_t param = bench_param(MODE_WFI << 24 | 10000);
+    uint32_t mode = param >> 24, n = param & 0xffffff;
+    uint32_t i;
+
+    if (mode == MODE_WFI) {
+        __asm__ volatile("cpsid i");
+        REG32(UPWR_MU_RCR) = 1;
+        bench_irq_enable(UPOWER_IRQ);
+    }
+    for (i = 0; i < n; i++) {
+        if (transition(mode, i & 1)) {
+            bench_puts("uPower request failed\n");
+            return 1;
+        }
+    }
+    bench_irq_disable(UPOWER_IRQ);
+    REG32(UPWR_MU_RCR) = 0;
+    __asm__ volatile("cpsie i");
+
+    bench_result(mode == MODE_WFI ? "wfi_transitions" : "poll_transitions",
+                 n, "transitions");
+    return 0;
+}
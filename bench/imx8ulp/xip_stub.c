@@ -0,0 +1,17 @@
+/*
+ * ROM stub for the XIP boot benchmark: hand over to the vector table at
+ * the start of the FlexSPI0 AHB window.
+ */
+#include "bench.h"
+
+#define SCB_VTOR    0xE000ED08
+#define XIP_BASE    0x04000000
+
+int main(void)
+{
+    const uint32_t *vt = (const uint32_t *)XIP_BASE;
+
+    REG32(SCB_VTOR) = XIP_BASE;
+    __asm__ volatile("msr msp, %0\n\tbx %1" : : "r"(vt[0]), "r"(vt[1]));
+    return 1;
+}
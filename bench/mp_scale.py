@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Core-count scaling benchmark for mysoc_evb_mp.
+
+Runs mp_scale.elf with -smp 1, 2, 4, 8 under MTTCG and reports the
+aggregate throughput and the speedup and parallel efficiency against
+the single-core run.  Each core does the same amount of work, so ideal
+scaling keeps the run time flat and multiplies the throughput.  Core
+counts above the host's CPU count are skipped unless --cores says so.
+
+    mp_scale.py QEMU BUILD_DIR [--runs N] [--iters N] [--cores 1,2,4,8]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--iters", type=int, default=4 * 1024 * 1024,
+                    help="work iterations per core")
+    ap.add_argument("--cores", default=None,
+                    help="comma separated core counts")
+    args = ap.parse_args()
+
+    if args.cores:
+        counts = [int(c) for c in args.cores.split(",")]
+    else:
+        counts = [n for n in (1, 2, 4, 8) if n <= (os.cpu_count() or 1)]
+
+    base = None
+    for n in counts:
+        m = measure([args.qemu, "-M", "mysoc_evb_mp", "-smp", str(n),
+                     "-accel", "tcg,thread=multi", "-display", "none",
+                     "-monitor", "none", "-serial", "stdio",
+                     "-device", "loader,addr=0x20100000,data=%d,data-len=4"
+                     % args.iters,
+                     "-kernel", os.path.join(args.build, "mp_scale.elf")],
+                    args.runs)
+        report("%d core(s)" % n, m)
+        tput = m["results"]["mp_throughput"][0]
+        if base is None:
+            base = tput
+        print("    speedup %.2fx, efficiency %.0f%%" %
+              (tput / base, 100.0 * tput / base / n))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+/*
+ * Interrupt latency on mysoc_evb.  Each round rings the TEST_IP
+ * doorbell with no delay and takes the host time at handler entry.
+ * "dispatch" is the host time from the device raising the IRQ
+ * (TEST_IP_IRQ_LO/HI) to the handler running, "round_trip" is from the
+ * doorbell write to the handler running.
+ *
+ * Parameter: rounds (default 10000).
+ */
+#include "bench.h"
+#include "mysoc.h"
+
+static volatile uint64_t entry;
+static volatile uint32_t taken;
+
+void bench_irq_handler(void)
+{
+    entry = mysoc_host_ns();
+    REG32(TEST_IP_BASE + TEST_IP_IRQ_STATUS) = 1;
+    taken = 1;
+}
+
+static uint64_t irq_time(void)
+{
+    uint32_t lo = REG32(TEST_IP_BASE + TEST_IP_IRQ_LO);
+
+    return ((uint64_t)REG32(TEST_IP_BASE + TEST_IP_IRQ_HI) << 32) | lo;
+}
+
+int main(void)
+{
+    uint32_t rounds = bench_param(10000);
+    uint64_t dispatch = 0, round_trip = 0, max = 0, start, d;
+    uint32_t i;
+
+    REG32(TEST_IP_BASE + TEST_IP_DB_DELAY) = 0;
+    bench_irq_enable(TEST_IP_IRQ);
+
+    for (i = 0; i < rounds; i++) {
+        taken = 0;
+        start = mysoc_host_ns();
+        REG32(TEST_IP_BASE + TEST_IP_DOORBELL) = 1;
+        while (!taken) {
+        }
+        d = entry - irq_time();
+        dispatch += d;
+        round_trip += entry - start;
+        if (d > max) {
+            max = d;
+        }
+    }
+    bench_irq_disable(TEST_IP_IRQ);
+
+    bench_result("irq_dispatch_avg", dispatch / rounds, "ns");
+    bench_result("irq_dispatch_max", max, "ns");
+    bench_result("irq_round_trip_avg", round_trip / rounds, "ns");
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * MMIO round trips per second on mysoc_evb: back-to-back reads and
+ * writes of TEST_IP_NOP, which does nothing in the device model, so the
+ * time is the cost of leaving the TB and dispatching the access.
+ *
+ * Parameter: accesses per direction (default 1M).
+ */
+#include "bench.h"
+#include "mysoc.h"
+
+int main(void)
+{
+    uint32_t n = bench_param(1024 * 1024);
+    uint64_t start, rd, wr;
+    uint32_t i;
+
+    start = mysoc_host_ns();
+    for (i = 0; i < n; i++) {
+        (void)REG32(TEST_IP_BASE + TEST_IP_NOP);
+    }
+    rd = mysoc_host_ns() - start;
+
+    start = mysoc_host_ns();
+    for (i = 0; i < n; i++) {
+        REG32(TEST_IP_BASE + TEST_IP_NOP) = i;
+    }
+    wr = mysoc_host_ns() - start;
+
+    bench_result("mmio_read", (uint64_t)n * 1000000000 / (rd ? rd : 1),
+                 "ops/s");
+    bench_result("mmio_write", (uint64_t)n * 1000000000 / (wr ? wr : 1),
+                 "ops/s");
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Core-count scaling on mysoc_evb_mp.
+ *
+ * Every core runs the same fixed amount of CPU-bound work out of its
+ * private SRAM.  Core 0 takes the start time, releases the other cores
+ * with doorbell bit 0 on their inboxes, does its own share and then
+ * waits for every other core to set its bit in core 0's doorbell.
+ * Nothing is shared while the work runs, so with MTTCG the throughput
+ * should scale with the number of cores up to the host's core count.
+ *
+ * Parameter: work iterations per core (default 4M).
+ */
+#include "bench.h"
+#include "mysoc.h"
+
+#define MBOX(off)   REG32(MBOX_BASE + (off))
+
+static uint32_t work(uint32_t iters, uint32_t seed)
+{
+    uint32_t x = seed | 1, acc = 0;
+
+    while (iters--) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        acc += x;
+    }
+    return acc;
+}
+
+/* Kept so the work loop can't be optimised away */
+static volatile uint32_t sink;
+
+int main(void)
+{
+    uint32_t iters = bench_param(4 * 1024 * 1024);
+    uint32_t cpu = MBOX(MBOX_CPUID);
+    uint32_t cores = MBOX(MBOX_NUM_CORES);
+    uint32_t all = ((1u << cores) - 1) & ~1u;
+    uint64_t start, ns;
+    uint32_t i;
+
+    if (cpu != 0) {
+        while (!(MBOX(MBOX_INBOX(cpu) + MBOX_INBOX_DB_SET) & 1)) {
+        }
+        MBOX(MBOX_INBOX(cpu) + MBOX_INBOX_DB_CLR) = 1;
+        sink = work(iters, cpu);
+        MBOX(MBOX_INBOX(0) + MBOX_INBOX_DB_SET) = 1u << cpu;
+        for (;;) {
+            __asm__ volatile("wfi");
+        }
+    }
+
+    start = mysoc_host_ns();
+    for (i = 1; i < cores; i++) {
+        MBOX(MBOX_INBOX(i) + MBOX_INBOX_DB_SET) = 1;
+    }
+    sink = work(iters, 0);
+    while ((MBOX(MBOX_INBOX(0) + MBOX_INBOX_DB_SET) & all) != all) {
+    }
+    ns = mysoc_host_ns() - start;
+
+    bench_result("mp_cores", cores, "cores");
+    bench_result("mp_time", ns / 1000, "us");
+    bench_result("mp_throughput",
+                 (uint64_t)iters * cores * 1000000 / (ns ? ns : 1), "kiter/s");
+    return 0;
+}
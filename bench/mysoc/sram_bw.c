@@ -0,0 +1,57 @@
+/*
+ * SRAM bandwidth on mysoc_evb: word fill, sum and copy over two 128K
+ * buffers, timed with the host clock.  This is the TCG fast path for
+ * RAM, so it is the baseline the MMIO numbers compare against.
+ *
+ * Parameter: passes over the buffers (default 64).
+ */
+#include "bench.h"
+#include "mysoc.h"
+
+#define WORDS   (128 * 1024 / 4)
+
+static uint32_t src[WORDS], dst[WORDS];
+static volatile uint32_t sink;
+
+static uint64_t mbps(uint64_t bytes, uint64_t ns)
+{
+    /* bytes/ns is GB/s, MB/s is that times 1000 */
+    return bytes * 1000 / (ns ? ns : 1);
+}
+
+int main(void)
+{
+    uint32_t passes = bench_param(64);
+    uint64_t bytes = (uint64_t)passes * sizeof(src);
+    uint64_t start, ns;
+    uint32_t p, i, sum = 0;
+
+    start = mysoc_host_ns();
+    for (p = 0; p < passes; p++) {
+        for (i = 0; i < WORDS; i++) {
+            src[i] = p + i;
+        }
+    }
+    ns = mysoc_host_ns() - start;
+    bench_result("sram_write", mbps(bytes, ns), "MB/s");
+
+    start = mysoc_host_ns();
+    for (p = 0; p < passes; p++) {
+        for (i = 0; i < WORDS; i++) {
+            sum += ((volatile uint32_t *)src)[i];
+        }
+    }
+    ns = mysoc_host_ns() - start;
+    sink = sum;
+    bench_result("sram_read", mbps(bytes, ns), "MB/s");
+
+    start = mysoc_host_ns();
+    for (p = 0; p < passes; p++) {
+        for (i = 0; i < WORDS; i++) {
+            ((volatile uint32_t *)dst)[i] = src[i];
+        }
+    }
+    ns = mysoc_host_ns() - start;
+    bench_result("sram_copy", mbps(bytes, ns), "MB/s");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Slowdown of the imx8ulp TCG plugins.
+
+Runs the same workload (boot_rom.elf, checksumming the ROM image
+--rounds times) on imx8ulp-m33 without a plugin and with each of
+libimx8ulp_cache.so, libimx8ulp_heat.so and libimx8ulp_cov.so, and
+reports the median wall time and the slowdown against the plain run.
+Plugin reports go to files in BUILD_DIR so they do not mix with the
+guest output.
+
+    plugin_overhead.py QEMU BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--rounds", type=int, default=1024,
+                    help="checksum passes over the image")
+    args = ap.parse_args()
+
+    b = args.build
+    elf = os.path.join(b, "boot_rom.elf")
+    plugins = [
+        ("no plugin", None),
+        ("cache", "cache,arg=elf=%s,arg=out=%s"
+         % (elf, os.path.join(b, "cache.txt"))),
+        ("heat", "heat,arg=elf=%s,arg=out=%s"
+         % (elf, os.path.join(b, "heat.txt"))),
+        ("cov", "cov,arg=file=%s,arg=range=0x10000000+0x30000"
+         % os.path.join(b, "cov.bin")),
+    ]
+
+    base = None
+    for label, plugin in plugins:
+        cmd = [args.qemu, "-M", "imx8ulp-m33", "-display", "none",
+               "-monitor", "none", "-serial", "stdio",
+               "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+               % args.rounds, "-kernel", elf]
+        if plugin:
+            name, _, rest = plugin.partition(",")
+            cmd += ["-plugin", "%s,%s" %
+                    (os.path.join(b, "libimx8ulp_%s.so" % name), rest)]
+        m = measure(cmd, args.runs)
+        report(label, m)
+        if base is None:
+            base = m["wall"]
+        else:
+            print("    slowdown %.2fx" % (m["wall"] / base))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Overhead of the imx8ulp-m33 sampling profiler.
+
+Runs the same workload (boot_rom.elf, checksumming the ROM image
+--rounds times) without the profiler and with profile= at several
+sampling intervals of virtual time, and reports the median wall time,
+the slowdown against the plain run and the host cost per sample, counted
+from the folded stacks the last run wrote to BUILD_DIR/prof.folded.
+
+    prof_overhead.py QEMU BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+INTERVALS_NS = (1000000, 100000, 10000)
+
+
+def folded_samples(path):
+    """Samples in the last run's output, "stack count" per line."""
+    with open(path) as f:
+        return sum(int(line.rsplit(None, 1)[1]) for line in f if line.strip())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--rounds", type=int, default=1024,
+                    help="checksum passes over the image")
+    args = ap.parse_args()
+
+    b = args.build
+    out = os.path.join(b, "prof.folded")
+
+    def run(machine):
+        return measure([args.qemu, "-M", machine, "-display", "none",
+                        "-monitor", "none", "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % args.rounds,
+                        "-kernel", os.path.join(b, "boot_rom.elf")],
+                       args.runs)
+
+    base = run("imx8ulp-m33")
+    report("no profiler", base)
+    for ns in INTERVALS_NS:
+        m = run("imx8ulp-m33,profile=%s,profile-interval=%d" % (out, ns))
+        report("every %d ns" % ns, m)
+        samples = folded_samples(out)
+        line = "    slowdown %.2fx, %d samples" % (m["wall"] / base["wall"],
+                                                 samples)
+        if samples:
+            line += ", %.1f us per sample" % (
+                (m["wall"] - base["wall"]) * 1e6 / samples)
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Time to first UART output on imx8ulp-m33, ROM from -kernel or rom-image.
+
+Boots the same ROM workload (boot_rom) loaded through -kernel, which
+copies it into the ROM at reset, and mapped from the raw boot_rom.bin
+with rom-image=, which maps the file read-only and shares its page cache
+between instances.  The mapping does not cache translated code, so any
+gain is in loading only; translation still happens on every run.
+
+    rom_image.py QEMU BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=10)
+    ap.add_argument("--rounds", type=int, default=64,
+                    help="checksum passes over the image")
+    args = ap.parse_args()
+
+    b = args.build
+
+    def boot(machine, extra):
+        return measure([args.qemu, "-M", machine, "-display", "none",
+                        "-monitor", "none", "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % args.rounds] + extra, args.runs)
+
+    kernel = boot("imx8ulp-m33", ["-kernel", os.path.join(b, "boot_rom.elf")])
+    mapped = boot("imx8ulp-m33,rom-image=" + os.path.join(b, "boot_rom.bin"),
+                  [])
+    report("ROM from -kernel", kernel)
+    report("ROM from rom-image", mapped)
+    print("rom-image / -kernel time to first output: %.2fx" %
+          (mapped["first"] / kernel["first"]))
+
+
+if __name__ == "__main__":
+    main()
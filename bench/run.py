@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Run an emulator command several times and summarise it.
+
+    run.py [--runs N] [--label NAME] -- qemu-system-arm -M ... -kernel x.elf
+
+Reports the median wall time, the median time until the first byte of
+output (the guest's first UART character with -serial stdio), and the
+median of every "RESULT <name> <value> <unit>" line the firmware prints.
+A run must exit with status 0, which the firmware reports through the
+test status register.
+
+Other benchmark scripts import measure() from here.
+"""
+
+import argparse
+import os
+import select
+import statistics
+import subprocess
+import sys
+import time
+
+
+def run_once(cmd, timeout):
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, stdin=subprocess.DEVNULL)
+    first = None
+    out = b""
+    fd = proc.stdout.fileno()
+    while True:
+        left = timeout - (time.perf_counter() - start)
+        if left <= 0:
+            proc.kill()
+            proc.wait()
+            raise RuntimeError("timed out: " + " ".join(cmd))
+        ready, _, _ = select.select([fd], [], [], left)
+        if not ready:
+            continue
+        chunk = os.read(fd, 65536)
+        if not chunk:
+            break
+        if first is None:
+            first = time.perf_counter() - start
+        out += chunk
+    code = proc.wait()
+    wall = time.perf_counter() - start
+    if code != 0:
+        raise RuntimeError("exit code %d: %s\n%s" %
+                           (code, " ".join(cmd), out.decode(errors="replace")))
+
+    results = {}
+    for line in out.decode(errors="replace").splitlines():
+        f = line.split()
+        if len(f) == 4 and f[0] == "RESULT":
+            results[f[1]] = (float(f[2]), f[3])
+    return wall, first, results
+
+
+def measure(cmd, runs=5, timeout=300):
+    """Median wall time, first-output time (s) and RESULT values of cmd."""
+    walls, firsts, res = [], [], {}
+    for _ in range(runs):
+        wall, first, results = run_once(cmd, timeout)
+        walls.append(wall)
+        if first is not None:
+            firsts.append(first)
+        for name, (value, unit) in results.items():
+            res.setdefault(name, ([], unit))[0].append(value)
+    return {
+        "wall": statistics.median(walls),
+        "first": statistics.median(firsts) if firsts else None,
+        "results": {n: (statistics.median(v), u) for n, (v, u) in res.items()},
+    }
+
+
+def report(label, m):
+    line = "%-24s wall %8.1f ms" % (label, m["wall"] * 1e3)
+    if m["first"] is not None:
+        line += "   first output %8.1f ms" % (m["first"] * 1e3)
+    print(line)
+    for name, (value, unit) in sorted(m["results"].items()):
+        print("    %-28s %14.1f %s" % (name, value, unit))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--label", default=None)
+    ap.add_argument("--timeout", type=float, default=300)
+    ap.add_argument("cmd", nargs=argparse.REMAINDER)
+    args = ap.parse_args()
+    cmd = args.cmd[1:] if args.cmd[:1] == ["--"] else args.cmd
+    if not cmd:
+        ap.error("no command")
+    report(args.label or os.path.basename(cmd[0]),
+           measure(cmd, args.runs, args.timeout))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+"""Sustained LPUART console throughput on imx8ulp-m33.
+
+The firmware floods LPUART0 with log lines and QEMU writes them to a pipe
+(-serial stdio).  A 1K run is the baseline for boot and exit, so the
+difference in wall time is the time spent printing --kb kilobytes.
+
+    uart_flood.py QEMU BUILD_DIR [--runs N] [--kb K]
+"""
+
+import argparse
+import os
+
+from run import measure
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--kb", type=int, default=16384)
+    args = ap.parse_args()
+
+    def run(kb):
+        return measure([args.qemu, "-M", "imx8ulp-m33", "-display", "none",
+                        "-monitor", "none", "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % kb,
+                        "-kernel", os.path.join(args.build, "uart_flood.elf")],
+                       args.runs)
+
+    base = run(1)
+    m = run(args.kb)
+    nbytes = (m["results"]["uart_bytes"][0] -
+              base["results"]["uart_bytes"][0])
+    secs = m["wall"] - base["wall"]
+    print("%.1f MB in %.1f ms: %.2f MB/s, %.0f ns/byte" %
+          (nbytes / 2**20, secs * 1e3, nbytes / secs / 1e6,
+           secs * 1e9 / nbytes))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Host CPU saved per uPower transition by WFI over polling.
+
+Runs upower_wait.elf on imx8ulp-m33 once polling the uPower MU and once
+sleeping in WFI until its interrupt, each with --count power-switch
+transitions.  The host CPU time of the QEMU processes (user + system,
+from the rusage of waited-for children) is compared per transition.
+--delay-ns sets the virtual time the model takes per request.
+
+    upower_wait.py QEMU BUILD_DIR [--runs N] [--count C] [--delay-ns D]
+"""
+
+import argparse
+import os
+import resource
+
+from run import measure, report
+
+MODES = (("poll", 1), ("wfi", 2))
+
+
+def child_cpu():
+    ru = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return ru.ru_utime + ru.ru_stime
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--count", type=int, default=10000)
+    ap.add_argument("--delay-ns", type=int, default=20000)
+    args = ap.parse_args()
+
+    cpu = {}
+    for name, mode in MODES:
+        before = child_cpu()
+        m = measure([args.qemu, "-M", "imx8ulp-m33", "-display", "none",
+                     "-monitor", "none", "-serial", "stdio",
+                     "-global", "imx_upower.delay-ns=%d" % args.delay_ns,
+                     "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                     % (mode << 24 | args.count),
+                     "-kernel", os.path.join(args.build, "upower_wait.elf")],
+                    args.runs)
+        cpu[name] = (child_cpu() - before) / args.runs
+        report(name, m)
+        print("    host CPU %.1f ms per run, %.2f us per transition" %
+              (cpu[name] * 1e3, cpu[name] * 1e6 / args.count))
+    print("host CPU saved by WFI: %.2f us per transition" %
+          ((cpu["poll"] - cpu["wfi"]) * 1e6 / args.count))
+
+
+if __name__ == "__main__":
+    main()
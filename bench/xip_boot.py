@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""XIP boot benchmark for imx8ulp-m33.
+
+Boots the same application from the ROM and in place from FlexSPI0 NOR
+(the romd XIP window) and compares the time to the first UART output.
+With the window in ROMD mode both should be within noise of each other;
+a large gap means XIP fetches are trapping.
+
+    xip_boot.py QEMU BUILD_DIR [--runs N] [--rounds R]
+"""
+
+import argparse
+import os
+
+from run import measure, report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("qemu")
+    ap.add_argument("build")
+    ap.add_argument("--runs", type=int, default=10)
+    ap.add_argument("--rounds", type=int, default=64,
+                    help="checksum passes over the image")
+    args = ap.parse_args()
+
+    b = args.build
+
+    def boot(machine, kernel):
+        return measure([args.qemu, "-M", machine, "-display", "none",
+                        "-monitor", "none", "-serial", "stdio",
+                        "-device", "loader,addr=0x1fffff00,data=%d,data-len=4"
+                        % args.rounds,
+                        "-kernel", os.path.join(b, kernel)], args.runs)
+
+    rom = boot("imx8ulp-m33", "boot_rom.elf")
+    xip = boot("imx8ulp-m33,flexspi-image=" + os.path.join(b, "boot_xip.bin"),
+               "xip_stub.elf")
+    report("boot from ROM", rom)
+    report("boot XIP from FlexSPI", xip)
+    print("XIP / ROM time to first output: %.2fx" %
+          (xip["first"] / rom["first"]))
+
+
+if __name__ == "__main__":
+    main()
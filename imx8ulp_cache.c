@@ -0,0 +1,420 @@
+/*
+ * LMEM cache simulation for imx8ulp-m33 firmware.
+ *
+ * Build as a TCG plugin against qemu-plugin.h and load it with
+ *
+ *   -plugin libimx8ulp_cache.so,arg="elf=fw.elf",arg="out=cache.txt",
+ *           arg="csize=8192",arg="cways=2",arg="cline=16"
+ *
+ * The code cache (csize/cways/cline) sees fetches and data accesses
+ * below 0x20000000, the system cache (ssize/sways/sline) those above.
+ * Only the cacheable memories in regions[] go through a cache.  Sizes,
+ * ways and line sizes must be powers of two.
+ *
+ * Fetches are simulated once per cache line a block touches: at
+ * translation time each block gets the list of lines it spans and how
+ * many instructions fall in each, so only the first fetch of a line can
+ * miss and the rest are counted as hits without a lookup.  Sets keep
+ * their ways in MRU order, a hit moves one tag to the front.
+ *
+ * Only one vCPU is simulated (vcpu=, default 0); with imx8ulp-dual pick
+ * the M33.  The report goes to out= (stderr by default) with hit rates
+ * per cache, per region and, with elf=, per function.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qemu-plugin.h>
+
+#include "imx8ulp_plugin_elf.h"
+
+#ifdef QEMU_PLUGIN_VERSION
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+#endif
+
+#define CACHE_CODE      0
+#define CACHE_SYS       1
+#define CACHE_NUM       2
+#define CACHE_MAX_WAYS  16
+
+typedef struct {
+    const char *name;
+    uint32_t size;
+    uint32_t ways;
+    uint32_t line;
+    uint32_t line_shift;
+    uint32_t set_mask;
+    uint64_t *tags;         /* sets * ways, MRU first, ~0 is invalid */
+    uint64_t hits;
+    uint64_t misses;
+} cache;
+
+typedef struct {
+    const char *name;
+    uint64_t base;
+    uint64_t size;
+    uint64_t hits[CACHE_NUM];
+    uint64_t misses[CACHE_NUM];
+} cache_region;
+
+/*
+ * Cacheable memories of the imx8ulp-m33 machine.  The TCM at 0x1ffc0000
+ * sits beside LMEM, not behind it, so it is left out.
+ */
+static cache_region regions[] = {
+    { "flexspi0-xip", 0x04000000, 0x08000000 },
+    { "rom",          0x10000000, 0x00030000 },
+    { "ssram",        0x30000000, 0x00080000 },
+    { "psram",        0x80000000, 0x01000000 },
+};
+
+typedef struct {
+    const imx_elf_sym *sym;
+    uint64_t hits[CACHE_NUM];
+    uint64_t misses[CACHE_NUM];
+} cache_func;
+
+/* A run of fetches from one cache line inside a block */
+typedef struct {
+    uint64_t line;
+    uint32_t which;
+    uint32_t ninsns;
+    cache_region *region;
+    cache_func *func;
+} cache_fetch;
+
+typedef struct {
+    uint32_t nfetch;
+    cache_fetch fetch[];
+} cache_tb;
+
+static cache caches[CACHE_NUM] = {
+    { "code", 8192, 2, 16 },
+    { "system", 8192, 2, 16 },
+};
+
+static unsigned int sim_vcpu;
+static const char *out_file;
+static imx_elf_symtab symtab;
+static bool have_symtab;
+static cache_func *funcs;
+
+static cache_region *cache_find_region(uint64_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(regions); i++) {
+        if (addr - regions[i].base < regions[i].size) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+static cache_func *cache_find_func(uint64_t addr)
+{
+    const imx_elf_sym *s;
+
+    if (!have_symtab) {
+        return NULL;
+    }
+    s = imx_elf_lookup(&symtab, addr);
+    return s ? &funcs[s - symtab.syms] : NULL;
+}
+
+static bool cache_setup(cache *c)
+{
+    uint64_t sets;
+
+    if (!c->line || (c->line & (c->line - 1)) || !c->ways ||
+        c->ways > CACHE_MAX_WAYS || c->size < c->line * c->ways) {
+        return false;
+    }
+    sets = c->size / c->line / c->ways;
+    if (sets & (sets - 1)) {
+        return false;
+    }
+    c->line_shift = __builtin_ctz(c->line);
+    c->set_mask = sets - 1;
+    c->tags = g_new(uint64_t, sets * c->ways);
+    memset(c->tags, 0xff, sets * c->ways * sizeof(uint64_t));
+    return true;
+}
+
+/* Look up a line number (address >> line_shift); true on a hit */
+static bool cache_access(cache *c, uint64_t line)
+{
+    uint64_t *set = &c->tags[(line & c->set_mask) * c->ways];
+    uint32_t i;
+
+    if (set[0] == line) {
+        c->hits++;
+        return true;
+    }
+    for (i = 1; i < c->ways; i++) {
+        if (set[i] == line) {
+            break;
+        }
+    }
+    /* Hit or miss, the line ends up MRU; a miss evicts the LRU way */
+    if (i == c->ways) {
+        i--;
+        c->misses++;
+        memmove(&set[1], &set[0], i * sizeof(uint64_t));
+        set[0] = line;
+        return false;
+    }
+    memmove(&set[1], &set[0], i * sizeof(uint64_t));
+    set[0] = line;
+    c->hits++;
+    return true;
+}
+
+static void cache_count(int which, bool hit, uint64_t n, cache_region *r,
+                        cache_func *f)
+{
+    if (hit) {
+        r->hits[which] += n;
+        if (f) {
+            f->hits[which] += n;
+        }
+    } else {
+        r->misses[which]++;
+        if (f) {
+            f->misses[which]++;
+        }
+    }
+}
+
+static void vcpu_tb_exec(unsigned int vcpu_index, void *udata)
+{
+    cache_tb *tb = udata;
+    uint32_t i;
+
+    if (vcpu_index != sim_vcpu) {
+        return;
+    }
+    for (i = 0; i < tb->nfetch; i++) {
+        cache_fetch *f = &tb->fetch[i];
+        cache *c = &caches[f->which];
+
+        cache_count(f->which, cache_access(c, f->line), 1, f->region,
+                    f->func);
+        /* The rest of the run is in the line just looked up */
+        if (f->ninsns > 1) {
+            c->hits += f->ninsns - 1;
+            cache_count(f->which, true, f->ninsns - 1, f->region, f->func);
+        }
+    }
+}
+
+static void vcpu_mem(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
+                     uint64_t vaddr, void *udata)
+{
+    cache_func *func = udata;
+    int which = vaddr < 0x20000000 ? CACHE_CODE : CACHE_SYS;
+    cache *c = &caches[which];
+    unsigned size = 1 << qemu_plugin_mem_size_shift(info);
+    cache_region *r;
+    uint64_t line, last;
+
+    if (vcpu_index != sim_vcpu) {
+        return;
+    }
+    r = cache_find_region(vaddr);
+    if (!r) {
+        return;
+    }
+    last = (vaddr + size - 1) >> c->line_shift;
+    for (line = vaddr >> c->line_shift; line <= last; line++) {
+        cache_count(which, cache_access(c, line), 1, r, func);
+    }
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    cache_tb *rec;
+    size_t i;
+
+    rec = g_malloc0(sizeof(*rec) + n * sizeof(cache_fetch));
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint64_t pc = qemu_plugin_insn_vaddr(insn);
+        cache_region *r = cache_find_region(pc);
+        cache_func *func = cache_find_func(pc);
+        uint32_t which = pc < 0x20000000 ? CACHE_CODE : CACHE_SYS;
+        uint64_t line = pc >> caches[which].line_shift;
+
+        if (r) {
+            cache_fetch *last = rec->nfetch ? &rec->fetch[rec->nfetch - 1]
+                                            : NULL;
+
+            if (last && last->which == which && last->line == line &&
+                last->func == func) {
+                last->ninsns++;
+            } else {
+                rec->fetch[rec->nfetch].line = line;
+                rec->fetch[rec->nfetch].which = which;
+                rec->fetch[rec->nfetch].ninsns = 1;
+                rec->fetch[rec->nfetch].region = r;
+                rec->fetch[rec->nfetch].func = func;
+                rec->nfetch++;
+            }
+        }
+
+        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, func);
+    }
+
+    if (rec->nfetch) {
+        qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec,
+                                             QEMU_PLUGIN_CB_NO_REGS, rec);
+    } else {
+        g_free(rec);
+    }
+}
+
+static double cache_rate(uint64_t hits, uint64_t misses)
+{
+    return hits + misses ? 100.0 * hits / (hits + misses) : 0.0;
+}
+
+static gint cache_func_cmp(gconstpointer a, gconstpointer b)
+{
+    const cache_func *fa = *(cache_func * const *)a;
+    const cache_func *fb = *(cache_func * const *)b;
+    uint64_t ma = fa->misses[CACHE_CODE] + fa->misses[CACHE_SYS];
+    uint64_t mb = fb->misses[CACHE_CODE] + fb->misses[CACHE_SYS];
+
+    return ma < mb ? 1 : ma > mb ? -1 : 0;
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    FILE *f = out_file ? fopen(out_file, "w") : stderr;
+    GPtrArray *sorted;
+    size_t i;
+    int c;
+
+    if (!f) {
+        fprintf(stderr, "imx8ulp_cache: cannot write %s\n", out_file);
+        return;
+    }
+
+    for (c = 0; c < CACHE_NUM; c++) {
+        fprintf(f, "%s cache: %u bytes, %u-way, %u byte lines: "
+                "%" PRIu64 " hits %" PRIu64 " misses (%.2f%% hit)\n",
+                caches[c].name, caches[c].size, caches[c].ways,
+                caches[c].line, caches[c].hits, caches[c].misses,
+                cache_rate(caches[c].hits, caches[c].misses));
+    }
+
+    fprintf(f, "\n%-14s %12s %12s %8s %12s %12s %8s\n", "region",
+            "code-hit", "code-miss", "code%", "sys-hit", "sys-miss", "sys%");
+    for (i = 0; i < G_N_ELEMENTS(regions); i++) {
+        cache_region *r = &regions[i];
+
+        fprintf(f, "%-14s %12" PRIu64 " %12" PRIu64 " %7.2f%% "
+                "%12" PRIu64 " %12" PRIu64 " %7.2f%%\n", r->name,
+                r->hits[CACHE_CODE], r->misses[CACHE_CODE],
+                cache_rate(r->hits[CACHE_CODE], r->misses[CACHE_CODE]),
+                r->hits[CACHE_SYS], r->misses[CACHE_SYS],
+                cache_rate(r->hits[CACHE_SYS], r->misses[CACHE_SYS]));
+    }
+
+    if (have_symtab) {
+        sorted = g_ptr_array_new();
+        for (i = 0; i < symtab.nsyms; i++) {
+            cache_func *fn = &funcs[i];
+
+            if (fn->hits[CACHE_CODE] + fn->misses[CACHE_CODE] +
+                fn->hits[CACHE_SYS] + fn->misses[CACHE_SYS]) {
+                g_ptr_array_add(sorted, fn);
+            }
+        }
+        g_ptr_array_sort(sorted, cache_func_cmp);
+
+        fprintf(f, "\n%-32s %12s %12s %8s %12s %12s %8s\n", "function",
+                "code-hit", "code-miss", "code%", "sys-hit", "sys-miss",
+                "sys%");
+        for (i = 0; i < sorted->len; i++) {
+            cache_func *fn = g_ptr_array_index(sorted, i);
+
+            fprintf(f, "%-32s %12" PRIu64 " %12" PRIu64 " %7.2f%% "
+                    "%12" PRIu64 " %12" PRIu64 " %7.2f%%\n", fn->sym->name,
+                    fn->hits[CACHE_CODE], fn->misses[CACHE_CODE],
+                    cache_rate(fn->hits[CACHE_CODE], fn->misses[CACHE_CODE]),
+                    fn->hits[CACHE_SYS], fn->misses[CACHE_SYS],
+                    cache_rate(fn->hits[CACHE_SYS], fn->misses[CACHE_SYS]));
+        }
+        g_ptr_array_free(sorted, true);
+    }
+
+    if (f != stderr) {
+        fclose(f);
+    }
+}
+
+static bool parse_u32(const char *arg, const char *key, uint32_t *val)
+{
+    size_t len = strlen(key);
+
+    if (strncmp(arg, key, len) || arg[len] != '=') {
+        return false;
+    }
+    *val = g_ascii_strtoull(arg + len + 1, NULL, 0);
+    return true;
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *elf = NULL;
+    size_t i;
+    int c;
+
+    for (i = 0; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "elf=")) {
+            elf = argv[i] + 4;
+        } else if (g_str_has_prefix(argv[i], "out=")) {
+            out_file = argv[i] + 4;
+        } else if (!parse_u32(argv[i], "vcpu", &sim_vcpu) &&
+                   !parse_u32(argv[i], "csize", &caches[CACHE_CODE].size) &&
+                   !parse_u32(argv[i], "cways", &caches[CACHE_CODE].ways) &&
+                   !parse_u32(argv[i], "cline", &caches[CACHE_CODE].line) &&
+                   !parse_u32(argv[i], "ssize", &caches[CACHE_SYS].size) &&
+                   !parse_u32(argv[i], "sways", &caches[CACHE_SYS].ways) &&
+                   !parse_u32(argv[i], "sline", &caches[CACHE_SYS].line)) {
+            fprintf(stderr, "imx8ulp_cache: unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    for (c = 0; c < CACHE_NUM; c++) {
+        if (!cache_setup(&caches[c])) {
+            fprintf(stderr, "imx8ulp_cache: bad %s cache geometry\n",
+                    caches[c].name);
+            return -1;
+        }
+    }
+    if (elf) {
+        have_symtab = imx_elf_load_symtab(&symtab, elf);
+        if (!have_symtab) {
+            fprintf(stderr, "imx8ulp_cache: cannot read symbols from %s\n",
+                    elf);
+        } else {
+            funcs = g_new0(cache_func, symtab.nsyms);
+            for (i = 0; i < symtab.nsyms; i++) {
+                funcs[i].sym = &symtab.syms[i];
+            }
+        }
+    }
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * Translation block coverage for imx8ulp-m33 ROM and firmware.
+ *
+ * Build as a TCG plugin against qemu-plugin.h and load it with
+ *
+ *   -plugin libimx8ulp_cov.so,arg="file=cov.bin",arg="range=0x10000000+0x30000",
+ *           arg="elf=fw.elf",arg="lcov=fw.info"
+ *
+ * Every translated block gets a counter bumped by an inline add, so the
+ * execution fast path has no helper call.  At exit the instructions of
+ * every block that ran are set in a bitmap (one bit per halfword in each
+ * range) kept in a MAP_SHARED file.  Bits are set with atomic ORs, so
+ * parallel runs pointing at the same file merge into it.
+ *
+ * With elf= the merged bitmap is exported as an lcov tracefile.  There
+ * is no line table, so the DA "line" numbers are instruction addresses;
+ * use addr2line on the same ELF to map them to source.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <qemu-plugin.h>
+
+#include "imx8ulp_plugin_elf.h"
+
+#ifdef QEMU_PLUGIN_VERSION
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+#endif
+
+#define COV_MAGIC       0x31564f43385849ULL    //< "IX8COV1"
+#define COV_MAX_RANGES  8
+
+typedef struct {
+    uint64_t base;
+    uint64_t size;
+} cov_range;
+
+typedef struct {
+    uint64_t magic;
+    uint64_t nranges;
+    cov_range range[COV_MAX_RANGES];
+} cov_header;
+
+/* One per translated block, count is bumped inline on every execution */
+typedef struct {
+    uint64_t count;
+    uint32_t ninsns;
+    uint64_t vaddr[];
+} cov_tb;
+
+static cov_range ranges[COV_MAX_RANGES];
+static int nranges;
+static const char *cov_file = "imx8ulp-cov.bin";
+static const char *lcov_file;
+static imx_elf_symtab symtab;
+static bool have_symtab;
+
+static cov_header *cov_map;
+static size_t cov_map_size;
+static uint64_t *cov_bits[COV_MAX_RANGES];
+
+static GMutex tb_lock;
+static GPtrArray *tbs;
+
+static bool cov_addr_bit(uint64_t addr, int *r, uint64_t *bit)
+{
+    int i;
+
+    for (i = 0; i < nranges; i++) {
+        if (addr >= ranges[i].base && addr - ranges[i].base < ranges[i].size) {
+            *r = i;
+            *bit = (addr - ranges[i].base) >> 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool cov_test(uint64_t addr)
+{
+    uint64_t bit;
+    int r;
+
+    if (!cov_addr_bit(addr, &r, &bit)) {
+        return false;
+    }
+    return (__atomic_load_n(&cov_bits[r][bit / 64], __ATOMIC_RELAXED) >>
+            (bit % 64)) & 1;
+}
+
+static size_t cov_words(uint64_t size)
+{
+    return (size / 2 + 63) / 64;
+}
+
+static bool cov_open(void)
+{
+    struct stat st;
+    size_t off;
+    int fd, i;
+
+    cov_map_size = sizeof(cov_header);
+    for (i = 0; i < nranges; i++) {
+        cov_map_size += cov_words(ranges[i].size) * sizeof(uint64_t);
+    }
+
+    fd = open(cov_file, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "imx8ulp_cov: cannot open %s: %s\n",
+                cov_file, strerror(errno));
+        goto fail;
+    }
+    /* ftruncate() of a new file reads back as zero, i.e. nothing covered */
+    if (st.st_size == 0 && ftruncate(fd, cov_map_size) < 0) {
+        goto fail;
+    }
+    if (st.st_size != 0 && st.st_size != cov_map_size) {
+        fprintf(stderr, "imx8ulp_cov: %s has a different layout\n", cov_file);
+        goto fail;
+    }
+
+    cov_map = mmap(NULL, cov_map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    if (cov_map == MAP_FAILED) {
+        cov_map = NULL;
+        goto fail;
+    }
+    close(fd);
+
+    if (st.st_size == 0) {
+        cov_map->nranges = nranges;
+        memcpy(cov_map->range, ranges, sizeof(ranges));
+        __atomic_store_n(&cov_map->magic, COV_MAGIC, __ATOMIC_RELEASE);
+    } else if (cov_map->magic != COV_MAGIC || cov_map->nranges != nranges ||
+               memcmp(cov_map->range, ranges, sizeof(ranges))) {
+        fprintf(stderr, "imx8ulp_cov: %s was made with other ranges\n",
+                cov_file);
+        munmap(cov_map, cov_map_size);
+        cov_map = NULL;
+        return false;
+    }
+
+    off = sizeof(cov_header);
+    for (i = 0; i < nranges; i++) {
+        cov_bits[i] = (uint64_t *)((uint8_t *)cov_map + off);
+        off += cov_words(ranges[i].size) * sizeof(uint64_t);
+    }
+    return true;
+
+fail:
+    if (fd >= 0) {
+        close(fd);
+    }
+    return false;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    uint64_t bit;
+    cov_tb *rec;
+    size_t i;
+    int r;
+
+    if (!cov_addr_bit(pc, &r, &bit)) {
+        return;
+    }
+
+    rec = g_malloc0(sizeof(*rec) + n * sizeof(uint64_t));
+    rec->ninsns = n;
+    for (i = 0; i < n; i++) {
+        rec->vaddr[i] = qemu_plugin_insn_vaddr(qemu_plugin_tb_get_insn(tb, i));
+    }
+
+    g_mutex_lock(&tb_lock);
+    g_ptr_array_add(tbs, rec);
+    g_mutex_unlock(&tb_lock);
+
+    qemu_plugin_register_vcpu_tb_exec_inline(tb, QEMU_PLUGIN_INLINE_ADD_U64,
+                                             &rec->count, 1);
+}
+
+static void cov_flush(void)
+{
+    guint i;
+    uint32_t j;
+
+    for (i = 0; i < tbs->len; i++) {
+        cov_tb *rec = g_ptr_array_index(tbs, i);
+
+        if (!rec->count) {
+            continue;
+        }
+        for (j = 0; j < rec->ninsns; j++) {
+            uint64_t bit;
+            int r;
+
+            if (cov_addr_bit(rec->vaddr[j], &r, &bit)) {
+                __atomic_fetch_or(&cov_bits[r][bit / 64],
+                                  1ULL << (bit % 64), __ATOMIC_RELAXED);
+            }
+        }
+    }
+    msync(cov_map, cov_map_size, MS_SYNC);
+}
+
+/*
+ * Covered instruction starts of a function: walk it in halfwords, the
+ * bitmap only has bits where an instruction began.
+ */
+static void cov_write_lcov(void)
+{
+    FILE *f = fopen(lcov_file, "w");
+    unsigned fnf = 0, fnh = 0, lf = 0, lh = 0;
+    size_t i;
+
+    if (!f) {
+        fprintf(stderr, "imx8ulp_cov: cannot write %s\n", lcov_file);
+        return;
+    }
+
+    fprintf(f, "TN:imx8ulp\nSF:%s\n", symtab.path);
+    for (i = 0; i < symtab.nsyms; i++) {
+        const imx_elf_sym *s = &symtab.syms[i];
+        int r;
+        uint64_t bit;
+
+        if (!cov_addr_bit(s->addr, &r, &bit)) {
+            continue;
+        }
+        fprintf(f, "FN:%" PRIu64 ",%s\n", s->addr, s->name);
+    }
+    for (i = 0; i < symtab.nsyms; i++) {
+        const imx_elf_sym *s = &symtab.syms[i];
+        uint64_t end = s->size ? s->addr + s->size : s->addr + 2;
+        uint64_t a, hits = 0;
+        int r;
+        uint64_t bit;
+
+        if (!cov_addr_bit(s->addr, &r, &bit)) {
+            continue;
+        }
+        for (a = s->addr; a < end; a += 2) {
+            hits += cov_test(a);
+        }
+        fprintf(f, "FNDA:%" PRIu64 ",%s\n", hits, s->name);
+        fnf++;
+        fnh += hits != 0;
+    }
+    fprintf(f, "FNF:%u\nFNH:%u\n", fnf, fnh);
+
+    for (i = 0; i < symtab.nsyms; i++) {
+        const imx_elf_sym *s = &symtab.syms[i];
+        uint64_t end = s->size ? s->addr + s->size : s->addr + 2;
+        uint64_t a;
+        bool any = false;
+        int r;
+        uint64_t bit;
+
+        if (!cov_addr_bit(s->addr, &r, &bit)) {
+            continue;
+        }
+        for (a = s->addr; a < end; a += 2) {
+            if (cov_test(a)) {
+                fprintf(f, "DA:%" PRIu64 ",1\n", a);
+                any = true;
+                lf++;
+                lh++;
+            }
+        }
+        if (!any) {
+            fprintf(f, "DA:%" PRIu64 ",0\n", s->addr);
+            lf++;
+        }
+    }
+    fprintf(f, "LF:%u\nLH:%u\nend_of_record\n", lf, lh);
+    fclose(f);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_mutex_lock(&tb_lock);
+    cov_flush();
+    g_mutex_unlock(&tb_lock);
+
+    if (lcov_file && have_symtab) {
+        cov_write_lcov();
+    }
+}
+
+static bool parse_range(const char *s)
+{
+    char *end;
+    uint64_t base, size;
+
+    base = g_ascii_strtoull(s, &end, 0);
+    if (*end != '+' || nranges == COV_MAX_RANGES) {
+        return false;
+    }
+    size = g_ascii_strtoull(end + 1, &end, 0);
+    if (*end || !size) {
+        return false;
+    }
+    ranges[nranges].base = base & ~1ULL;
+    ranges[nranges].size = size;
+    nranges++;
+    return true;
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *elf = NULL;
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "file=")) {
+            cov_file = argv[i] + 5;
+        } else if (g_str_has_prefix(argv[i], "range=")) {
+            if (!parse_range(argv[i] + 6)) {
+                fprintf(stderr, "imx8ulp_cov: bad range %s\n", argv[i] + 6);
+                return -1;
+            }
+        } else if (g_str_has_prefix(argv[i], "elf=")) {
+            elf = argv[i] + 4;
+        } else if (g_str_has_prefix(argv[i], "lcov=")) {
+            lcov_file = argv[i] + 5;
+        } else {
+            fprintf(stderr, "imx8ulp_cov: unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    /* Default to the boot ROM */
+    if (!nranges) {
+        parse_range("0x10000000+0x30000");
+    }
+    if (elf) {
+        have_symtab = imx_elf_load_symtab(&symtab, elf);
+        if (!have_symtab) {
+            fprintf(stderr, "imx8ulp_cov: cannot read symbols from %s\n", elf);
+        }
+    }
+    if (!cov_open()) {
+        return -1;
+    }
+
+    tbs = g_ptr_array_new();
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
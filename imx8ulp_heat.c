@@ -0,0 +1,401 @@
+/*
+ * Memory access heatmap and SSRAM placement advisor for imx8ulp-m33.
+ *
+ * Build as a TCG plugin against qemu-plugin.h and load it with
+ *
+ *   -plugin libimx8ulp_heat.so,arg="elf=fw.elf",arg="out=heat.txt",
+ *           arg="sample=16"
+ *
+ * Code is counted with an inline counter per translated block, at no
+ * helper call cost; each execution adds the block's instruction count
+ * to its function and page.  Data accesses go through a memory callback
+ * that only records one access in sample= (default 1, every access) and
+ * scales it back up in the report.  vCPUs run the callback concurrently
+ * under MTTCG, so its counters are bumped with atomic adds.
+ *
+ * The report lists the hottest pages (page=, default 1024 bytes) of
+ * each region, the symbols ranked by accesses per byte, and a placement
+ * that fills the fast SSRAMs from make_mpc() with the densest symbols
+ * first.  The regions come from imx_ssram_map[], the table the board
+ * builds them from.  fast=name:base+size replaces the default fast ones.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qemu-plugin.h>
+
+#include "imx8ulp_memmap.h"
+#include "imx8ulp_plugin_elf.h"
+
+#ifdef QEMU_PLUGIN_VERSION
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+#endif
+
+#define HEAT_MAX_REGIONS    8
+#define HEAT_TOP_PAGES      16
+
+typedef struct {
+    char *name;
+    uint64_t base;
+    uint64_t size;
+    bool fast;              /* placement target */
+    uint64_t *pages;        /* accesses per page */
+    uint64_t used;          /* placement fill */
+} heat_region;
+
+/* One per translated block, count is bumped inline on every execution */
+typedef struct {
+    uint64_t count;
+    uint64_t vaddr;
+    uint32_t ninsns;
+    int sym;                /* -1 without a symbol */
+} heat_tb;
+
+typedef struct {
+    const imx_elf_sym *sym;
+    uint64_t accesses;
+    heat_region *home;
+} heat_sym;
+
+static heat_region regions[HEAT_MAX_REGIONS];
+static int nregions;
+static bool fast_given;
+static uint32_t page_size = 1024;
+static uint32_t sample = 1;
+static uint64_t mem_seen;   /* data accesses, for sampling */
+static const char *out_file;
+
+static imx_elf_symtab symtab;
+static bool have_symtab;
+static uint64_t *sym_data;  /* sampled data accesses per symbol */
+
+static GMutex tb_lock;
+static GPtrArray *tbs;
+
+static heat_region *heat_add_region(const char *name, uint64_t base,
+                                    uint64_t size, bool fast)
+{
+    heat_region *r;
+
+    if (nregions == HEAT_MAX_REGIONS) {
+        return NULL;
+    }
+    r = &regions[nregions++];
+    r->name = g_strdup(name);
+    r->base = base;
+    r->size = size;
+    r->fast = fast;
+    return r;
+}
+
+static heat_region *heat_add_mem(const imx_mem_region *m, bool fast)
+{
+    return heat_add_region(m->name, m->base, m->size, fast);
+}
+
+static heat_region *heat_find_region(uint64_t addr)
+{
+    int i;
+
+    for (i = 0; i < nregions; i++) {
+        if (addr - regions[i].base < regions[i].size) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+static int heat_find_sym(uint64_t addr)
+{
+    const imx_elf_sym *s;
+
+    if (!have_symtab) {
+        return -1;
+    }
+    s = imx_elf_lookup(&symtab, addr);
+    return s ? s - symtab.syms : -1;
+}
+
+static void vcpu_mem(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
+                     uint64_t vaddr, void *udata)
+{
+    heat_region *r;
+    int sym;
+
+    if (sample > 1 &&
+        __atomic_add_fetch(&mem_seen, 1, __ATOMIC_RELAXED) % sample) {
+        return;
+    }
+
+    r = heat_find_region(vaddr);
+    if (!r) {
+        return;
+    }
+    __atomic_add_fetch(&r->pages[(vaddr - r->base) / page_size], sample,
+                       __ATOMIC_RELAXED);
+    sym = heat_find_sym(vaddr);
+    if (sym >= 0) {
+        __atomic_add_fetch(&sym_data[sym], sample, __ATOMIC_RELAXED);
+    }
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    heat_tb *rec;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        qemu_plugin_register_vcpu_mem_cb(qemu_plugin_tb_get_insn(tb, i),
+                                         vcpu_mem, QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, NULL);
+    }
+
+    if (!heat_find_region(pc)) {
+        return;
+    }
+    rec = g_new0(heat_tb, 1);
+    rec->vaddr = pc;
+    rec->ninsns = n;
+    rec->sym = heat_find_sym(pc);
+
+    g_mutex_lock(&tb_lock);
+    g_ptr_array_add(tbs, rec);
+    g_mutex_unlock(&tb_lock);
+
+    qemu_plugin_register_vcpu_tb_exec_inline(tb, QEMU_PLUGIN_INLINE_ADD_U64,
+                                             &rec->count, 1);
+}
+
+static gint heat_u64_desc(gconstpointer a, gconstpointer b, gpointer data)
+{
+    const uint64_t *pages = data;
+    uint64_t ca = pages[*(const uint32_t *)a];
+    uint64_t cb = pages[*(const uint32_t *)b];
+
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static double heat_density(const heat_sym *s)
+{
+    return (double)s->accesses / (s->sym->size ? s->sym->size : 1);
+}
+
+static gint heat_sym_desc(gconstpointer a, gconstpointer b)
+{
+    double da = heat_density(*(heat_sym * const *)a);
+    double db = heat_density(*(heat_sym * const *)b);
+
+    return da < db ? 1 : da > db ? -1 : 0;
+}
+
+static void heat_report_pages(FILE *f)
+{
+    int i;
+
+    for (i = 0; i < nregions; i++) {
+        heat_region *r = &regions[i];
+        uint32_t npages = (r->size + page_size - 1) / page_size, j;
+        uint32_t *order = g_new(uint32_t, npages);
+        uint64_t total = 0;
+
+        for (j = 0; j < npages; j++) {
+            order[j] = j;
+            total += r->pages[j];
+        }
+        g_qsort_with_data(order, npages, sizeof(uint32_t), heat_u64_desc,
+                          r->pages);
+
+        fprintf(f, "%s 0x%08" PRIx64 "+0x%" PRIx64 "%s: %" PRIu64
+                " accesses\n", r->name, r->base, r->size,
+                r->fast ? " (fast)" : "", total);
+        for (j = 0; j < npages && j < HEAT_TOP_PAGES && r->pages[order[j]];
+             j++) {
+            fprintf(f, "  0x%08" PRIx64 " %12" PRIu64 "\n",
+                    r->base + (uint64_t)order[j] * page_size,
+                    r->pages[order[j]]);
+        }
+        g_free(order);
+    }
+}
+
+/*
+ * Greedy by density: every symbol with accesses goes to the first fast
+ * region it still fits in, the rest stay in or move to the slow ones.
+ */
+static void heat_report_symbols(FILE *f, GPtrArray *syms)
+{
+    guint i;
+    int j;
+
+    fprintf(f, "\n%-32s %10s %14s %10s %-10s %s\n", "symbol", "size",
+            "accesses", "per-byte", "now", "suggested");
+    for (i = 0; i < syms->len; i++) {
+        heat_sym *s = g_ptr_array_index(syms, i);
+        heat_region *to = NULL;
+
+        for (j = 0; j < nregions; j++) {
+            heat_region *r = &regions[j];
+
+            if (r->fast && r->used + s->sym->size <= r->size) {
+                r->used += s->sym->size;
+                to = r;
+                break;
+            }
+        }
+        fprintf(f, "%-32s %10" PRIu64 " %14" PRIu64 " %10.1f %-10s %s\n",
+                s->sym->name, s->sym->size, s->accesses, heat_density(s),
+                s->home->name, to ? to->name : "-");
+    }
+
+    fprintf(f, "\n");
+    for (j = 0; j < nregions; j++) {
+        if (regions[j].fast) {
+            fprintf(f, "%s: %" PRIu64 " of %" PRIu64 " bytes suggested\n",
+                    regions[j].name, regions[j].used, regions[j].size);
+        }
+    }
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    FILE *f = out_file ? fopen(out_file, "w") : stderr;
+    uint64_t *sym_code = have_symtab ? g_new0(uint64_t, symtab.nsyms) : NULL;
+    GPtrArray *syms;
+    heat_sym *hs;
+    size_t i;
+
+    if (!f) {
+        fprintf(stderr, "imx8ulp_heat: cannot write %s\n", out_file);
+        return;
+    }
+
+    /* Fold the block counters into pages and symbols */
+    g_mutex_lock(&tb_lock);
+    for (i = 0; i < tbs->len; i++) {
+        heat_tb *rec = g_ptr_array_index(tbs, i);
+        heat_region *r = heat_find_region(rec->vaddr);
+        uint64_t n = rec->count * rec->ninsns;
+
+        r->pages[(rec->vaddr - r->base) / page_size] += n;
+        if (rec->sym >= 0) {
+            sym_code[rec->sym] += n;
+        }
+    }
+    g_mutex_unlock(&tb_lock);
+
+    heat_report_pages(f);
+
+    if (have_symtab) {
+        hs = g_new0(heat_sym, symtab.nsyms);
+        syms = g_ptr_array_new();
+        for (i = 0; i < symtab.nsyms; i++) {
+            hs[i].sym = &symtab.syms[i];
+            hs[i].accesses = sym_code[i] + sym_data[i];
+            hs[i].home = heat_find_region(hs[i].sym->addr);
+            if (hs[i].accesses && hs[i].sym->size && hs[i].home) {
+                g_ptr_array_add(syms, &hs[i]);
+            }
+        }
+        g_ptr_array_sort(syms, heat_sym_desc);
+        heat_report_symbols(f, syms);
+        g_ptr_array_free(syms, true);
+        g_free(hs);
+        g_free(sym_code);
+    }
+
+    if (f != stderr) {
+        fclose(f);
+    }
+}
+
+static bool parse_fast(const char *s)
+{
+    char *name, *end;
+    const char *colon = strchr(s, ':');
+    uint64_t base, size;
+
+    if (!colon) {
+        return false;
+    }
+    base = g_ascii_strtoull(colon + 1, &end, 0);
+    if (*end != '+') {
+        return false;
+    }
+    size = g_ascii_strtoull(end + 1, &end, 0);
+    if (*end || !size) {
+        return false;
+    }
+    name = g_strndup(s, colon - s);
+    if (!fast_given) {
+        /* The first fast= drops the defaults */
+        nregions = 0;
+        fast_given = true;
+    }
+    heat_add_region(name, base, size, true);
+    g_free(name);
+    return true;
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *elf = NULL;
+    int i;
+
+    /* TCM first for code */
+    heat_add_mem(&imx_ssram_map[IMX_SSRAM_TCM], true);
+    heat_add_mem(&imx_ssram_map[IMX_SSRAM_SYS], true);
+
+    for (i = 0; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "elf=")) {
+            elf = argv[i] + 4;
+        } else if (g_str_has_prefix(argv[i], "out=")) {
+            out_file = argv[i] + 4;
+        } else if (g_str_has_prefix(argv[i], "page=")) {
+            page_size = g_ascii_strtoull(argv[i] + 5, NULL, 0);
+        } else if (g_str_has_prefix(argv[i], "sample=")) {
+            sample = g_ascii_strtoull(argv[i] + 7, NULL, 0);
+        } else if (g_str_has_prefix(argv[i], "fast=")) {
+            if (!parse_fast(argv[i] + 5)) {
+                fprintf(stderr, "imx8ulp_heat: bad region %s\n", argv[i] + 5);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "imx8ulp_heat: unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (!page_size || (page_size & (page_size - 1)) || !sample) {
+        fprintf(stderr, "imx8ulp_heat: page must be a power of two, "
+                "sample at least 1\n");
+        return -1;
+    }
+
+    /* Everything that is not placed in a fast region lives here */
+    heat_add_mem(&imx_ssram_map[IMX_SSRAM_ROM], false);
+    heat_add_region("psram", IMX_PSRAM_START, IMX_PSRAM_SIZE, false);
+    for (i = 0; i < nregions; i++) {
+        regions[i].pages = g_new0(uint64_t,
+                                  (regions[i].size + page_size - 1) /
+                                  page_size);
+    }
+
+    if (elf) {
+        have_symtab = imx_elf_load_symbols(&symtab, elf, true);
+        if (!have_symtab) {
+            fprintf(stderr, "imx8ulp_heat: cannot read symbols from %s\n",
+                    elf);
+        } else {
+            sym_data = g_new0(uint64_t, symtab.nsyms);
+        }
+    }
+
+    tbs = g_ptr_array_new();
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
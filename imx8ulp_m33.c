@@ -84,9 +84,266 @@ static void verilog_debug_do_print(uint32_t addr)
     }
 }
 
+/*
+ * File commands move test vectors between guest RAM and files under the
+ * "dir" property.  The address written in the second phase points to
+ *
+ *   struct { uint32_t arg[3]; int32_t result; uint32_t done; }
+ *
+ * FOPEN:  arg0 = path (relative, no "..", no symlinks), arg1 = 0 read /
+ *         1 write (create, truncate) / 2 append; result = handle
+ * FREAD, FWRITE: arg0 = handle, arg1 = buffer, arg2 = length;
+ *         result = bytes moved, a short count when the buffer is not
+ *         all RAM or at end of file
+ * FCLOSE: arg0 = handle; -EBUSY while async I/O on it is in flight
+ *
+ * Negative results are -errno.  The buffer is mapped and moved with one
+ * read()/write() straight into guest RAM.  With VERILOG_ASYNC in the
+ * third write, FREAD/FWRITE run in the thread pool and the guest keeps
+ * running; done becomes 1 and the IRQ pulses when they finish.  Reset
+ * waits for those and closes every handle.
+ */
+#define VERILOG_ARG_RESULT  12
+#define VERILOG_ARG_DONE    16
+#define VERILOG_PATH_MAX    256
+
+typedef struct {
+    verilog_debug_state *s;
+    uint32_t desc;
+    uint32_t handle;
+    int fd;
+    void *buf;
+    hwaddr len;
+    bool to_guest;              /* FREAD: the file fills guest RAM */
+    ssize_t ret;
+} verilog_debug_io;
+
+static void verilog_debug_finish(verilog_debug_state *s, uint32_t desc,
+        int32_t result)
+{
+    uint32_t done = 1;
+
+    cpu_physical_memory_write(desc + VERILOG_ARG_RESULT, &result, 4);
+    cpu_physical_memory_write(desc + VERILOG_ARG_DONE, &done, 4);
+}
+
+/*
+ * Walk path one component at a time from dir, refusing ".." and symlinks
+ * at every level, so nothing can lead outside dir.
+ */
+static int verilog_debug_open(verilog_debug_state *s, uint32_t path_addr,
+        uint32_t mode)
+{
+    static const int flags[] = {
+        O_RDONLY,
+        O_WRONLY | O_CREAT | O_TRUNC,
+        O_WRONLY | O_CREAT | O_APPEND,
+    };
+    char path[VERILOG_PATH_MAX];
+    char **parts;
+    int i, slot, dfd, fd;
+
+    if (s->dirfd < 0 || mode >= ARRAY_SIZE(flags)) {
+        return -EINVAL;
+    }
+    cpu_physical_memory_read(path_addr, path, sizeof(path));
+    path[sizeof(path) - 1] = 0;
+    if (path[0] == '/' || !path[0]) {
+        return -EACCES;
+    }
+
+    for (slot = 0; slot < VERILOG_MAX_FILES && s->fds[slot] >= 0; slot++) {
+    }
+    if (slot == VERILOG_MAX_FILES) {
+        return -EMFILE;
+    }
+
+    parts = g_strsplit(path, "/", -1);
+    dfd = s->dirfd;
+    fd = -EACCES;
+    for (i = 0; parts[i]; i++) {
+        const char *name = parts[i];
+        bool last = !parts[i + 1];
+        int next;
+
+        if (!strcmp(name, "..")) {
+            fd = -EACCES;
+            break;
+        }
+        if (!*name) {
+            /* "a//b", or a trailing "/" that leaves no file name */
+            if (last) {
+                fd = -EISDIR;
+                break;
+            }
+            continue;
+        }
+        if (last) {
+            fd = openat(dfd, name, flags[mode] | O_NOFOLLOW | O_CLOEXEC,
+                        0644);
+            fd = fd < 0 ? -errno : fd;
+            break;
+        }
+        next = openat(dfd, name,
+                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (next < 0) {
+            fd = -errno;
+            break;
+        }
+        if (dfd != s->dirfd) {
+            close(dfd);
+        }
+        dfd = next;
+    }
+    if (dfd != s->dirfd) {
+        close(dfd);
+    }
+    g_strfreev(parts);
+
+    if (fd < 0) {
+        return fd;
+    }
+    s->fds[slot] = fd;
+    return slot;
+}
+
+static void verilog_debug_io_run(verilog_debug_io *io)
+{
+    io->ret = io->to_guest ? read(io->fd, io->buf, io->len) :
+                             write(io->fd, io->buf, io->len);
+    if (io->ret < 0) {
+        io->ret = -errno;
+    }
+}
+
+static int verilog_debug_io_worker(void *opaque)
+{
+    verilog_debug_io_run(opaque);
+    return 0;
+}
+
+static void verilog_debug_io_done(verilog_debug_io *io)
+{
+    address_space_unmap(&address_space_memory, io->buf, io->len,
+                        io->to_guest, io->ret > 0 ? io->ret : 0);
+    verilog_debug_finish(io->s, io->desc, io->ret);
+}
+
+static void verilog_debug_io_complete(void *opaque, int ret)
+{
+    verilog_debug_io *io = opaque;
+
+    io->s->pending[io->handle]--;
+    io->s->inflight--;
+    verilog_debug_io_done(io);
+    qemu_irq_pulse(io->s->irq);
+    g_free(io);
+}
+
+static void verilog_debug_do_io(verilog_debug_state *s, uint32_t desc,
+        bool to_guest, bool async)
+{
+    uint32_t arg[3];
+    verilog_debug_io *io;
+
+    cpu_physical_memory_read(desc, arg, sizeof(arg));
+    if (arg[0] >= VERILOG_MAX_FILES || s->fds[arg[0]] < 0) {
+        verilog_debug_finish(s, desc, -EBADF);
+        return;
+    }
+    /* address_space_map() fails for an empty buffer, nothing to move */
+    if (!arg[2]) {
+        verilog_debug_finish(s, desc, 0);
+        if (async) {
+            qemu_irq_pulse(s->irq);
+        }
+        return;
+    }
+
+    io = g_new0(verilog_debug_io, 1);
+    io->s = s;
+    io->desc = desc;
+    io->handle = arg[0];
+    io->fd = s->fds[arg[0]];
+    io->len = arg[2];
+    io->to_guest = to_guest;
+    io->buf = address_space_map(&address_space_memory, arg[1], &io->len,
+                                to_guest, MEMTXATTRS_UNSPECIFIED);
+    if (!io->buf) {
+        verilog_debug_finish(s, desc, -EFAULT);
+        g_free(io);
+        return;
+    }
+
+    if (async) {
+        s->pending[io->handle]++;
+        s->inflight++;
+        thread_pool_submit_aio(aio_get_thread_pool(qemu_get_aio_context()),
+                               verilog_debug_io_worker, io,
+                               verilog_debug_io_complete, io);
+        return;
+    }
+    verilog_debug_io_run(io);
+    verilog_debug_io_done(io);
+    g_free(io);
+}
+
+static void verilog_debug_do_file(verilog_debug_state *s, uint32_t cmd,
+        uint32_t desc, uint32_t flags)
+{
+    uint32_t arg[2];
+    int32_t ret = 0;
+
+    switch (cmd) {
+    case VERILOG_FOPEN:
+        cpu_physical_memory_read(desc, arg, sizeof(arg));
+        ret = verilog_debug_open(s, arg[0], arg[1]);
+        break;
+    case VERILOG_FREAD:
+    case VERILOG_FWRITE:
+        verilog_debug_do_io(s, desc, cmd == VERILOG_FREAD,
+                            flags & VERILOG_ASYNC);
+        return;
+    case VERILOG_FCLOSE:
+        cpu_physical_memory_read(desc, arg, 4);
+        if (arg[0] >= VERILOG_MAX_FILES || s->fds[arg[0]] < 0) {
+            ret = -EBADF;
+            break;
+        }
+        if (s->pending[arg[0]]) {
+            ret = -EBUSY;
+            break;
+        }
+        close(s->fds[arg[0]]);
+        s->fds[arg[0]] = -1;
+        break;
+    }
+    verilog_debug_finish(s, desc, ret);
+}
+
+/*
+ * A run ends as soon as the guest reports, unless it asks to defer to
+ * AHAB_RESET; see imx_test_status.h.
+ */
+static int imx_test_code;
+
+static void verilog_debug_do_exit(uint32_t status, uint32_t counters)
+{
+    if ((status >> 16) != TEST_STATUS_MAGIC) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad status word 0x%x\n",
+                      __func__, status);
+        return;
+    }
+    imx_test_code = status & 0xFF;
+    if (!(status & TEST_STATUS_DEFER)) {
+        imx_test_status_exit(imx_test_code, counters);
+    }
+}
+
 static void verilog_debug_write(void *opaque, hwaddr offset,
         uint64_t value, unsigned size)
 {
+    verilog_debug_state *s = opaque;
     static uint32_t cmd_phase = 0;
     static uint32_t cmd_type = 0;
     static uint32_t addr = 0;
@@ -104,6 +361,15 @@ static void verilog_debug_write(void *opaque, hwaddr offset,
         case VERILOG_PRINT:
             verilog_debug_do_print(addr);
             break;
+        case VERILOG_FOPEN:
+        case VERILOG_FREAD:
+        case VERILOG_FWRITE:
+        case VERILOG_FCLOSE:
+            verilog_debug_do_file(s, cmd_type, addr, value);
+            break;
+        case VERILOG_EXIT:
+            verilog_debug_do_exit(addr, value);
+            break;
         default:
             break;
         }
@@ -116,13 +382,56 @@ static void verilog_debug_init(Object *obj)
 
     memory_region_init_io(&s->iomem, obj, &verilog_debug_ops, s, TYPE_VERILOG_DEBUG, 0x10);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+}
+
+static void verilog_debug_realize(DeviceState *dev, Error **errp)
+{
+    verilog_debug_state *s = VERILOG_DEBUG(dev);
+    int i;
+
+    for (i = 0; i < VERILOG_MAX_FILES; i++) {
+        s->fds[i] = -1;
+    }
+    s->dirfd = -1;
+    if (s->dir) {
+        s->dirfd = qemu_open(s->dir, O_RDONLY | O_DIRECTORY);
+        if (s->dirfd < 0) {
+            error_setg_errno(errp, errno, "%s: cannot open %s",
+                             TYPE_VERILOG_DEBUG, s->dir);
+        }
+    }
+}
+
+static void verilog_debug_reset(DeviceState *dev)
+{
+    verilog_debug_state *s = VERILOG_DEBUG(dev);
+    int i;
+
+    /* Completions run from the main loop, which is this thread */
+    while (s->inflight) {
+        aio_poll(qemu_get_aio_context(), true);
+    }
+    for (i = 0; i < VERILOG_MAX_FILES; i++) {
+        if (s->fds[i] >= 0) {
+            close(s->fds[i]);
+            s->fds[i] = -1;
+        }
+    }
 }
 
+static Property verilog_debug_properties[] = {
+    DEFINE_PROP_STRING("dir", verilog_debug_state, dir),
+    DEFINE_PROP_END_OF_LIST(),
+};
 
 static void verilog_debug_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
+    dc->realize = verilog_debug_realize;
+    dc->reset = verilog_debug_reset;
     dc->vmsd = &verilog_debug_vm;
+    dc->props = verilog_debug_properties;
 }
 
 static const TypeInfo verilog_debug_info = {
@@ -202,6 +511,313 @@ static void imx_fsb_types(void)
 
 type_init(imx_fsb_types)
 
+/*=======================================
+    OCOTP Module Start
+ ========================================*/
+/*
+ * Fuse programming in the style of the i.MX OCOTP.  Put the word index
+ * in CTRL.ADDR and the 0x3E77 key in CTRL.WR_UNLOCK, then write DATA:
+ * the bits are ORed into the fuse, they can never be cleared.  Fuse
+ * words 0 and 1 are lock fuses, bit n locks bank n (8 words) against
+ * programming.  CTRL.RELOAD_SHADOWS copies the words programmed since
+ * the last reload into the FSB shadows.
+ *
+ * With a "file" the fuses are a MAP_SHARED mapping of it, so programmed
+ * fuses survive the run.  A new file starts from the run.arg fuses, an
+ * existing one replaces them.
+ */
+#define OCOTP_CTRL              0x00
+#define OCOTP_CTRL_SET          0x04
+#define OCOTP_CTRL_CLR          0x08
+#define OCOTP_CTRL_TOG          0x0C
+#define OCOTP_TIMING            0x10
+#define OCOTP_DATA              0x20
+#define OCOTP_READ_CTRL         0x30
+#define OCOTP_READ_FUSE_DATA    0x40
+#define OCOTP_LOCK0             0x400
+#define OCOTP_LOCK1             0x404
+
+#define OCOTP_CTRL_ADDR_MASK    0x1FF
+#define OCOTP_CTRL_BUSY         (1 << 12)
+#define OCOTP_CTRL_ERROR        (1 << 13)
+#define OCOTP_CTRL_RELOAD       (1 << 14)
+#define OCOTP_CTRL_UNLOCK_SHIFT 16
+#define OCOTP_CTRL_UNLOCK_KEY   0x3E77
+#define OCOTP_READ_FUSE         (1 << 0)
+
+#define OCOTP_BANK_WORDS        8
+
+static bool imx_ocotp_locked(imx_ocotp_state *s, uint32_t word)
+{
+    uint32_t bank = word / OCOTP_BANK_WORDS;
+
+    return (s->fuse[bank / 32] >> (bank % 32)) & 1;
+}
+
+static void imx_ocotp_sync(imx_ocotp_state *s, uint32_t word)
+{
+    uintptr_t page = qemu_real_host_page_size;
+    uintptr_t addr = (uintptr_t)&s->fuse[word] & ~(page - 1);
+
+    if (s->file) {
+        msync((void *)addr, page, MS_SYNC);
+    }
+}
+
+static void imx_ocotp_program(imx_ocotp_state *s, uint32_t value)
+{
+    uint32_t word = s->ctrl & OCOTP_CTRL_ADDR_MASK;
+
+    if ((s->ctrl >> OCOTP_CTRL_UNLOCK_SHIFT) != OCOTP_CTRL_UNLOCK_KEY ||
+        imx_ocotp_locked(s, word)) {
+        s->ctrl |= OCOTP_CTRL_ERROR;
+        return;
+    }
+    /* The key is good for one write */
+    s->ctrl &= ~(0xFFFFu << OCOTP_CTRL_UNLOCK_SHIFT);
+
+    if ((s->fuse[word] | value) != s->fuse[word]) {
+        s->fuse[word] |= value;
+        g_imx8ulp_arg.fuse[word] = s->fuse[word];
+        set_bit(word, s->dirty);
+        imx_ocotp_sync(s, word);
+    }
+}
+
+static void imx_ocotp_reload(imx_ocotp_state *s)
+{
+    long word;
+
+    for (word = find_first_bit(s->dirty, IMX_FUSE_WORDS);
+         word < IMX_FUSE_WORDS;
+         word = find_next_bit(s->dirty, IMX_FUSE_WORDS, word + 1)) {
+        imx_fsb_reload_word(s->fsb, word, s->fuse[word]);
+    }
+    bitmap_zero(s->dirty, IMX_FUSE_WORDS);
+}
+
+static void imx_ocotp_write_ctrl(imx_ocotp_state *s, uint32_t value)
+{
+    /* ERROR is only cleared through CTRL_CLR */
+    s->ctrl = (value & ~(OCOTP_CTRL_BUSY | OCOTP_CTRL_ERROR)) |
+              (s->ctrl & OCOTP_CTRL_ERROR);
+    if (s->ctrl & OCOTP_CTRL_RELOAD) {
+        imx_ocotp_reload(s);
+        s->ctrl &= ~OCOTP_CTRL_RELOAD;
+    }
+}
+
+static uint64_t imx_ocotp_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_ocotp_state *s = (imx_ocotp_state *)opaque;
+
+    switch (offset) {
+    case OCOTP_CTRL:
+    case OCOTP_CTRL_SET:
+    case OCOTP_CTRL_CLR:
+    case OCOTP_CTRL_TOG:
+        return s->ctrl;
+    case OCOTP_TIMING:
+        return s->timing;
+    case OCOTP_READ_FUSE_DATA:
+        return s->read_data;
+    case OCOTP_LOCK0:
+        return s->fuse[0];
+    case OCOTP_LOCK1:
+        return s->fuse[1];
+    }
+    return 0;
+}
+
+static void imx_ocotp_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_ocotp_state *s = (imx_ocotp_state *)opaque;
+
+    switch (offset) {
+    case OCOTP_CTRL:
+        imx_ocotp_write_ctrl(s, value);
+        break;
+    case OCOTP_CTRL_SET:
+        imx_ocotp_write_ctrl(s, s->ctrl | value);
+        break;
+    case OCOTP_CTRL_CLR:
+        s->ctrl &= ~value;
+        break;
+    case OCOTP_CTRL_TOG:
+        imx_ocotp_write_ctrl(s, s->ctrl ^ value);
+        break;
+    case OCOTP_TIMING:
+        s->timing = value;
+        break;
+    case OCOTP_DATA:
+        imx_ocotp_program(s, value);
+        break;
+    case OCOTP_READ_CTRL:
+        if (value & OCOTP_READ_FUSE) {
+            s->read_data = s->fuse[s->ctrl & OCOTP_CTRL_ADDR_MASK];
+        }
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n", __func__,
+                (uint32_t)offset);
+        break;
+    }
+}
+
+static const MemoryRegionOps imx_ocotp_ops = {
+    .read = imx_ocotp_read,
+    .write = imx_ocotp_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static bool imx_ocotp_map_file(imx_ocotp_state *s, Error **errp)
+{
+    size_t len = IMX_FUSE_WORDS * sizeof(uint32_t);
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    fd = qemu_open(s->file, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) < 0 ||
+        (st.st_size < len && ftruncate(fd, len) < 0)) {
+        error_setg_errno(errp, errno, "%s: cannot open %s",
+                         TYPE_IMX_OCOTP, s->file);
+        if (fd >= 0) {
+            qemu_close(fd);
+        }
+        return false;
+    }
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    qemu_close(fd);
+    if (ptr == MAP_FAILED) {
+        error_setg_errno(errp, errno, "%s: cannot map %s",
+                         TYPE_IMX_OCOTP, s->file);
+        return false;
+    }
+    s->fuse = ptr;
+
+    if (st.st_size == 0) {
+        memcpy(s->fuse, g_imx8ulp_arg.fuse, len);
+        msync(s->fuse, len, MS_SYNC);
+    } else {
+        memcpy(g_imx8ulp_arg.fuse, s->fuse, len);
+    }
+    return true;
+}
+
+static void imx_ocotp_realize(DeviceState *dev, Error **errp)
+{
+    imx_ocotp_state *s = IMX_OCOTP(dev);
+    uint32_t word;
+
+    if (!s->fsb) {
+        error_setg(errp, "%s: fsb link not set", TYPE_IMX_OCOTP);
+        return;
+    }
+    if (!s->file) {
+        s->fuse = g_imx8ulp_arg.fuse;
+        return;
+    }
+    if (!imx_ocotp_map_file(s, errp)) {
+        return;
+    }
+    /* The FSB was filled from run.arg; fix up what the file changed */
+    for (word = 0; word < IMX_FUSE_WORDS; word++) {
+        imx_fsb_reload_word(s->fsb, word, s->fuse[word]);
+    }
+}
+
+static void imx_ocotp_init(Object *obj)
+{
+    imx_ocotp_state *s = IMX_OCOTP(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_ocotp_ops, s,
+            TYPE_IMX_OCOTP, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    s->num_fuse = IMX_FUSE_WORDS;
+    s->dirty_bits = IMX_FUSE_WORDS;
+    s->dirty = bitmap_new(IMX_FUSE_WORDS);
+}
+
+static void imx_ocotp_reset(DeviceState *dev)
+{
+    imx_ocotp_state *s = IMX_OCOTP(dev);
+
+    /* A reset reloads the shadows; only programmed words can differ */
+    if (s->fuse) {
+        imx_ocotp_reload(s);
+    }
+    s->ctrl = 0;
+    s->timing = 0;
+    s->read_data = 0;
+}
+
+/*
+ * The fuse words go along too: without a file they only live in this
+ * process, and the dirty bits refer to them.  With a file both ends map
+ * the same one, so loading writes back what is already there.
+ */
+static int imx_ocotp_post_load(void *opaque, int version_id)
+{
+    imx_ocotp_state *s = opaque;
+
+    if (s->fuse != g_imx8ulp_arg.fuse) {
+        memcpy(g_imx8ulp_arg.fuse, s->fuse, IMX_FUSE_WORDS * sizeof(uint32_t));
+    }
+    return 0;
+}
+
+static const VMStateDescription imx_ocotp_vm = {
+    .name = TYPE_IMX_OCOTP,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = imx_ocotp_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_VARRAY_UINT32(fuse, imx_ocotp_state, num_fuse, 0,
+                vmstate_info_uint32, uint32_t),
+        VMSTATE_BITMAP(dirty, imx_ocotp_state, 0, dirty_bits),
+        VMSTATE_UINT32(ctrl, imx_ocotp_state),
+        VMSTATE_UINT32(timing, imx_ocotp_state),
+        VMSTATE_UINT32(read_data, imx_ocotp_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static Property imx_ocotp_properties[] = {
+    DEFINE_PROP_LINK("fsb", imx_ocotp_state, fsb, TYPE_IMX_FSB,
+            imx_fsb_state *),
+    DEFINE_PROP_STRING("file", imx_ocotp_state, file),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_ocotp_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_ocotp_realize;
+    dc->reset = imx_ocotp_reset;
+    dc->vmsd = &imx_ocotp_vm;
+    dc->props = imx_ocotp_properties;
+}
+
+static const TypeInfo imx_ocotp_info = {
+    .name          = TYPE_IMX_OCOTP,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_ocotp_state),
+    .instance_init = imx_ocotp_init,
+    .class_init    = imx_ocotp_class_init,
+};
+
+static void imx_ocotp_types(void)
+{
+    type_register_static(&imx_ocotp_info);
+}
+
+type_init(imx_ocotp_types)
+
 /*=======================================
     S400 MU Start
  ========================================*/
@@ -240,14 +856,247 @@ static const MemoryRegionOps imx_s400_mu_ops = {
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
+/*
+ * AHAB messages.  The header word is tag[31:24] cmd[23:16] size[15:8]
+ * ver[7:0], size counting the header; the command runs once all of its
+ * words are in TR.  The response goes to RR.
+ */
+#define AHAB_VERSION            0x06
+#define AHAB_RESP_TAG           0xe1
+#define AHAB_SUCCESS            0xd6
+#define AHAB_FAILURE            0x29
+
+#define AHAB_AUTH_CONTAINER     0x87
+#define AHAB_VERIFY_IMAGE       0x88
+#define AHAB_RELEASE_CONTAINER  0x89
+#define AHAB_RESET              0xc7
+
+/* Failure reasons, reported in bits [15:8] of the status word */
+#define AHAB_BAD_HEADER         0x01
+#define AHAB_BAD_SIGNATURE      0x02
+#define AHAB_BAD_HASH           0x03
+#define AHAB_NO_CONTAINER       0x04
+
+#define AHAB_CONTAINER_TAG      0x87
+#define AHAB_SIGBLK_TAG         0x90
+#define AHAB_SRK_TABLE_TAG      0xd7
+#define AHAB_SIGNATURE_TAG      0xd8
+#define AHAB_HDR_SIZE           16
+#define AHAB_IMG_SIZE           128
+#define AHAB_MAX_CONTAINER      0x2000
+
+static const MemTxAttrs imx_s400_attrs = { .secure = 1 };
+
+static void imx_s400_mu_respond(imx_s400_mu_state *mu, uint32_t cmd,
+        uint32_t status, uint32_t data)
+{
+    int size = cmd == AHAB_VERIFY_IMAGE ? 3 : 2;
+
+    mu->rr[0] = (AHAB_RESP_TAG << 24) | (cmd << 16) | (size << 8) |
+        AHAB_VERSION;
+    mu->rr[1] = status;
+    mu->rr[2] = data;
+}
+
+/*
+ * Hash guest memory in place: map it in as few pieces as possible and
+ * only bounce through a buffer when address_space_map() cannot help.
+ */
+static bool imx_s400_hash_guest(QCryptoHashAlgorithm alg, hwaddr addr,
+        hwaddr len, uint8_t **digest, size_t *digest_len)
+{
+    GArray *iov = g_array_new(false, false, sizeof(struct iovec));
+    GArray *mapped = g_array_new(false, false, sizeof(bool));
+    bool ok = true;
+    guint i;
+
+    while (len) {
+        struct iovec v;
+        hwaddr plen = len;
+        bool is_mapped = true;
+
+        v.iov_base = address_space_map(&address_space_memory, addr, &plen,
+                false, imx_s400_attrs);
+        if (!v.iov_base) {
+            plen = MIN(len, TARGET_PAGE_SIZE);
+            v.iov_base = g_malloc(plen);
+            is_mapped = false;
+            if (address_space_read(&address_space_memory, addr,
+                        imx_s400_attrs, v.iov_base, plen) != MEMTX_OK) {
+                g_free(v.iov_base);
+                ok = false;
+                break;
+            }
+        }
+        v.iov_len = plen;
+        g_array_append_val(iov, v);
+        g_array_append_val(mapped, is_mapped);
+        addr += plen;
+        len -= plen;
+    }
+
+    if (ok && qcrypto_hash_bytesv(alg, (struct iovec *)iov->data, iov->len,
+                digest, digest_len, NULL) < 0) {
+        ok = false;
+    }
+
+    for (i = 0; i < iov->len; i++) {
+        struct iovec *v = &g_array_index(iov, struct iovec, i);
+
+        if (g_array_index(mapped, bool, i)) {
+            address_space_unmap(&address_space_memory, v->iov_base,
+                    v->iov_len, false, v->iov_len);
+        } else {
+            g_free(v->iov_base);
+        }
+    }
+    g_array_free(iov, true);
+    g_array_free(mapped, true);
+    return ok;
+}
+
+static void imx_s400_release_container(imx_s400_mu_state *mu)
+{
+    g_free(mu->container);
+    mu->container = NULL;
+    mu->container_len = 0;
+    mu->auth_status = 0;
+}
+
+/*
+ * QEMU's crypto layer has no ECDSA/RSA, so the signature itself is not
+ * checked: only the signature block, SRK table and signature records
+ * are validated, which is what a board in the OEM open lifecycle relies
+ * on.  The expensive part left is image hashing, see VERIFY_IMAGE.
+ */
+static uint32_t imx_s400_check_signature(const uint8_t *c, uint32_t len)
+{
+    uint32_t sig = lduw_le_p(c + 12);
+    uint32_t srk, sign;
+
+    if (sig < AHAB_HDR_SIZE || sig + 16 > len ||
+            c[sig + 3] != AHAB_SIGBLK_TAG) {
+        return AHAB_BAD_SIGNATURE;
+    }
+    srk = sig + lduw_le_p(c + sig + 6);
+    sign = sig + lduw_le_p(c + sig + 8);
+    if (srk + 4 > len || c[srk] != AHAB_SRK_TABLE_TAG ||
+            sign + 4 > len || c[sign + 3] != AHAB_SIGNATURE_TAG) {
+        return AHAB_BAD_SIGNATURE;
+    }
+    return 0;
+}
+
+static uint32_t imx_s400_auth_container(imx_s400_mu_state *mu, hwaddr addr)
+{
+    uint8_t hdr[AHAB_HDR_SIZE];
+    uint32_t len, reason;
+
+    imx_s400_release_container(mu);
+
+    if (address_space_read(&address_space_memory, addr, imx_s400_attrs,
+                hdr, sizeof(hdr)) != MEMTX_OK ||
+            hdr[3] != AHAB_CONTAINER_TAG) {
+        return AHAB_FAILURE | (AHAB_BAD_HEADER << 8);
+    }
+    len = lduw_le_p(hdr + 1);
+    if (len < AHAB_HDR_SIZE + hdr[11] * AHAB_IMG_SIZE ||
+            len > AHAB_MAX_CONTAINER) {
+        return AHAB_FAILURE | (AHAB_BAD_HEADER << 8);
+    }
+
+    mu->container = g_malloc(len);
+    mu->container_len = len;
+    if (address_space_read(&address_space_memory, addr, imx_s400_attrs,
+                mu->container, len) != MEMTX_OK) {
+        imx_s400_release_container(mu);
+        return AHAB_FAILURE | (AHAB_BAD_HEADER << 8);
+    }
+
+    reason = imx_s400_check_signature(mu->container, len);
+    mu->auth_status = reason ? AHAB_FAILURE | (reason << 8) : AHAB_SUCCESS;
+    return mu->auth_status;
+}
+
+/*
+ * Hash the loaded images in mask against the container's digests.  The
+ * images are in guest memory and may have changed since the last call,
+ * so every request hashes them again.
+ */
+static uint32_t imx_s400_verify_image(imx_s400_mu_state *mu, uint32_t mask,
+        uint32_t *checked)
+{
+    uint32_t num, i;
+
+    *checked = 0;
+    if (mu->auth_status != AHAB_SUCCESS) {
+        return AHAB_FAILURE | (AHAB_NO_CONTAINER << 8);
+    }
+
+    num = mu->container[11];
+    for (i = 0; i < num && i < 32; i++) {
+        const uint8_t *img = mu->container + AHAB_HDR_SIZE + i * AHAB_IMG_SIZE;
+        QCryptoHashAlgorithm alg;
+        uint8_t *digest;
+        size_t digest_len;
+        bool match;
+
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+
+        switch (extract32(ldl_le_p(img + 24), 8, 3)) {
+        case 0:
+            alg = QCRYPTO_HASH_ALG_SHA256;
+            break;
+        case 1:
+            alg = QCRYPTO_HASH_ALG_SHA384;
+            break;
+        default:
+            alg = QCRYPTO_HASH_ALG_SHA512;
+            break;
+        }
+        if (!imx_s400_hash_guest(alg, ldq_le_p(img + 8), ldl_le_p(img + 4),
+                    &digest, &digest_len)) {
+            return AHAB_FAILURE | (AHAB_BAD_HASH << 8);
+        }
+        match = !memcmp(digest, img + 32, digest_len);
+        g_free(digest);
+        if (!match) {
+            return AHAB_FAILURE | (AHAB_BAD_HASH << 8);
+        }
+        *checked |= 1u << i;
+    }
+    return AHAB_SUCCESS;
+}
+
 static void imx_s400_mu_handle_cmd(imx_s400_mu_state *mu)
 {
     uint32_t cid = 0;
+    uint32_t status, checked = 0;
+
     cid = (mu->tr[0] & 0x00ff0000) >> 16;
-    printf("%s tr[0]:%x\n", __func__, mu->tr[0]);
-    if (cid == 0xc7) {
+    switch (cid) {
+    case AHAB_AUTH_CONTAINER:
+        status = imx_s400_auth_container(mu,
+                ((uint64_t)mu->tr[1] << 32) | mu->tr[2]);
+        imx_s400_mu_respond(mu, cid, status, 0);
+        break;
+    case AHAB_VERIFY_IMAGE:
+        status = imx_s400_verify_image(mu, mu->tr[1], &checked);
+        imx_s400_mu_respond(mu, cid, status, checked);
+        break;
+    case AHAB_RELEASE_CONTAINER:
+        imx_s400_release_container(mu);
+        imx_s400_mu_respond(mu, cid, AHAB_SUCCESS, 0);
+        break;
+    case AHAB_RESET:
         printf("%s AHAB_RESET\n", __func__);
-        exit(0);
+        imx_test_status_exit(imx_test_code, 0);
+    default:
+        qemu_log_mask(LOG_UNIMP, "%s: command 0x%x\n", __func__, cid);
+        imx_s400_mu_respond(mu, cid, AHAB_FAILURE, 0);
+        break;
     }
 }
 
@@ -272,9 +1121,15 @@ static void imx_s400_mu_write(void *opaque, hwaddr offset,
         uint64_t value, unsigned size)
 {
     imx_s400_mu_state *mu = (imx_s400_mu_state *)opaque;
+    uint32_t idx, msg_size;
 
     if ((offset >= 0x200) && (offset <= 0x21C)) {
-        imx_s400_mu_handle_cmd(mu);
+        idx = (offset - 0x200) / 4;
+        mu->tr[idx] = value;
+        msg_size = extract32(mu->tr[0], 8, 8);
+        if (idx == 0 ? msg_size <= 1 : idx == msg_size - 1) {
+            imx_s400_mu_handle_cmd(mu);
+        }
     }
 }
 
@@ -351,6 +1206,18 @@ static uint64_t imx_sim0_read(void *opaque, hwaddr offset,
         ret = 0xFFFFFFFF;
     } else if ((offset >= 0x10) && (offset < 0x34)) {
         ret = sim0->dgo_gp[(offset - 0x10) / 4];
+    } else if (offset == 0x34) {
+        ret = sim0->sysctrl0;
+    } else if (offset == 0x38) {
+        ret = sim0->ssram_acc_dis;
+    } else if (offset == 0x3C) {
+        ret = sim0->rtd_sysctrl0;
+    } else if (offset == 0x40) {
+        ret = sim0->lpav_per_dom_ctrl;
+    } else if (offset == 0x44) {
+        ret = sim0->lpav_mst_alo_ctrl;
+    } else if (offset == 0x48) {
+        ret = sim0->lpav_slv_alo_ctrl;
     } else {
         ret = 0;
     }
@@ -364,6 +1231,19 @@ static void imx_sim0_write(void *opaque, hwaddr offset,
 
     if ((offset >= 0x10) && (offset < 0x34)) {
         sim0->dgo_gp[(offset - 0x10) / 4] = value;
+    } else if (offset == 0x34) {
+        sim0->sysctrl0 = value;
+    } else if (offset == 0x38) {
+        /* Stored only; the SSRAM MPC path does not enforce it */
+        sim0->ssram_acc_dis = value;
+    } else if (offset == 0x3C) {
+        sim0->rtd_sysctrl0 = value;
+    } else if (offset == 0x40) {
+        sim0->lpav_per_dom_ctrl = value;
+    } else if (offset == 0x44) {
+        sim0->lpav_mst_alo_ctrl = value;
+    } else if (offset == 0x48) {
+        sim0->lpav_slv_alo_ctrl = value;
     }
 }
 
@@ -464,45 +1344,5310 @@ static void imx_tstmr_types(void)
 type_init(imx_tstmr_types)
 
 /*=======================================
-    ARG Module Start
+    LPUART Module Start
  ========================================*/
-imx8ulp_arg_t g_imx8ulp_arg;
+#define LPUART_VERID        0x00
+#define LPUART_PARAM        0x04
+#define LPUART_GLOBAL       0x08
+#define LPUART_PINCFG       0x0C
+#define LPUART_BAUD         0x10
+#define LPUART_STAT         0x14
+#define LPUART_CTRL         0x18
+#define LPUART_DATA         0x1C
+#define LPUART_MATCH        0x20
+#define LPUART_MODIR        0x24
+#define LPUART_FIFO         0x28
+#define LPUART_WATER        0x2C
+
+#define LPUART_GLOBAL_RST   (1 << 1)
+
+#define LPUART_STAT_TDRE    (1 << 23)
+#define LPUART_STAT_TC      (1 << 22)
+#define LPUART_STAT_RDRF    (1 << 21)
+#define LPUART_STAT_IDLE    (1 << 20)
+#define LPUART_STAT_OR      (1 << 19)
+#define LPUART_STAT_W1C     0xC01FC000
+#define LPUART_STAT_RO      (LPUART_STAT_TDRE | LPUART_STAT_TC | \
+                             LPUART_STAT_RDRF | (1 << 24))
+
+#define LPUART_BAUD_SBNS    (1 << 13)
+
+#define LPUART_CTRL_ORIE    (1 << 27)
+#define LPUART_CTRL_TIE     (1 << 23)
+#define LPUART_CTRL_TCIE    (1 << 22)
+#define LPUART_CTRL_RIE     (1 << 21)
+#define LPUART_CTRL_ILIE    (1 << 20)
+#define LPUART_CTRL_TE      (1 << 19)
+#define LPUART_CTRL_RE      (1 << 18)
+#define LPUART_CTRL_M7      (1 << 11)
+#define LPUART_CTRL_M       (1 << 4)
+#define LPUART_CTRL_PE      (1 << 1)
+#define LPUART_CTRL_PT      (1 << 0)
+
+#define LPUART_DATA_RXEMPT  (1 << 12)
+
+#define LPUART_FIFO_TXEMPT  (1 << 23)
+#define LPUART_FIFO_RXEMPT  (1 << 22)
+#define LPUART_FIFO_TXOF    (1 << 17)
+#define LPUART_FIFO_RXUF    (1 << 16)
+#define LPUART_FIFO_TXFLUSH (1 << 15)
+#define LPUART_FIFO_RXFLUSH (1 << 14)
+#define LPUART_FIFO_TXFE    (1 << 7)
+#define LPUART_FIFO_RXFE    (1 << 3)
+#define LPUART_FIFO_RW      0x0000FF88
+
+static uint64_t imx_lpuart_read(void *opaque, hwaddr offset,
+                                   unsigned size);
+static void imx_lpuart_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size);
 
-static void imx8ulp_arg_handle_fuse(char *fuse_str);
-static uint32_t imx8ulp_arg_hex2dec(char *hex);
+static const VMStateDescription imx_lpuart_vm = {
+    .name = TYPE_IMX_LPUART,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(global, imx_lpuart_state),
+        VMSTATE_UINT32(pincfg, imx_lpuart_state),
+        VMSTATE_UINT32(baud, imx_lpuart_state),
+        VMSTATE_UINT32(stat, imx_lpuart_state),
+        VMSTATE_UINT32(ctrl, imx_lpuart_state),
+        VMSTATE_UINT32(match, imx_lpuart_state),
+        VMSTATE_UINT32(modir, imx_lpuart_state),
+        VMSTATE_UINT32(fifo, imx_lpuart_state),
+        VMSTATE_UINT32(water, imx_lpuart_state),
+        VMSTATE_UINT8_ARRAY(tx_fifo, imx_lpuart_state, IMX_LPUART_FIFO_MAX),
+        VMSTATE_UINT32(tx_head, imx_lpuart_state),
+        VMSTATE_UINT32(tx_count, imx_lpuart_state),
+        VMSTATE_UINT8_ARRAY(rx_fifo, imx_lpuart_state, IMX_LPUART_FIFO_MAX),
+        VMSTATE_UINT32(rx_head, imx_lpuart_state),
+        VMSTATE_UINT32(rx_count, imx_lpuart_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const MemoryRegionOps imx_lpuart_ops = {
+    .read = imx_lpuart_read,
+    .write = imx_lpuart_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+/* FIFO.xXFIFOSIZE encoding: 0 is one dataword, n is 2^(n+1) datawords */
+static uint32_t imx_lpuart_fifo_size_field(uint32_t depth)
+{
+    return depth == 1 ? 0 : ctz32(depth) - 1;
+}
+
+static uint32_t imx_lpuart_rx_depth(imx_lpuart_state *s)
+{
+    return (s->fifo & LPUART_FIFO_RXFE) ? s->rxfifo_depth : 1;
+}
+
+/* Number of TX bytes the guest can see, only non-zero under backpressure */
+static uint32_t imx_lpuart_tx_visible(imx_lpuart_state *s)
+{
+    return s->watch_tag ? s->tx_count : 0;
+}
+
+static void imx_lpuart_update(imx_lpuart_state *s)
+{
+    uint32_t txcount = imx_lpuart_tx_visible(s);
+    bool level;
+
+    s->stat &= ~(LPUART_STAT_TDRE | LPUART_STAT_TC | LPUART_STAT_RDRF);
+    if (txcount <= (s->water & 0xFF)) {
+        s->stat |= LPUART_STAT_TDRE;
+    }
+    if (txcount == 0) {
+        s->stat |= LPUART_STAT_TC;
+    }
+    if (s->rx_count > ((s->water >> 16) & 0xFF)) {
+        s->stat |= LPUART_STAT_RDRF;
+    }
+
+    level = ((s->ctrl & LPUART_CTRL_TIE) && (s->stat & LPUART_STAT_TDRE)) ||
+            ((s->ctrl & LPUART_CTRL_TCIE) && (s->stat & LPUART_STAT_TC)) ||
+            ((s->ctrl & LPUART_CTRL_RIE) && (s->stat & LPUART_STAT_RDRF)) ||
+            ((s->ctrl & LPUART_CTRL_ILIE) && (s->stat & LPUART_STAT_IDLE)) ||
+            ((s->ctrl & LPUART_CTRL_ORIE) && (s->stat & LPUART_STAT_OR));
+    qemu_set_irq(s->irq, level);
+}
+
+/* Pass the line settings on, so a host serial port runs at the guest baud */
+static void imx_lpuart_update_params(imx_lpuart_state *s)
+{
+    QEMUSerialSetParams ssp;
+    uint32_t sbr = extract32(s->baud, 0, 13);
+    uint32_t osr = extract32(s->baud, 24, 5);
+
+    if (!s->clk_freq || !sbr) {
+        return;
+    }
+    /* OSR values 1 and 2 are reserved and behave like the default 16x */
+    osr = osr < 3 ? 16 : osr + 1;
+
+    ssp.speed = s->clk_freq / (osr * sbr);
+    if (s->ctrl & LPUART_CTRL_PE) {
+        ssp.parity = (s->ctrl & LPUART_CTRL_PT) ? 'O' : 'E';
+    } else {
+        ssp.parity = 'N';
+    }
+    if (s->ctrl & LPUART_CTRL_M7) {
+        ssp.data_bits = 7;
+    } else if (s->ctrl & LPUART_CTRL_M) {
+        ssp.data_bits = 9;
+    } else {
+        ssp.data_bits = 8;
+    }
+    ssp.stop_bits = (s->baud & LPUART_BAUD_SBNS) ? 2 : 1;
+    qemu_chr_fe_ioctl(&s->chr, CHR_IOCTL_SERIAL_SET_PARAMS, &ssp);
+}
+
+static void imx_lpuart_clk_changed(Notifier *n, void *data)
+{
+    imx_lpuart_state *s = container_of(n, imx_lpuart_state, clk_notifier);
+
+    s->clk_freq = *(uint32_t *)data;
+    imx_lpuart_update_params(s);
+}
+
+static gboolean imx_lpuart_tx_watch(GIOChannel *chan, GIOCondition cond,
+                                    void *opaque);
+
+/* Hand everything queued in the TX FIFO to the chardev */
+static void imx_lpuart_tx_drain(imx_lpuart_state *s)
+{
+    uint32_t depth = s->txfifo_depth;
+    int ret;
+
+    while (s->tx_count) {
+        uint32_t len = MIN(s->tx_count, depth - s->tx_head);
+
+        if (!qemu_chr_fe_backend_connected(&s->chr)) {
+            /* Nothing attached: the bytes just disappear down the wire */
+            ret = len;
+        } else {
+            ret = qemu_chr_fe_write(&s->chr, &s->tx_fifo[s->tx_head], len);
+        }
+        if (ret > 0) {
+            s->tx_head = (s->tx_head + ret) % depth;
+            s->tx_count -= ret;
+        }
+        if (ret < (int)len) {
+            break;
+        }
+    }
+
+    if (s->tx_count && !s->watch_tag) {
+        s->watch_tag = qemu_chr_fe_add_watch(&s->chr, G_IO_OUT | G_IO_HUP,
+                imx_lpuart_tx_watch, s);
+        if (!s->watch_tag) {
+            /* Backend cannot tell us when it drains, drop the data */
+            s->tx_head = 0;
+            s->tx_count = 0;
+        }
+    }
+    imx_lpuart_update(s);
+}
+
+static gboolean imx_lpuart_tx_watch(GIOChannel *chan, GIOCondition cond,
+                                    void *opaque)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+
+    s->watch_tag = 0;
+    imx_lpuart_tx_drain(s);
+    return FALSE;
+}
+
+/* Block until everything queued in the TX FIFO has gone out */
+static void imx_lpuart_tx_write_all(imx_lpuart_state *s)
+{
+    uint32_t depth = s->txfifo_depth;
+
+    while (s->tx_count) {
+        uint32_t len = MIN(s->tx_count, depth - s->tx_head);
+
+        if (qemu_chr_fe_backend_connected(&s->chr)) {
+            qemu_chr_fe_write_all(&s->chr, &s->tx_fifo[s->tx_head], len);
+        }
+        s->tx_head = (s->tx_head + len) % depth;
+        s->tx_count -= len;
+    }
+}
+
+/*
+ * Empty the TX queue for a reset or TXFLUSH.  Unless the chardev is
+ * pushing back, the guest has already seen these bytes as sent (TC set),
+ * so they still go out; under backpressure they are visible in TXCOUNT
+ * and are really flushed.
+ */
+static void imx_lpuart_tx_flush(imx_lpuart_state *s)
+{
+    if (s->watch_tag) {
+        g_source_remove(s->watch_tag);
+        s->watch_tag = 0;
+    } else {
+        imx_lpuart_tx_write_all(s);
+    }
+    s->tx_head = 0;
+    s->tx_count = 0;
+}
+
+/*
+ * A test status write ends the process from MMIO, before the BH or the
+ * chardev watch had a chance to run: write out whatever is still queued.
+ */
+static void imx_lpuart_exit(Notifier *n, void *data)
+{
+    imx_lpuart_state *s = container_of(n, imx_lpuart_state, exit_notifier);
+
+    if (s->watch_tag) {
+        g_source_remove(s->watch_tag);
+        s->watch_tag = 0;
+    }
+    imx_lpuart_tx_write_all(s);
+}
+
+static void imx_lpuart_tx_bh(void *opaque)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+
+    if (!s->watch_tag) {
+        imx_lpuart_tx_drain(s);
+    }
+}
+
+static void imx_lpuart_tx_push(imx_lpuart_state *s, uint8_t ch)
+{
+    uint32_t depth = s->txfifo_depth;
+
+    if (s->tx_count == depth) {
+        if (!s->watch_tag) {
+            imx_lpuart_tx_drain(s);
+        }
+        if (s->tx_count == depth) {
+            s->fifo |= LPUART_FIFO_TXOF;
+            return;
+        }
+    }
+
+    s->tx_fifo[(s->tx_head + s->tx_count) % depth] = ch;
+    s->tx_count++;
+    if (s->tx_count == depth && !s->watch_tag) {
+        imx_lpuart_tx_drain(s);
+    } else {
+        qemu_bh_schedule(s->tx_bh);
+    }
+}
+
+static uint32_t imx_lpuart_rx_pop(imx_lpuart_state *s)
+{
+    uint32_t ret;
+
+    if (s->rx_count == 0) {
+        s->fifo |= LPUART_FIFO_RXUF;
+        return LPUART_DATA_RXEMPT;
+    }
+
+    ret = s->rx_fifo[s->rx_head];
+    s->rx_head = (s->rx_head + 1) % s->rxfifo_depth;
+    s->rx_count--;
+    qemu_chr_fe_accept_input(&s->chr);
+    return ret;
+}
+
+static int imx_lpuart_can_receive(void *opaque)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+
+    if (!(s->ctrl & LPUART_CTRL_RE)) {
+        return 0;
+    }
+    return imx_lpuart_rx_depth(s) - MIN(s->rx_count, imx_lpuart_rx_depth(s));
+}
+
+static void imx_lpuart_receive(void *opaque, const uint8_t *buf, int size)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+    uint32_t depth = imx_lpuart_rx_depth(s);
+    int i;
+
+    for (i = 0; i < size; i++) {
+        if (s->rx_count >= depth) {
+            s->stat |= LPUART_STAT_OR;
+            break;
+        }
+        s->rx_fifo[(s->rx_head + s->rx_count) % s->rxfifo_depth] = buf[i];
+        s->rx_count++;
+    }
+    /* A chardev burst ends with the line going idle */
+    s->stat |= LPUART_STAT_IDLE;
+    imx_lpuart_update(s);
+}
+
+static void imx_lpuart_reset(DeviceState *dev)
+{
+    imx_lpuart_state *s = IMX_LPUART(dev);
+
+    s->global = 0;
+    s->pincfg = 0;
+    s->baud = 0x0F000004;
+    s->stat = 0;
+    s->ctrl = 0;
+    s->match = 0;
+    s->modir = 0;
+    s->fifo = (imx_lpuart_fifo_size_field(s->txfifo_depth) << 4) |
+              imx_lpuart_fifo_size_field(s->rxfifo_depth);
+    s->water = 0;
+    s->rx_head = 0;
+    s->rx_count = 0;
+    imx_lpuart_tx_flush(s);
+    imx_lpuart_update(s);
+}
+
+static uint64_t imx_lpuart_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+    uint64_t ret = 0;
+
+    switch (offset) {
+    case LPUART_VERID:
+        ret = 0x04010003;
+        break;
+    case LPUART_PARAM:
+        ret = (ctz32(s->rxfifo_depth) << 8) | ctz32(s->txfifo_depth);
+        break;
+    case LPUART_GLOBAL:
+        ret = s->global;
+        break;
+    case LPUART_PINCFG:
+        ret = s->pincfg;
+        break;
+    case LPUART_BAUD:
+        ret = s->baud;
+        break;
+    case LPUART_STAT:
+        ret = s->stat;
+        break;
+    case LPUART_CTRL:
+        ret = s->ctrl;
+        break;
+    case LPUART_DATA:
+        ret = imx_lpuart_rx_pop(s);
+        imx_lpuart_update(s);
+        break;
+    case LPUART_MATCH:
+        ret = s->match;
+        break;
+    case LPUART_MODIR:
+        ret = s->modir;
+        break;
+    case LPUART_FIFO:
+        ret = s->fifo;
+        if (imx_lpuart_tx_visible(s) == 0) {
+            ret |= LPUART_FIFO_TXEMPT;
+        }
+        if (s->rx_count == 0) {
+            ret |= LPUART_FIFO_RXEMPT;
+        }
+        break;
+    case LPUART_WATER:
+        ret = (s->water & 0x00FF00FF) |
+              (MIN(imx_lpuart_tx_visible(s), 0xFF) << 8) |
+              (MIN(s->rx_count, 0xFF) << 24);
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n",
+                      __func__, (uint32_t)offset);
+        break;
+    }
+    return ret;
+}
+
+static void imx_lpuart_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size)
+{
+    imx_lpuart_state *s = (imx_lpuart_state *)opaque;
+
+    switch (offset) {
+    case LPUART_GLOBAL:
+        s->global = value & LPUART_GLOBAL_RST;
+        if (s->global & LPUART_GLOBAL_RST) {
+            imx_lpuart_reset(DEVICE(s));
+            s->global = LPUART_GLOBAL_RST;
+        }
+        break;
+    case LPUART_PINCFG:
+        s->pincfg = value;
+        break;
+    case LPUART_BAUD:
+        s->baud = value;
+        imx_lpuart_update_params(s);
+        break;
+    case LPUART_STAT:
+        s->stat &= ~(value & LPUART_STAT_W1C);
+        s->stat = (s->stat & (LPUART_STAT_W1C | LPUART_STAT_RO)) |
+                  (value & ~(LPUART_STAT_W1C | LPUART_STAT_RO));
+        break;
+    case LPUART_CTRL:
+        s->ctrl = value;
+        if (s->ctrl & LPUART_CTRL_RE) {
+            qemu_chr_fe_accept_input(&s->chr);
+        }
+        imx_lpuart_update_params(s);
+        break;
+    case LPUART_DATA:
+        if (s->ctrl & LPUART_CTRL_TE) {
+            imx_lpuart_tx_push(s, value & 0xFF);
+        }
+        break;
+    case LPUART_MATCH:
+        s->match = value;
+        break;
+    case LPUART_MODIR:
+        s->modir = value;
+        break;
+    case LPUART_FIFO:
+        if (value & LPUART_FIFO_RXFLUSH) {
+            s->rx_head = 0;
+            s->rx_count = 0;
+            qemu_chr_fe_accept_input(&s->chr);
+        }
+        if (value & LPUART_FIFO_TXFLUSH) {
+            imx_lpuart_tx_flush(s);
+        }
+        s->fifo &= ~(value & (LPUART_FIFO_TXOF | LPUART_FIFO_RXUF));
+        s->fifo = (s->fifo & ~LPUART_FIFO_RW) | (value & LPUART_FIFO_RW);
+        break;
+    case LPUART_WATER:
+        s->water = value & 0x00FF00FF;
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n",
+                      __func__, (uint32_t)offset);
+        return;
+    }
+    imx_lpuart_update(s);
+}
+
+static void imx_lpuart_init(Object *obj)
+{
+    imx_lpuart_state *s = IMX_LPUART(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_lpuart_ops, s, TYPE_IMX_LPUART, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    s->clk_notifier.notify = imx_lpuart_clk_changed;
+}
+
+static bool imx_lpuart_depth_valid(uint32_t depth)
+{
+    return depth == 1 ||
+           (is_power_of_2(depth) && depth >= 4 && depth <= IMX_LPUART_FIFO_MAX);
+}
+
+static void imx_lpuart_realize(DeviceState *dev, Error **errp)
+{
+    imx_lpuart_state *s = IMX_LPUART(dev);
+
+    if (!imx_lpuart_depth_valid(s->txfifo_depth) ||
+        !imx_lpuart_depth_valid(s->rxfifo_depth)) {
+        error_setg(errp, "%s: FIFO depth must be 1 or a power of two "
+                   "between 4 and %d", TYPE_IMX_LPUART, IMX_LPUART_FIFO_MAX);
+        return;
+    }
+
+    s->tx_bh = qemu_bh_new(imx_lpuart_tx_bh, s);
+    qemu_chr_fe_set_handlers(&s->chr, imx_lpuart_can_receive,
+                             imx_lpuart_receive, NULL, NULL, s, NULL, true);
+    s->exit_notifier.notify = imx_lpuart_exit;
+    qemu_add_exit_notifier(&s->exit_notifier);
+}
+
+static Property imx_lpuart_properties[] = {
+    DEFINE_PROP_CHR("chardev", imx_lpuart_state, chr),
+    DEFINE_PROP_UINT32("txfifo-depth", imx_lpuart_state, txfifo_depth, 16),
+    DEFINE_PROP_UINT32("rxfifo-depth", imx_lpuart_state, rxfifo_depth, 16),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_lpuart_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_lpuart_realize;
+    dc->reset = imx_lpuart_reset;
+    dc->props = imx_lpuart_properties;
+    dc->vmsd = &imx_lpuart_vm;
+}
+
+static const TypeInfo imx_lpuart_info = {
+    .name          = TYPE_IMX_LPUART,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_lpuart_state),
+    .instance_init = imx_lpuart_init,
+    .class_init    = imx_lpuart_class_init,
+};
+
+static void imx_lpuart_types(void)
+{
+    type_register_static(&imx_lpuart_info);
+}
+
+type_init(imx_lpuart_types)
+
+/*=======================================
+    FlexSPI Module Start
+ ========================================*/
+#define FLEXSPI_MCR0        0x00
+#define FLEXSPI_INTEN       0x10
+#define FLEXSPI_INTR        0x14
+#define FLEXSPI_LUTKEY      0x18
+#define FLEXSPI_LUTCR       0x1C
+#define FLEXSPI_IPCR0       0xA0
+#define FLEXSPI_IPCR1       0xA4
+#define FLEXSPI_IPCMD       0xB0
+#define FLEXSPI_IPRXFCR     0xB8
+#define FLEXSPI_IPTXFCR     0xBC
+#define FLEXSPI_STS0        0xE0
+#define FLEXSPI_IPRXFSTS    0xF0
+#define FLEXSPI_IPTXFSTS    0xF4
+#define FLEXSPI_RFDR        0x100
+#define FLEXSPI_TFDR        0x180
+#define FLEXSPI_LUT         0x200
+
+#define FLEXSPI_MCR0_SWRESET    (1 << 0)
+#define FLEXSPI_INTR_IPCMDDONE  (1 << 0)
+#define FLEXSPI_INTR_IPCMDGE    (1 << 1)
+#define FLEXSPI_INTR_IPCMDERR   (1 << 3)
+#define FLEXSPI_INTR_IPRXWA     (1 << 5)
+#define FLEXSPI_INTR_IPTXWE     (1 << 6)
+#define FLEXSPI_LUTKEY_VALUE    0x5AF05AF0
+#define FLEXSPI_LUTCR_LOCK      (1 << 0)
+#define FLEXSPI_LUTCR_UNLOCK    (1 << 1)
+#define FLEXSPI_STS0_IDLE       0x3
+
+/* LUT instruction opcodes */
+#define FLEXSPI_INSTR_STOP      0x00
+#define FLEXSPI_INSTR_CMD_SDR   0x01
+#define FLEXSPI_INSTR_CMD_DDR   0x21
+#define FLEXSPI_INSTR_WRITE_SDR 0x08
+#define FLEXSPI_INSTR_WRITE_DDR 0x28
+#define FLEXSPI_INSTR_READ_SDR  0x09
+#define FLEXSPI_INSTR_READ_DDR  0x29
+#define FLEXSPI_INSTR_JMP_ON_CS 0x1F
+
+/* Serial NOR status register */
+#define NOR_SR_WIP              (1 << 0)
+#define NOR_SR_WEL              (1 << 1)
+
+static uint64_t imx_flexspi_read(void *opaque, hwaddr offset,
+                                   unsigned size);
+static void imx_flexspi_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size);
+
+static const VMStateDescription imx_flexspi_vm = {
+    .name = TYPE_IMX_FLEXSPI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(reg, imx_flexspi_state, 64),
+        VMSTATE_UINT32_ARRAY(lut, imx_flexspi_state, IMX_FLEXSPI_LUT_NUM),
+        VMSTATE_UINT32_ARRAY(tfdr, imx_flexspi_state, IMX_FLEXSPI_FIFO_WORDS),
+        VMSTATE_UINT8_ARRAY(rx_buf, imx_flexspi_state, IMX_FLEXSPI_DATA_MAX),
+        VMSTATE_UINT32(rx_len, imx_flexspi_state),
+        VMSTATE_UINT32(rx_pos, imx_flexspi_state),
+        VMSTATE_UINT8_ARRAY(tx_buf, imx_flexspi_state, IMX_FLEXSPI_DATA_MAX),
+        VMSTATE_UINT32(tx_len, imx_flexspi_state),
+        VMSTATE_UINT8(pend_opcode, imx_flexspi_state),
+        VMSTATE_UINT32(pend_addr, imx_flexspi_state),
+        VMSTATE_UINT32(pend_size, imx_flexspi_state),
+        VMSTATE_UINT8(nor_sr, imx_flexspi_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const MemoryRegionOps imx_flexspi_ops = {
+    .read = imx_flexspi_read,
+    .write = imx_flexspi_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static uint32_t imx_flexspi_rx_wmrk(imx_flexspi_state *s)
+{
+    return (((s->reg[FLEXSPI_IPRXFCR / 4] >> 2) & 0x7F) + 1) * 8;
+}
+
+static uint32_t imx_flexspi_tx_wmrk(imx_flexspi_state *s)
+{
+    return (((s->reg[FLEXSPI_IPTXFCR / 4] >> 2) & 0x7F) + 1) * 8;
+}
+
+static void imx_flexspi_update(imx_flexspi_state *s)
+{
+    uint32_t *intr = &s->reg[FLEXSPI_INTR / 4];
+    uint32_t avail = s->rx_len - s->rx_pos;
+
+    /*
+     * The whole IP read was copied in one go, so the watermark is met
+     * until the guest has popped everything.
+     */
+    if (avail) {
+        *intr |= FLEXSPI_INTR_IPRXWA;
+    } else {
+        *intr &= ~FLEXSPI_INTR_IPRXWA;
+    }
+    if (s->pend_size && s->tx_len < s->pend_size) {
+        *intr |= FLEXSPI_INTR_IPTXWE;
+    } else {
+        *intr &= ~FLEXSPI_INTR_IPTXWE;
+    }
+    qemu_set_irq(s->irq, !!(*intr & s->reg[FLEXSPI_INTEN / 4]));
+}
+
+/*
+ * Update the array through the XIP window so stale TBs get dropped, and
+ * write a writable image through so the change persists.
+ */
+static void imx_flexspi_array_write(imx_flexspi_state *s, uint32_t addr,
+                                    const uint8_t *buf, uint32_t len)
+{
+    address_space_write_rom(&address_space_memory, s->xip_base + addr,
+                            MEMTXATTRS_UNSPECIFIED, buf, len);
+    if (s->image_fd >= 0 && pwrite(s->image_fd, buf, len, addr) != len) {
+        error_report("%s: cannot write %s: %s", TYPE_IMX_FLEXSPI, s->image,
+                     strerror(errno));
+    }
+}
+
+static void imx_flexspi_erase(imx_flexspi_state *s, uint32_t addr,
+                              uint32_t len)
+{
+    uint32_t chunk = MIN(len, 64 * KiB);
+    uint8_t *ff = g_malloc(chunk);
+
+    memset(ff, 0xFF, chunk);
+    addr &= ~(len - 1) & (s->flash_size - 1);
+    while (len) {
+        imx_flexspi_array_write(s, addr, ff, chunk);
+        addr += chunk;
+        len -= chunk;
+    }
+    g_free(ff);
+}
+
+static void imx_flexspi_program(imx_flexspi_state *s)
+{
+    uint32_t page = s->pend_addr & ~0xFF;
+    uint32_t len = MIN(s->pend_size, s->tx_len);
+    uint8_t buf[256];
+    uint32_t i;
+
+    /* Page program wraps inside the 256 byte page, bits only go 1 -> 0 */
+    memcpy(buf, s->storage + page, sizeof(buf));
+    for (i = 0; i < len; i++) {
+        buf[(s->pend_addr + i) & 0xFF] &= s->tx_buf[i];
+    }
+    imx_flexspi_array_write(s, page, buf, sizeof(buf));
+
+    s->nor_sr &= ~NOR_SR_WEL;
+    s->pend_size = 0;
+    s->tx_len = 0;
+    s->reg[FLEXSPI_INTR / 4] |= FLEXSPI_INTR_IPCMDDONE;
+}
+
+static void imx_flexspi_do_read(imx_flexspi_state *s, uint8_t opcode,
+                                uint32_t addr, uint32_t len)
+{
+    uint32_t i;
+
+    s->rx_pos = 0;
+    s->rx_len = len;
+
+    switch (opcode) {
+    case 0x03: case 0x0B: case 0x0C: case 0x13: case 0x3B: case 0x3C:
+    case 0x6B: case 0x6C: case 0xBB: case 0xBC: case 0xEB: case 0xEC:
+    case 0xEE:
+        /* Array read: one bulk copy, wrapping at the end of the device */
+        addr &= s->flash_size - 1;
+        i = MIN(len, s->flash_size - addr);
+        memcpy(s->rx_buf, s->storage + addr, i);
+        if (i < len) {
+            memcpy(s->rx_buf + i, s->storage, len - i);
+        }
+        break;
+    case 0x05:
+        memset(s->rx_buf, s->nor_sr, len);
+        break;
+    case 0x9F:
+        for (i = 0; i < len; i++) {
+            s->rx_buf[i] = i < 3 ? extract32(s->jedec_id, 16 - 8 * i, 8) : 0;
+        }
+        break;
+    default:
+        memset(s->rx_buf, 0, len);
+        break;
+    }
+}
+
+static void imx_flexspi_do_cmd(imx_flexspi_state *s, uint8_t opcode,
+                               uint32_t addr)
+{
+    switch (opcode) {
+    case 0x06:
+        s->nor_sr |= NOR_SR_WEL;
+        break;
+    case 0x04:
+        s->nor_sr &= ~NOR_SR_WEL;
+        break;
+    case 0x20: case 0x21:
+    case 0x52: case 0x5C:
+    case 0xD8: case 0xDC:
+    case 0x60: case 0xC7:
+        if (!(s->nor_sr & NOR_SR_WEL)) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: erase 0x%x without WREN\n",
+                          __func__, opcode);
+            break;
+        }
+        if (opcode == 0x20 || opcode == 0x21) {
+            imx_flexspi_erase(s, addr, 4 * KiB);
+        } else if (opcode == 0x52 || opcode == 0x5C) {
+            imx_flexspi_erase(s, addr, 32 * KiB);
+        } else if (opcode == 0xD8 || opcode == 0xDC) {
+            imx_flexspi_erase(s, addr, 64 * KiB);
+        } else {
+            imx_flexspi_erase(s, 0, s->flash_size);
+        }
+        s->nor_sr &= ~NOR_SR_WEL;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Run one LUT sequence against the serial NOR */
+static void imx_flexspi_run_seq(imx_flexspi_state *s, uint32_t seqid,
+                                uint32_t addr, uint32_t size)
+{
+    int opcode = -1;
+    bool rd = false, wr = false;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        uint32_t word = s->lut[seqid * 4 + i / 2];
+        uint16_t instr = (i & 1) ? (word >> 16) : (word & 0xFFFF);
+        uint8_t code = instr >> 10;
+
+        if (code == FLEXSPI_INSTR_STOP || code == FLEXSPI_INSTR_JMP_ON_CS) {
+            break;
+        }
+        switch (code) {
+        case FLEXSPI_INSTR_CMD_SDR:
+        case FLEXSPI_INSTR_CMD_DDR:
+            /* Octal DDR sends the inverted opcode second, keep the first */
+            if (opcode < 0) {
+                opcode = instr & 0xFF;
+            }
+            break;
+        case FLEXSPI_INSTR_READ_SDR:
+        case FLEXSPI_INSTR_READ_DDR:
+            rd = true;
+            break;
+        case FLEXSPI_INSTR_WRITE_SDR:
+        case FLEXSPI_INSTR_WRITE_DDR:
+            wr = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (opcode < 0) {
+        return;
+    }
+    if (rd) {
+        imx_flexspi_do_read(s, opcode, addr, size);
+    } else if (wr) {
+        if (opcode == 0x02 || opcode == 0x12 || opcode == 0x32 ||
+            opcode == 0x34 || opcode == 0x38 || opcode == 0x3E) {
+            if (!(s->nor_sr & NOR_SR_WEL)) {
+                qemu_log_mask(LOG_GUEST_ERROR,
+                              "%s: program without WREN\n", __func__);
+                s->tx_len = 0;
+                return;
+            }
+            s->pend_opcode = opcode;
+            s->pend_addr = addr & (s->flash_size - 1);
+            s->pend_size = size;
+        } else {
+            /* Register writes (WRSR, WRCR ...) are accepted and dropped */
+            s->tx_len = 0;
+        }
+    } else {
+        imx_flexspi_do_cmd(s, opcode, addr);
+    }
+}
+
+static void imx_flexspi_ipcmd(imx_flexspi_state *s)
+{
+    uint32_t ipcr1 = s->reg[FLEXSPI_IPCR1 / 4];
+    uint32_t addr = s->reg[FLEXSPI_IPCR0 / 4];
+    uint32_t size = ipcr1 & 0xFFFF;
+    uint32_t seqid = (ipcr1 >> 16) & 0xF;
+    uint32_t seqnum = (ipcr1 >> 24) & 0x7;
+    uint32_t i;
+
+    if (s->pend_size) {
+        s->reg[FLEXSPI_INTR / 4] |= FLEXSPI_INTR_IPCMDGE;
+        return;
+    }
+
+    for (i = 0; i <= seqnum; i++) {
+        imx_flexspi_run_seq(s, (seqid + i) & 0xF, addr, size);
+    }
+
+    if (s->pend_size) {
+        /* Completes once the guest has pushed all the TX data */
+        if (s->tx_len >= s->pend_size) {
+            imx_flexspi_program(s);
+        }
+    } else {
+        s->reg[FLEXSPI_INTR / 4] |= FLEXSPI_INTR_IPCMDDONE;
+    }
+}
+
+static void imx_flexspi_reset(DeviceState *dev)
+{
+    imx_flexspi_state *s = IMX_FLEXSPI(dev);
+
+    memset(s->reg, 0, sizeof(s->reg));
+    s->reg[FLEXSPI_MCR0 / 4] = 0xFFFF80C2;
+    s->reg[FLEXSPI_LUTKEY / 4] = FLEXSPI_LUTKEY_VALUE;
+    s->reg[FLEXSPI_LUTCR / 4] = FLEXSPI_LUTCR_UNLOCK;
+    s->reg[0x60 / 4] = s->flash_size / KiB;
+    s->rx_len = 0;
+    s->rx_pos = 0;
+    s->tx_len = 0;
+    s->pend_size = 0;
+    s->nor_sr = 0;
+    imx_flexspi_update(s);
+}
+
+static uint64_t imx_flexspi_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    imx_flexspi_state *s = (imx_flexspi_state *)opaque;
+    uint64_t ret = 0;
+    uint32_t pos;
+
+    if (offset >= FLEXSPI_LUT) {
+        ret = s->lut[(offset - FLEXSPI_LUT) / 4];
+    } else if (offset >= FLEXSPI_TFDR) {
+        ret = 0;
+    } else if (offset >= FLEXSPI_RFDR) {
+        pos = s->rx_pos + (offset - FLEXSPI_RFDR);
+        if (pos + 4 <= s->rx_len) {
+            ret = ldl_le_p(s->rx_buf + pos);
+        } else if (pos < s->rx_len) {
+            uint8_t tmp[4] = { 0 };
+            memcpy(tmp, s->rx_buf + pos, s->rx_len - pos);
+            ret = ldl_le_p(tmp);
+        }
+    } else {
+        switch (offset) {
+        case FLEXSPI_STS0:
+            ret = FLEXSPI_STS0_IDLE;
+            break;
+        case FLEXSPI_IPRXFSTS:
+            ret = (DIV_ROUND_UP(MIN(s->rx_len - s->rx_pos,
+                                    IMX_FLEXSPI_FIFO_WORDS * 4), 8)) |
+                  ((s->rx_pos / 8) << 16);
+            break;
+        case FLEXSPI_IPTXFSTS:
+            ret = (s->tx_len / 8) << 16;
+            break;
+        default:
+            ret = s->reg[offset / 4];
+            break;
+        }
+    }
+    return ret;
+}
+
+static void imx_flexspi_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size)
+{
+    imx_flexspi_state *s = (imx_flexspi_state *)opaque;
+    uint32_t len;
+
+    if (offset >= FLEXSPI_LUT) {
+        if (s->reg[FLEXSPI_LUTCR / 4] & FLEXSPI_LUTCR_LOCK) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: LUT is locked\n", __func__);
+        } else {
+            s->lut[(offset - FLEXSPI_LUT) / 4] = value;
+        }
+        return;
+    } else if (offset >= FLEXSPI_TFDR) {
+        s->tfdr[(offset - FLEXSPI_TFDR) / 4] = value;
+        return;
+    } else if (offset >= FLEXSPI_RFDR) {
+        return;
+    }
+
+    switch (offset) {
+    case FLEXSPI_MCR0:
+        s->reg[offset / 4] = value & ~FLEXSPI_MCR0_SWRESET;
+        if (value & FLEXSPI_MCR0_SWRESET) {
+            s->rx_len = 0;
+            s->rx_pos = 0;
+            s->tx_len = 0;
+            s->pend_size = 0;
+            s->reg[FLEXSPI_INTR / 4] = 0;
+        }
+        break;
+    case FLEXSPI_INTR:
+        if (value & FLEXSPI_INTR_IPRXWA) {
+            s->rx_pos = MIN(s->rx_pos + imx_flexspi_rx_wmrk(s), s->rx_len);
+        }
+        if ((value & FLEXSPI_INTR_IPTXWE) && s->pend_size) {
+            len = MIN(imx_flexspi_tx_wmrk(s),
+                      MIN(IMX_FLEXSPI_FIFO_WORDS * 4,
+                          IMX_FLEXSPI_DATA_MAX - s->tx_len));
+            memcpy(s->tx_buf + s->tx_len, s->tfdr, len);
+            s->tx_len += len;
+            if (s->tx_len >= s->pend_size) {
+                imx_flexspi_program(s);
+            }
+        }
+        s->reg[offset / 4] &= ~(value & ~(FLEXSPI_INTR_IPRXWA |
+                                          FLEXSPI_INTR_IPTXWE));
+        break;
+    case FLEXSPI_LUTKEY:
+        break;
+    case FLEXSPI_LUTCR:
+        if (s->reg[FLEXSPI_LUTKEY / 4] == FLEXSPI_LUTKEY_VALUE &&
+            (value & 0x3) && (value & 0x3) != 0x3) {
+            s->reg[offset / 4] = value & 0x3;
+        }
+        break;
+    case FLEXSPI_IPCMD:
+        if (value & 1) {
+            imx_flexspi_ipcmd(s);
+        }
+        break;
+    case FLEXSPI_IPRXFCR:
+        if (value & 1) {
+            s->rx_len = 0;
+            s->rx_pos = 0;
+        }
+        s->reg[offset / 4] = value & ~1;
+        break;
+    case FLEXSPI_IPTXFCR:
+        if (value & 1) {
+            s->tx_len = 0;
+        }
+        s->reg[offset / 4] = value & ~1;
+        break;
+    case FLEXSPI_STS0:
+    case FLEXSPI_IPRXFSTS:
+    case FLEXSPI_IPTXFSTS:
+        break;
+    default:
+        s->reg[offset / 4] = value;
+        break;
+    }
+    imx_flexspi_update(s);
+}
+
+/*
+ * The XIP window is a ROM device in ROMD mode: reads and fetches go
+ * straight to the array, only AHB writes come here.
+ */
+static uint64_t imx_flexspi_xip_read(void *opaque, hwaddr addr,
+                                     unsigned size)
+{
+    imx_flexspi_state *s = (imx_flexspi_state *)opaque;
+
+    return ldn_le_p(s->storage + addr, size);
+}
+
+static void imx_flexspi_xip_write(void *opaque, hwaddr addr, uint64_t value,
+                                  unsigned size)
+{
+    qemu_log_mask(LOG_GUEST_ERROR, "%s: AHB write to 0x%x ignored\n",
+                  __func__, (uint32_t)addr);
+}
+
+static const MemoryRegionOps imx_flexspi_xip_ops = {
+    .read = imx_flexspi_xip_read,
+    .write = imx_flexspi_xip_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+};
+
+static void imx_flexspi_init(Object *obj)
+{
+    imx_flexspi_state *s = IMX_FLEXSPI(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_flexspi_ops, s, TYPE_IMX_FLEXSPI, 0x400);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    s->image_fd = -1;
+}
+
+/*
+ * Load the NOR image into the array.  A writable image stays open and
+ * program/erase commands are written through to it; anything past the
+ * end of the file reads as erased flash.
+ */
+static bool imx_flexspi_load_image(imx_flexspi_state *s, Error **errp)
+{
+    size_t len, done = 0;
+    struct stat st;
+    bool writable = true;
+    ssize_t ret;
+    int fd;
+
+    fd = qemu_open(s->image, O_RDWR);
+    if (fd < 0) {
+        fd = qemu_open(s->image, O_RDONLY);
+        writable = false;
+    }
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        error_setg_errno(errp, errno, "%s: cannot open %s",
+                         TYPE_IMX_FLEXSPI, s->image);
+        if (fd >= 0) {
+            qemu_close(fd);
+        }
+        return false;
+    }
+
+    len = MIN((size_t)st.st_size, s->flash_size);
+    while (done < len) {
+        ret = pread(fd, s->storage + done, len - done, done);
+        if (ret <= 0) {
+            error_setg_errno(errp, ret ? errno : EIO, "%s: cannot read %s",
+                             TYPE_IMX_FLEXSPI, s->image);
+            qemu_close(fd);
+            return false;
+        }
+        done += ret;
+    }
+
+    if (writable) {
+        s->image_fd = fd;
+    } else {
+        qemu_close(fd);
+    }
+    return true;
+}
+
+static void imx_flexspi_realize(DeviceState *dev, Error **errp)
+{
+    imx_flexspi_state *s = IMX_FLEXSPI(dev);
+    Error *err = NULL;
+
+    if (!is_power_of_2(s->flash_size) || s->flash_size < 64 * KiB) {
+        error_setg(errp, "%s: flash-size must be a power of two >= 64K",
+                   TYPE_IMX_FLEXSPI);
+        return;
+    }
+
+    memory_region_init_rom_device(&s->xip, OBJECT(s), &imx_flexspi_xip_ops,
+                                  s, "flexspi.xip", s->flash_size, &err);
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    s->storage = memory_region_get_ram_ptr(&s->xip);
+    memset(s->storage, 0xFF, s->flash_size);
+    if (s->image && !imx_flexspi_load_image(s, errp)) {
+        return;
+    }
+    sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->xip);
+}
+
+static void imx_flexspi_unrealize(DeviceState *dev, Error **errp)
+{
+    imx_flexspi_state *s = IMX_FLEXSPI(dev);
+
+    if (s->image_fd >= 0) {
+        qemu_close(s->image_fd);
+        s->image_fd = -1;
+    }
+}
+
+static Property imx_flexspi_properties[] = {
+    DEFINE_PROP_STRING("image", imx_flexspi_state, image),
+    DEFINE_PROP_UINT32("flash-size", imx_flexspi_state, flash_size, 64 * MiB),
+    DEFINE_PROP_UINT64("xip-base", imx_flexspi_state, xip_base,
+                       IMX_FLEXSPI0_AMBA),
+    DEFINE_PROP_UINT32("jedec-id", imx_flexspi_state, jedec_id, 0xC22539),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_flexspi_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_flexspi_realize;
+    dc->unrealize = imx_flexspi_unrealize;
+    dc->reset = imx_flexspi_reset;
+    dc->props = imx_flexspi_properties;
+    dc->vmsd = &imx_flexspi_vm;
+}
+
+static const TypeInfo imx_flexspi_info = {
+    .name          = TYPE_IMX_FLEXSPI,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_flexspi_state),
+    .instance_init = imx_flexspi_init,
+    .class_init    = imx_flexspi_class_init,
+};
+
+static void imx_flexspi_types(void)
+{
+    type_register_static(&imx_flexspi_info);
+}
+
+type_init(imx_flexspi_types)
+
+/*=======================================
+    CGC / PCC Module Start
+ ========================================*/
+#define CGC_CM33CLK         0x010
+#define CGC_SOSCCSR         0x100
+#define CGC_SOSCDIV         0x108
+#define CGC_FROCSR          0x200
+#define CGC_FRODIV          0x208
+#define CGC_LPOSCCSR        0x300
+#define CGC_PLL0CSR         0x500
+#define CGC_PLL0CFG         0x510
+#define CGC_PLL1CSR         0x600
+#define CGC_PLL1DIV_VCO     0x604
+#define CGC_PLL1CFG         0x610
+
+#define CGC_CSR_EN          (1 << 0)
+#define CGC_CSR_VLD         (1 << 24)
+
+#define PCC_PR              (1U << 31)
+#define PCC_CGC             (1 << 30)
+#define PCC_SWRST           (1 << 28)
+
+#define FRO_FREQ            192000000
+#define LPOSC_FREQ          1000000
+
+enum {
+    IMX_CLK_SOURCE,     /* fixed rate, EN bit in reg */
+    IMX_CLK_PLL,        /* parent * MULT, EN bit in reg, source/MULT in reg2 */
+    IMX_CLK_DIV,        /* parent / (DIV + 1), halt bit = shift + 7 */
+    IMX_CLK_MUX,        /* parents[] selected by the field */
+};
+
+typedef struct {
+    int kind;
+    uint16_t reg;
+    uint16_t reg2;
+    uint8_t shift;
+    uint8_t width;
+    int8_t parents[8];
+} imx_clk_desc;
+
+#define CLK_NONE { -1, -1, -1, -1, -1, -1, -1, -1 }
+#define CLK_ONE(p) { p, -1, -1, -1, -1, -1, -1, -1 }
+
+static const imx_clk_desc imx_cgc_clks[IMX_CGC_CLK_NUM] = {
+    [IMX_CGC_SOSC] = { IMX_CLK_SOURCE, CGC_SOSCCSR, 0, 0, 0, CLK_NONE },
+    [IMX_CGC_FRO] = { IMX_CLK_SOURCE, CGC_FROCSR, 0, 0, 0, CLK_NONE },
+    [IMX_CGC_LPOSC] = { IMX_CLK_SOURCE, CGC_LPOSCCSR, 0, 0, 0, CLK_NONE },
+    [IMX_CGC_PLL0] = { IMX_CLK_PLL, CGC_PLL0CSR, CGC_PLL0CFG, 16, 7,
+                       { IMX_CGC_SOSC, IMX_CGC_FRO, -1, -1, -1, -1, -1, -1 } },
+    [IMX_CGC_PLL1] = { IMX_CLK_PLL, CGC_PLL1CSR, CGC_PLL1CFG, 16, 7,
+                       { IMX_CGC_SOSC, IMX_CGC_FRO, -1, -1, -1, -1, -1, -1 } },
+    [IMX_CGC_SOSC_DIV1] = { IMX_CLK_DIV, CGC_SOSCDIV, 0, 0, 6,
+                            CLK_ONE(IMX_CGC_SOSC) },
+    [IMX_CGC_SOSC_DIV2] = { IMX_CLK_DIV, CGC_SOSCDIV, 0, 8, 6,
+                            CLK_ONE(IMX_CGC_SOSC) },
+    [IMX_CGC_SOSC_DIV3] = { IMX_CLK_DIV, CGC_SOSCDIV, 0, 16, 6,
+                            CLK_ONE(IMX_CGC_SOSC) },
+    [IMX_CGC_FRO_DIV1] = { IMX_CLK_DIV, CGC_FRODIV, 0, 0, 6,
+                           CLK_ONE(IMX_CGC_FRO) },
+    [IMX_CGC_FRO_DIV2] = { IMX_CLK_DIV, CGC_FRODIV, 0, 8, 6,
+                           CLK_ONE(IMX_CGC_FRO) },
+    [IMX_CGC_FRO_DIV3] = { IMX_CLK_DIV, CGC_FRODIV, 0, 16, 6,
+                           CLK_ONE(IMX_CGC_FRO) },
+    [IMX_CGC_PLL1_VCODIV] = { IMX_CLK_DIV, CGC_PLL1DIV_VCO, 0, 0, 6,
+                              CLK_ONE(IMX_CGC_PLL1) },
+    [IMX_CGC_CM33_SEL] = { IMX_CLK_MUX, CGC_CM33CLK, 0, 28, 3,
+                           { IMX_CGC_FRO, IMX_CGC_SOSC, IMX_CGC_LPOSC,
+                             IMX_CGC_PLL0, IMX_CGC_PLL1, -1, -1, -1 } },
+    [IMX_CGC_CORE] = { IMX_CLK_DIV, CGC_CM33CLK, 0, 21, 6,
+                       CLK_ONE(IMX_CGC_CM33_SEL) },
+    [IMX_CGC_BUS] = { IMX_CLK_DIV, CGC_CM33CLK, 0, 7, 6,
+                      CLK_ONE(IMX_CGC_CORE) },
+    [IMX_CGC_SLOW] = { IMX_CLK_DIV, CGC_CM33CLK, 0, 0, 6,
+                       CLK_ONE(IMX_CGC_CORE) },
+};
+
+/* PCC.PCS encoding for the PCC0/PCC1 functional clocks */
+static const int imx_pcc_pcs_src[8] = {
+    -1,
+    IMX_CGC_SOSC_DIV2,
+    IMX_CGC_FRO_DIV2,
+    IMX_CGC_LPOSC,
+    IMX_CGC_SOSC_DIV3,
+    IMX_CGC_FRO_DIV3,
+    IMX_CGC_PLL1_VCODIV,
+    IMX_CGC_BUS,
+};
+
+static uint64_t imx_cgc_read(void *opaque, hwaddr offset,
+                                   unsigned size);
+static void imx_cgc_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size);
+static int imx_cgc_post_load(void *opaque, int version_id);
+
+static const VMStateDescription imx_cgc_vm = {
+    .name = TYPE_IMX_CGC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = imx_cgc_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(reg, imx_cgc_state, IMX_CGC_REG_NUM),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const MemoryRegionOps imx_cgc_ops = {
+    .read = imx_cgc_read,
+    .write = imx_cgc_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static int imx_cgc_parent(imx_cgc_state *s, int i)
+{
+    const imx_clk_desc *d = &imx_cgc_clks[i];
+
+    switch (d->kind) {
+    case IMX_CLK_PLL:
+        return d->parents[s->reg[d->reg2 / 4] & 1];
+    case IMX_CLK_DIV:
+        return d->parents[0];
+    case IMX_CLK_MUX:
+        return d->parents[extract32(s->reg[d->reg / 4], d->shift, d->width)];
+    default:
+        return -1;
+    }
+}
+
+static uint32_t imx_cgc_compute(imx_cgc_state *s, int i)
+{
+    const imx_clk_desc *d = &imx_cgc_clks[i];
+    uint32_t reg = s->reg[d->reg / 4];
+    int p = imx_cgc_parent(s, i);
+    uint64_t pfreq = p >= 0 ? s->freq[p] : 0;
+
+    switch (d->kind) {
+    case IMX_CLK_SOURCE:
+        if (!(reg & CGC_CSR_EN)) {
+            return 0;
+        }
+        return i == IMX_CGC_SOSC ? s->sosc_freq :
+               i == IMX_CGC_FRO ? FRO_FREQ : LPOSC_FREQ;
+    case IMX_CLK_PLL:
+        if (!(reg & CGC_CSR_EN)) {
+            return 0;
+        }
+        return MIN(pfreq * extract32(s->reg[d->reg2 / 4], d->shift, d->width),
+                   UINT32_MAX);
+    case IMX_CLK_DIV:
+        if (d->reg != CGC_CM33CLK && (reg & (1 << (d->shift + 7)))) {
+            return 0;
+        }
+        return pfreq / (extract32(reg, d->shift, d->width) + 1);
+    case IMX_CLK_MUX:
+        return pfreq;
+    }
+    return 0;
+}
+
+/*
+ * Recompute the nodes configured by the register at @offset (all nodes
+ * when @offset is negative) and whatever hangs below them, then tell the
+ * consumers of each node whose rate actually moved.
+ */
+static void imx_cgc_propagate(imx_cgc_state *s, int offset)
+{
+    bool changed[IMX_CGC_CLK_NUM] = { false };
+    int i;
+
+    for (i = 0; i < IMX_CGC_CLK_NUM; i++) {
+        const imx_clk_desc *d = &imx_cgc_clks[i];
+        int p = imx_cgc_parent(s, i);
+        uint32_t freq;
+
+        if (offset >= 0 && d->reg != offset && d->reg2 != offset &&
+            !(p >= 0 && changed[p])) {
+            continue;
+        }
+        freq = imx_cgc_compute(s, i);
+        if (freq != s->freq[i]) {
+            s->freq[i] = freq;
+            changed[i] = true;
+        }
+    }
+
+    for (i = 0; i < IMX_CGC_CLK_NUM; i++) {
+        if (changed[i]) {
+            notifier_list_notify(&s->notifiers[i], &s->freq[i]);
+        }
+    }
+}
+
+static int imx_cgc_post_load(void *opaque, int version_id)
+{
+    imx_cgc_propagate((imx_cgc_state *)opaque, -1);
+    return 0;
+}
+
+static uint64_t imx_cgc_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    imx_cgc_state *s = (imx_cgc_state *)opaque;
+    uint64_t ret = 0;
+
+    if (offset >= IMX_CGC_REG_NUM * 4) {
+        return 0;
+    }
+    ret = s->reg[offset / 4];
+    switch (offset) {
+    case CGC_SOSCCSR:
+    case CGC_FROCSR:
+    case CGC_LPOSCCSR:
+    case CGC_PLL0CSR:
+    case CGC_PLL1CSR:
+        /* Sources lock instantly, so firmware polling VLD never spins */
+        ret &= ~CGC_CSR_VLD;
+        if (ret & CGC_CSR_EN) {
+            ret |= CGC_CSR_VLD;
+        }
+        break;
+    }
+    return ret;
+}
+
+static void imx_cgc_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size)
+{
+    imx_cgc_state *s = (imx_cgc_state *)opaque;
+
+    if (offset >= IMX_CGC_REG_NUM * 4) {
+        return;
+    }
+    if (s->reg[offset / 4] == value) {
+        return;
+    }
+    s->reg[offset / 4] = value;
+    imx_cgc_propagate(s, offset);
+}
+
+static void imx_cgc_reset(DeviceState *dev)
+{
+    imx_cgc_state *s = IMX_CGC(dev);
+
+    memset(s->reg, 0, sizeof(s->reg));
+    s->reg[CGC_SOSCCSR / 4] = CGC_CSR_EN;
+    s->reg[CGC_FROCSR / 4] = CGC_CSR_EN;
+    s->reg[CGC_LPOSCCSR / 4] = CGC_CSR_EN;
+    /* PLL0 480 MHz and PLL1 528 MHz from SOSC once enabled */
+    s->reg[CGC_PLL0CFG / 4] = 20 << 16;
+    s->reg[CGC_PLL1CFG / 4] = 22 << 16;
+    /* CM33 runs from FRO / 4 = 48 MHz out of reset */
+    s->reg[CGC_CM33CLK / 4] = 3 << 21;
+    imx_cgc_propagate(s, -1);
+}
+
+static void imx_cgc_init(Object *obj)
+{
+    imx_cgc_state *s = IMX_CGC(obj);
+    int i;
+
+    memory_region_init_io(&s->iomem, obj, &imx_cgc_ops, s, TYPE_IMX_CGC, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+
+    for (i = 0; i < IMX_CGC_CLK_NUM; i++) {
+        notifier_list_init(&s->notifiers[i]);
+    }
+}
+
+static void imx_cgc_realize(DeviceState *dev, Error **errp)
+{
+    imx_cgc_reset(dev);
+}
+
+static Property imx_cgc_properties[] = {
+    DEFINE_PROP_UINT32("sosc-freq", imx_cgc_state, sosc_freq, SYSCLK_FRQ),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_cgc_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_cgc_realize;
+    dc->reset = imx_cgc_reset;
+    dc->props = imx_cgc_properties;
+    dc->vmsd = &imx_cgc_vm;
+}
+
+static const TypeInfo imx_cgc_info = {
+    .name          = TYPE_IMX_CGC,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_cgc_state),
+    .instance_init = imx_cgc_init,
+    .class_init    = imx_cgc_class_init,
+};
+
+static uint64_t imx_pcc_read(void *opaque, hwaddr offset,
+                                   unsigned size);
+static void imx_pcc_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size);
+static int imx_pcc_post_load(void *opaque, int version_id);
+
+static const VMStateDescription imx_pcc_vm = {
+    .name = TYPE_IMX_PCC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = imx_pcc_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(slot, imx_pcc_state, IMX_PCC_SLOT_NUM),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const MemoryRegionOps imx_pcc_ops = {
+    .read = imx_pcc_read,
+    .write = imx_pcc_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static uint32_t imx_pcc_compute(imx_pcc_state *s, int idx)
+{
+    uint32_t slot = s->slot[idx];
+    int src = imx_pcc_pcs_src[extract32(slot, 24, 3)];
+
+    if (!(slot & PCC_CGC) || src < 0) {
+        return 0;
+    }
+    /* PCD divides, FRAC multiplies: freq = src * (FRAC + 1) / (PCD + 1) */
+    return (uint64_t)s->cgc->freq[src] * (extract32(slot, 3, 1) + 1) /
+           (extract32(slot, 0, 3) + 1);
+}
+
+static void imx_pcc_update_slot(imx_pcc_state *s, int idx)
+{
+    uint32_t freq = imx_pcc_compute(s, idx);
+
+    if (freq != s->freq[idx]) {
+        s->freq[idx] = freq;
+        notifier_list_notify(&s->notifiers[idx], &s->freq[idx]);
+    }
+}
+
+/* A CGC output changed: only the slots selecting it need a look */
+static void imx_pcc_src_changed(Notifier *n, void *data)
+{
+    imx_pcc_src_notifier *sn = container_of(n, imx_pcc_src_notifier, n);
+    imx_pcc_state *s = sn->pcc;
+    int i;
+
+    for (i = 0; i < IMX_PCC_SLOT_NUM; i++) {
+        if (extract32(s->slot[i], 24, 3) == sn->pcs) {
+            imx_pcc_update_slot(s, i);
+        }
+    }
+}
+
+static int imx_pcc_post_load(void *opaque, int version_id)
+{
+    imx_pcc_state *s = (imx_pcc_state *)opaque;
+    int i;
+
+    for (i = 0; i < IMX_PCC_SLOT_NUM; i++) {
+        imx_pcc_update_slot(s, i);
+    }
+    return 0;
+}
+
+void imx_cgc_connect_clock(imx_cgc_state *cgc, int clk, Notifier *n)
+{
+    assert(clk < IMX_CGC_CLK_NUM);
+    notifier_list_add(&cgc->notifiers[clk], n);
+    n->notify(n, &cgc->freq[clk]);
+}
+
+void imx_pcc_connect_clock(imx_pcc_state *pcc, uint32_t offset, Notifier *n)
+{
+    assert(offset / 4 < IMX_PCC_SLOT_NUM);
+    notifier_list_add(&pcc->notifiers[offset / 4], n);
+    n->notify(n, &pcc->freq[offset / 4]);
+}
+
+uint32_t imx_pcc_get_freq(imx_pcc_state *pcc, uint32_t offset)
+{
+    assert(offset / 4 < IMX_PCC_SLOT_NUM);
+    return pcc->freq[offset / 4];
+}
+
+static uint64_t imx_pcc_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    imx_pcc_state *s = (imx_pcc_state *)opaque;
+
+    if (offset / 4 >= IMX_PCC_SLOT_NUM) {
+        return 0;
+    }
+    return s->slot[offset / 4] | PCC_PR;
+}
+
+static void imx_pcc_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size)
+{
+    imx_pcc_state *s = (imx_pcc_state *)opaque;
+
+    if (offset / 4 >= IMX_PCC_SLOT_NUM) {
+        return;
+    }
+    s->slot[offset / 4] = value & ~PCC_PR;
+    imx_pcc_update_slot(s, offset / 4);
+}
+
+static void imx_pcc_reset(DeviceState *dev)
+{
+    imx_pcc_state *s = IMX_PCC(dev);
+    int i;
+
+    for (i = 0; i < IMX_PCC_SLOT_NUM; i++) {
+        s->slot[i] = 0;
+        imx_pcc_update_slot(s, i);
+    }
+}
+
+static void imx_pcc_init(Object *obj)
+{
+    imx_pcc_state *s = IMX_PCC(obj);
+    int i;
+
+    memory_region_init_io(&s->iomem, obj, &imx_pcc_ops, s, TYPE_IMX_PCC, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+
+    for (i = 0; i < IMX_PCC_SLOT_NUM; i++) {
+        notifier_list_init(&s->notifiers[i]);
+    }
+}
+
+static void imx_pcc_realize(DeviceState *dev, Error **errp)
+{
+    imx_pcc_state *s = IMX_PCC(dev);
+    int i;
+
+    if (!s->cgc) {
+        error_setg(errp, "%s: 'cgc' link not set", TYPE_IMX_PCC);
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(s->src_notifier); i++) {
+        if (imx_pcc_pcs_src[i] < 0) {
+            continue;
+        }
+        s->src_notifier[i].n.notify = imx_pcc_src_changed;
+        s->src_notifier[i].pcc = s;
+        s->src_notifier[i].pcs = i;
+        notifier_list_add(&s->cgc->notifiers[imx_pcc_pcs_src[i]],
+                          &s->src_notifier[i].n);
+    }
+}
+
+static Property imx_pcc_properties[] = {
+    DEFINE_PROP_LINK("cgc", imx_pcc_state, cgc, TYPE_IMX_CGC,
+                     imx_cgc_state *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_pcc_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_pcc_realize;
+    dc->reset = imx_pcc_reset;
+    dc->props = imx_pcc_properties;
+    dc->vmsd = &imx_pcc_vm;
+}
+
+static const TypeInfo imx_pcc_info = {
+    .name          = TYPE_IMX_PCC,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_pcc_state),
+    .instance_init = imx_pcc_init,
+    .class_init    = imx_pcc_class_init,
+};
+
+static void imx_cgc_types(void)
+{
+    type_register_static(&imx_cgc_info);
+    type_register_static(&imx_pcc_info);
+}
+
+type_init(imx_cgc_types)
+
+/*=======================================
+    ROMCP Module Start
+ ========================================*/
+#define ROMC_DATA7          0xD4
+#define ROMC_DATA0          0xF0
+#define ROMC_CNTL           0xF4
+#define ROMC_ENL            0xFC
+#define ROMC_ADDR0          0x100
+#define ROMC_ADDR15         0x13C
+#define ROMC_SR             0x208
+
+#define ROMC_CNTL_DIS       (1 << 29)
+#define ROMC_ADDR_MASK      0x007FFFFE
+
+static uint64_t imx_romcp_read(void *opaque, hwaddr offset,
+                                   unsigned size);
+static void imx_romcp_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size);
+
+static const VMStateDescription imx_romcp_vm = {
+    .name = TYPE_IMX_ROMCP,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(data, imx_romcp_state, IMX_ROMCP_NUM_DATA),
+        VMSTATE_UINT32(cntl, imx_romcp_state),
+        VMSTATE_UINT32(enl, imx_romcp_state),
+        VMSTATE_UINT32_ARRAY(addr, imx_romcp_state, IMX_ROMCP_NUM_ADDR),
+        VMSTATE_UINT32(sr, imx_romcp_state),
+        VMSTATE_UINT32_ARRAY(applied, imx_romcp_state, IMX_ROMCP_NUM_ADDR),
+        VMSTATE_UINT32_ARRAY(applied_addr, imx_romcp_state,
+                             IMX_ROMCP_NUM_ADDR),
+        VMSTATE_UINT32_ARRAY(applied_val, imx_romcp_state,
+                             IMX_ROMCP_NUM_ADDR),
+        VMSTATE_UINT32_ARRAY(shadow, imx_romcp_state, IMX_ROMCP_NUM_ADDR),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const MemoryRegionOps imx_romcp_ops = {
+    .read = imx_romcp_read,
+    .write = imx_romcp_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+/* The ROM sits behind the secure side of its MPC */
+static const MemTxAttrs imx_romcp_attrs = { .secure = 1 };
+
+/*
+ * Data fix entries replace a word with ROMC_DATAn, opcode entries replace
+ * a halfword with "SVC #n" so the ROM traps into its patch handler.
+ */
+static uint32_t imx_romcp_entry_len(imx_romcp_state *s, int n)
+{
+    return (n < IMX_ROMCP_NUM_DATA && (s->cntl & (1 << n))) ? 4 : 2;
+}
+
+static uint32_t imx_romcp_entry_addr(imx_romcp_state *s, int n)
+{
+    uint32_t addr = s->addr[n] & ROMC_ADDR_MASK;
+
+    return imx_romcp_entry_len(s, n) == 4 ? addr & ~3 : addr;
+}
+
+static uint32_t imx_romcp_entry_val(imx_romcp_state *s, int n)
+{
+    if (imx_romcp_entry_len(s, n) == 4) {
+        return s->data[n];
+    }
+    return 0xDF00 | n;
+}
+
+static bool imx_romcp_entry_enabled(imx_romcp_state *s, int n)
+{
+    return !(s->cntl & ROMC_CNTL_DIS) && (s->enl & (1 << n)) &&
+           imx_romcp_entry_addr(s, n) + imx_romcp_entry_len(s, n) <=
+           s->rom_size;
+}
+
+/*
+ * Each ROM write goes through address_space_write_rom(), which drops only
+ * the translation blocks covering the bytes it touched.  Unpatched ROM
+ * keeps running from plain RAM-backed TBs with no per-fetch check.
+ */
+static void imx_romcp_rom_write(imx_romcp_state *s, uint32_t addr,
+                                uint32_t val, uint32_t len)
+{
+    uint8_t buf[4];
+
+    stl_le_p(buf, val);
+    address_space_write_rom(&address_space_memory, s->rom_base + addr,
+                            imx_romcp_attrs, buf, len);
+}
+
+static uint32_t imx_romcp_rom_read(imx_romcp_state *s, uint32_t addr,
+                                   uint32_t len)
+{
+    uint8_t buf[4] = { 0 };
+
+    address_space_read(&address_space_memory, s->rom_base + addr,
+                       imx_romcp_attrs, buf, len);
+    return ldl_le_p(buf);
+}
+
+static void imx_romcp_restore(imx_romcp_state *s, int n)
+{
+    imx_romcp_rom_write(s, s->applied_addr[n], s->shadow[n], s->applied[n]);
+    s->applied[n] = 0;
+}
+
+/*
+ * An entry overlapping a lower-numbered one is not applied, so applied
+ * patches never share bytes and each restores exactly what it replaced.
+ */
+static bool imx_romcp_entry_overlaps(imx_romcp_state *s, bool *want, int n)
+{
+    uint32_t addr = imx_romcp_entry_addr(s, n);
+    uint32_t end = addr + imx_romcp_entry_len(s, n);
+    int k;
+
+    for (k = 0; k < n; k++) {
+        if (want[k] && addr < imx_romcp_entry_addr(s, k) +
+                              imx_romcp_entry_len(s, k) &&
+            imx_romcp_entry_addr(s, k) < end) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: entry %d overlaps entry %d, "
+                          "ignored\n", __func__, n, k);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void imx_romcp_apply(imx_romcp_state *s)
+{
+    bool want[IMX_ROMCP_NUM_ADDR];
+    int n;
+
+    for (n = 0; n < IMX_ROMCP_NUM_ADDR; n++) {
+        want[n] = imx_romcp_entry_enabled(s, n) &&
+                  !imx_romcp_entry_overlaps(s, want, n);
+    }
+
+    /* Undo every patch that no longer matches its registers */
+    for (n = IMX_ROMCP_NUM_ADDR - 1; n >= 0; n--) {
+        if (!s->applied[n]) {
+            continue;
+        }
+        if (!want[n] || s->applied[n] != imx_romcp_entry_len(s, n) ||
+            s->applied_addr[n] != imx_romcp_entry_addr(s, n) ||
+            s->applied_val[n] != imx_romcp_entry_val(s, n)) {
+            imx_romcp_restore(s, n);
+        }
+    }
+
+    for (n = 0; n < IMX_ROMCP_NUM_ADDR; n++) {
+        uint32_t len, addr, val;
+
+        if (!want[n] || s->applied[n]) {
+            continue;
+        }
+        len = imx_romcp_entry_len(s, n);
+        addr = imx_romcp_entry_addr(s, n);
+        val = imx_romcp_entry_val(s, n);
+
+        s->shadow[n] = imx_romcp_rom_read(s, addr, len);
+        imx_romcp_rom_write(s, addr, val, len);
+        s->applied[n] = len;
+        s->applied_addr[n] = addr;
+        s->applied_val[n] = val;
+    }
+}
+
+static uint64_t imx_romcp_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    imx_romcp_state *s = (imx_romcp_state *)opaque;
+    uint64_t ret = 0;
+
+    if (offset >= ROMC_DATA7 && offset <= ROMC_DATA0) {
+        ret = s->data[(ROMC_DATA0 - offset) / 4];
+    } else if (offset >= ROMC_ADDR0 && offset <= ROMC_ADDR15) {
+        ret = s->addr[(offset - ROMC_ADDR0) / 4];
+    } else {
+        switch (offset) {
+        case ROMC_CNTL:
+            ret = s->cntl;
+            break;
+        case ROMC_ENL:
+            ret = s->enl;
+            break;
+        case ROMC_SR:
+            ret = s->sr;
+            break;
+        default:
+            break;
+        }
+    }
+    return ret;
+}
+
+static void imx_romcp_write(void *opaque, hwaddr offset,
+                            uint64_t value, unsigned size)
+{
+    imx_romcp_state *s = (imx_romcp_state *)opaque;
+
+    if (offset >= ROMC_DATA7 && offset <= ROMC_DATA0) {
+        s->data[(ROMC_DATA0 - offset) / 4] = value;
+    } else if (offset >= ROMC_ADDR0 && offset <= ROMC_ADDR15) {
+        s->addr[(offset - ROMC_ADDR0) / 4] = value & ROMC_ADDR_MASK;
+    } else {
+        switch (offset) {
+        case ROMC_CNTL:
+            s->cntl = value & (ROMC_CNTL_DIS | 0xFF);
+            break;
+        case ROMC_ENL:
+            s->enl = value & 0xFFFF;
+            break;
+        case ROMC_SR:
+            s->sr &= ~value;
+            return;
+        default:
+            return;
+        }
+    }
+    imx_romcp_apply(s);
+}
+
+static void imx_romcp_reset(DeviceState *dev)
+{
+    imx_romcp_state *s = IMX_ROMCP(dev);
+    int n;
+
+    for (n = IMX_ROMCP_NUM_ADDR - 1; n >= 0; n--) {
+        if (s->applied[n]) {
+            imx_romcp_restore(s, n);
+        }
+    }
+    memset(s->data, 0, sizeof(s->data));
+    memset(s->addr, 0, sizeof(s->addr));
+    s->cntl = 0;
+    s->enl = 0;
+    s->sr = 0;
+}
+
+static void imx_romcp_init(Object *obj)
+{
+    imx_romcp_state *s = IMX_ROMCP(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_romcp_ops, s, TYPE_IMX_ROMCP, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+}
+
+static Property imx_romcp_properties[] = {
+    DEFINE_PROP_UINT64("rom-base", imx_romcp_state, rom_base, IMX_ROM_START),
+    DEFINE_PROP_UINT32("rom-size", imx_romcp_state, rom_size, IMX_ROM_SIZE),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_romcp_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = imx_romcp_reset;
+    dc->props = imx_romcp_properties;
+    dc->vmsd = &imx_romcp_vm;
+}
+
+static const TypeInfo imx_romcp_info = {
+    .name          = TYPE_IMX_ROMCP,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_romcp_state),
+    .instance_init = imx_romcp_init,
+    .class_init    = imx_romcp_class_init,
+};
+
+static void imx_romcp_types(void)
+{
+    type_register_static(&imx_romcp_info);
+}
+
+type_init(imx_romcp_types)
+
+/*=======================================
+    TRDC Module Start
+ ========================================*/
+/*
+ * Trusted Resource Domain Controller, modelled as a memory block checker
+ * in front of PSRAM.  The CM33 is the only master, so one MDA word picks
+ * its domain.  Every block config word selects one of the GLBAC access
+ * policies (3 bits) plus NSE per 64K block.
+ *
+ * The upstream region is an IOMMU.  perm[][] holds the access of the
+ * current domain for each block and each (secure, user) index and is only
+ * rebuilt when a config register changes, so translate() is a table
+ * lookup.  TCG caches the result in its TLB; blocks whose access changes
+ * are reported through IOMMU notifiers, which flush those TLB entries.
+ * Execute permission is not separate from read.
+ */
+#define TRDC_CR                 0x000
+#define TRDC_HWCFG0             0x0F0
+#define TRDC_MDA_W0_0           0x800
+#define TRDC_MBC0_GLBAC         0x10000
+#define TRDC_MBC0_BLK_CFG       0x10040
+#define TRDC_MBC0_DOM_STRIDE    0x100
+
+#define TRDC_CR_GVLDM           (1 << 0)
+#define TRDC_MDA_DID_MASK       0xF
+#define TRDC_MDA_VLD            (1u << 31)
+#define TRDC_BLK_NSE            (1 << 3)
+
+#define TRDC_BLK_MASK           ((1 << IMX_TRDC_BLK_SHIFT) - 1)
+
+static uint8_t imx_trdc_block_perm(imx_trdc_state *s, int dom, int blk,
+        int idx)
+{
+    uint32_t cfg = extract32(s->blk_cfg[dom][blk / 8], (blk % 8) * 4, 4);
+    uint32_t acp = s->glbac[cfg & 7];
+    bool secure = idx & 2;
+    bool user = idx & 1;
+    uint8_t perm = 0;
+    int shift;
+
+    /*
+     * NSE picks the one security state the block accepts: clear is
+     * secure-only, set is nonsecure-only.
+     */
+    if (secure == !!(cfg & TRDC_BLK_NSE)) {
+        return 0;
+    }
+    /* GLBAC: {X, W, R} for NU at 0, NP at 4, SU at 8, SP at 12 */
+    shift = (secure ? 8 : 0) + (user ? 0 : 4);
+    if (acp & (1 << (shift + 2))) {
+        perm |= IMX_TRDC_PERM_R;
+    }
+    if (acp & (1 << (shift + 1))) {
+        perm |= IMX_TRDC_PERM_W;
+    }
+    return perm;
+}
+
+static AddressSpace *imx_trdc_target_as(imx_trdc_state *s, uint8_t perm)
+{
+    if (perm & IMX_TRDC_PERM_W) {
+        return &s->downstream_as;
+    }
+    return perm & IMX_TRDC_PERM_R ? &s->readonly_as : &s->blocked_as;
+}
+
+static void imx_trdc_notify(imx_trdc_state *s, int idx, int blk,
+        uint8_t old, uint8_t new)
+{
+    IOMMUTLBEntry entry = {
+        .iova = (hwaddr)blk << IMX_TRDC_BLK_SHIFT,
+        .translated_addr = (hwaddr)blk << IMX_TRDC_BLK_SHIFT,
+        .addr_mask = TRDC_BLK_MASK,
+    };
+
+    /* Unmap the old target, then map the new one, like tz-mpc */
+    entry.target_as = imx_trdc_target_as(s, old);
+    entry.perm = IOMMU_NONE;
+    memory_region_notify_iommu(&s->upstream, idx, entry);
+
+    entry.target_as = imx_trdc_target_as(s, new);
+    entry.perm = IOMMU_RW;
+    memory_region_notify_iommu(&s->upstream, idx, entry);
+}
+
+/* Rebuild the permission map, notifying only blocks that changed */
+static void imx_trdc_update(imx_trdc_state *s)
+{
+    bool enabled = (s->cr & TRDC_CR_GVLDM) && (s->mda & TRDC_MDA_VLD);
+    int dom = s->mda & TRDC_MDA_DID_MASK;
+    int idx, blk;
+
+    for (idx = 0; idx < IMX_TRDC_NUM_IDX; idx++) {
+        for (blk = 0; blk < s->num_blocks; blk++) {
+            uint8_t perm = IMX_TRDC_PERM_R | IMX_TRDC_PERM_W;
+
+            if (enabled) {
+                perm = imx_trdc_block_perm(s, dom, blk, idx);
+            }
+            if (perm != s->perm[idx][blk]) {
+                uint8_t old = s->perm[idx][blk];
+
+                s->perm[idx][blk] = perm;
+                imx_trdc_notify(s, idx, blk, old, perm);
+            }
+        }
+    }
+}
+
+static uint64_t imx_trdc_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_trdc_state *s = (imx_trdc_state *)opaque;
+    hwaddr blk;
+
+    switch (offset) {
+    case TRDC_CR:
+        return s->cr;
+    case TRDC_HWCFG0:
+        /* NMBC = 1, NDID = 16 */
+        return (1 << 16) | IMX_TRDC_NUM_DOMAINS;
+    case TRDC_MDA_W0_0:
+        return s->mda;
+    }
+    if (offset >= TRDC_MBC0_GLBAC &&
+            offset < TRDC_MBC0_GLBAC + IMX_TRDC_NUM_GLBAC * 4) {
+        return s->glbac[(offset - TRDC_MBC0_GLBAC) / 4];
+    }
+    if (offset >= TRDC_MBC0_BLK_CFG && offset < TRDC_MBC0_BLK_CFG +
+            IMX_TRDC_NUM_DOMAINS * TRDC_MBC0_DOM_STRIDE) {
+        blk = offset - TRDC_MBC0_BLK_CFG;
+        if ((blk % TRDC_MBC0_DOM_STRIDE) / 4 < s->num_blocks / 8) {
+            return s->blk_cfg[blk / TRDC_MBC0_DOM_STRIDE]
+                [(blk % TRDC_MBC0_DOM_STRIDE) / 4];
+        }
+    }
+    qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%" HWADDR_PRIx "\n",
+            __func__, offset);
+    return 0;
+}
+
+static void imx_trdc_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_trdc_state *s = (imx_trdc_state *)opaque;
+    hwaddr blk;
+
+    switch (offset) {
+    case TRDC_CR:
+        s->cr = value & TRDC_CR_GVLDM;
+        imx_trdc_update(s);
+        return;
+    case TRDC_MDA_W0_0:
+        s->mda = value & (TRDC_MDA_VLD | TRDC_MDA_DID_MASK);
+        imx_trdc_update(s);
+        return;
+    }
+    if (offset >= TRDC_MBC0_GLBAC &&
+            offset < TRDC_MBC0_GLBAC + IMX_TRDC_NUM_GLBAC * 4) {
+        s->glbac[(offset - TRDC_MBC0_GLBAC) / 4] = value;
+        imx_trdc_update(s);
+        return;
+    }
+    if (offset >= TRDC_MBC0_BLK_CFG && offset < TRDC_MBC0_BLK_CFG +
+            IMX_TRDC_NUM_DOMAINS * TRDC_MBC0_DOM_STRIDE) {
+        blk = offset - TRDC_MBC0_BLK_CFG;
+        if ((blk % TRDC_MBC0_DOM_STRIDE) / 4 < s->num_blocks / 8) {
+            s->blk_cfg[blk / TRDC_MBC0_DOM_STRIDE]
+                [(blk % TRDC_MBC0_DOM_STRIDE) / 4] = value;
+            imx_trdc_update(s);
+            return;
+        }
+    }
+    qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%" HWADDR_PRIx "\n",
+            __func__, offset);
+}
+
+static const MemoryRegionOps imx_trdc_ops = {
+    .read = imx_trdc_read,
+    .write = imx_trdc_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+/* Target of read-only blocks: reads pass through, writes fault */
+static MemTxResult imx_trdc_readonly_read(void *opaque, hwaddr addr,
+        uint64_t *pdata, unsigned size, MemTxAttrs attrs)
+{
+    imx_trdc_state *s = (imx_trdc_state *)opaque;
+    uint8_t buf[8];
+    MemTxResult res;
+
+    res = address_space_read(&s->downstream_as, addr, attrs, buf, size);
+    *pdata = ldn_le_p(buf, size);
+    return res;
+}
+
+static MemTxResult imx_trdc_blocked_read(void *opaque, hwaddr addr,
+        uint64_t *pdata, unsigned size, MemTxAttrs attrs)
+{
+    qemu_log_mask(LOG_GUEST_ERROR, "TRDC: blocked read at 0x%" HWADDR_PRIx
+            "\n", addr);
+    *pdata = 0;
+    return MEMTX_ERROR;
+}
+
+static MemTxResult imx_trdc_blocked_write(void *opaque, hwaddr addr,
+        uint64_t value, unsigned size, MemTxAttrs attrs)
+{
+    qemu_log_mask(LOG_GUEST_ERROR, "TRDC: blocked write at 0x%" HWADDR_PRIx
+            "\n", addr);
+    return MEMTX_ERROR;
+}
+
+static const MemoryRegionOps imx_trdc_readonly_ops = {
+    .read_with_attrs = imx_trdc_readonly_read,
+    .write_with_attrs = imx_trdc_blocked_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 8,
+    .impl.min_access_size = 1,
+    .impl.max_access_size = 8,
+};
+
+static const MemoryRegionOps imx_trdc_blocked_ops = {
+    .read_with_attrs = imx_trdc_blocked_read,
+    .write_with_attrs = imx_trdc_blocked_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 8,
+    .impl.min_access_size = 1,
+    .impl.max_access_size = 8,
+};
+
+static IOMMUTLBEntry imx_trdc_translate(IOMMUMemoryRegion *iommu,
+        hwaddr addr, IOMMUAccessFlags flags, int iommu_idx)
+{
+    imx_trdc_state *s = container_of(iommu, imx_trdc_state, upstream);
+    IOMMUTLBEntry ret = {
+        .iova = addr & ~TRDC_BLK_MASK,
+        .translated_addr = addr & ~TRDC_BLK_MASK,
+        .addr_mask = TRDC_BLK_MASK,
+        .perm = IOMMU_RW,
+    };
+
+    ret.target_as = imx_trdc_target_as(s,
+            s->perm[iommu_idx][addr >> IMX_TRDC_BLK_SHIFT]);
+    return ret;
+}
+
+static int imx_trdc_attrs_to_index(IOMMUMemoryRegion *iommu,
+        MemTxAttrs attrs)
+{
+    return (attrs.secure << 1) | attrs.user;
+}
+
+static int imx_trdc_num_indexes(IOMMUMemoryRegion *iommu)
+{
+    return IMX_TRDC_NUM_IDX;
+}
+
+static int imx_trdc_post_load(void *opaque, int version_id)
+{
+    imx_trdc_update(opaque);
+    return 0;
+}
+
+static const VMStateDescription imx_trdc_vm = {
+    .name = TYPE_IMX_TRDC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = imx_trdc_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(cr, imx_trdc_state),
+        VMSTATE_UINT32(mda, imx_trdc_state),
+        VMSTATE_UINT32_ARRAY(glbac, imx_trdc_state, IMX_TRDC_NUM_GLBAC),
+        VMSTATE_UINT32_2DARRAY(blk_cfg, imx_trdc_state,
+                IMX_TRDC_NUM_DOMAINS, IMX_TRDC_MAX_BLOCKS / 8),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_trdc_init(Object *obj)
+{
+    imx_trdc_state *s = IMX_TRDC(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_trdc_ops, s, TYPE_IMX_TRDC,
+            0x20000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+}
+
+static void imx_trdc_realize(DeviceState *dev, Error **errp)
+{
+    imx_trdc_state *s = IMX_TRDC(dev);
+    uint64_t size;
+
+    if (!s->downstream) {
+        error_setg(errp, "%s: downstream link not set", TYPE_IMX_TRDC);
+        return;
+    }
+    size = memory_region_size(s->downstream);
+    s->num_blocks = DIV_ROUND_UP(size, 1 << IMX_TRDC_BLK_SHIFT);
+    if (s->num_blocks > IMX_TRDC_MAX_BLOCKS) {
+        error_setg(errp, "%s: downstream larger than %d blocks",
+                TYPE_IMX_TRDC, IMX_TRDC_MAX_BLOCKS);
+        return;
+    }
+
+    memory_region_init_iommu(&s->upstream, sizeof(s->upstream),
+            TYPE_IMX_TRDC_IOMMU_MEMORY_REGION, OBJECT(s), "trdc-upstream",
+            size);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), MEMORY_REGION(&s->upstream));
+
+    address_space_init(&s->downstream_as, s->downstream, "trdc-downstream");
+    memory_region_init_io(&s->readonly_io, OBJECT(s), &imx_trdc_readonly_ops,
+            s, "trdc-readonly", size);
+    address_space_init(&s->readonly_as, &s->readonly_io, "trdc-readonly");
+    memory_region_init_io(&s->blocked_io, OBJECT(s), &imx_trdc_blocked_ops,
+            s, "trdc-blocked", size);
+    address_space_init(&s->blocked_as, &s->blocked_io, "trdc-blocked");
+
+    /* Everything is open until the guest sets GVLDM */
+    memset(s->perm, IMX_TRDC_PERM_R | IMX_TRDC_PERM_W, sizeof(s->perm));
+}
+
+static void imx_trdc_reset(DeviceState *dev)
+{
+    imx_trdc_state *s = IMX_TRDC(dev);
+
+    s->cr = 0;
+    s->mda = 0;
+    memset(s->glbac, 0, sizeof(s->glbac));
+    memset(s->blk_cfg, 0, sizeof(s->blk_cfg));
+    imx_trdc_update(s);
+}
+
+static Property imx_trdc_properties[] = {
+    DEFINE_PROP_LINK("downstream", imx_trdc_state, downstream,
+            TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_trdc_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_trdc_realize;
+    dc->reset = imx_trdc_reset;
+    dc->vmsd = &imx_trdc_vm;
+    dc->props = imx_trdc_properties;
+}
+
+static void imx_trdc_iommu_memory_region_class_init(ObjectClass *klass,
+        void *data)
+{
+    IOMMUMemoryRegionClass *imrc = IOMMU_MEMORY_REGION_CLASS(klass);
+
+    imrc->translate = imx_trdc_translate;
+    imrc->attrs_to_index = imx_trdc_attrs_to_index;
+    imrc->num_indexes = imx_trdc_num_indexes;
+}
+
+static const TypeInfo imx_trdc_info = {
+    .name          = TYPE_IMX_TRDC,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_trdc_state),
+    .instance_init = imx_trdc_init,
+    .class_init    = imx_trdc_class_init,
+};
+
+static const TypeInfo imx_trdc_iommu_memory_region_info = {
+    .name = TYPE_IMX_TRDC_IOMMU_MEMORY_REGION,
+    .parent = TYPE_IOMMU_MEMORY_REGION,
+    .class_init = imx_trdc_iommu_memory_region_class_init,
+};
+
+static void imx_trdc_types(void)
+{
+    type_register_static(&imx_trdc_info);
+    type_register_static(&imx_trdc_iommu_memory_region_info);
+}
+
+type_init(imx_trdc_types)
+
+/*=======================================
+    eDMA Module Start
+ ========================================*/
+/*
+ * eDMA with a management page and IMX_EDMA_NUM_CH channel pages.  Only
+ * software requests (TCD_CSR.START) and channel links start a channel;
+ * each request runs one whole minor loop.
+ *
+ * The MSC sits between the engine and the bus.  Instead of letting it
+ * check every beat, the source and destination spans of a minor loop are
+ * checked once against the same IDAU/cfg_nonsec rules tz-msc applies.
+ * If the whole span is allowed with one security attribute the loop is
+ * copied in bulk straight on the system address space, mapped with
+ * address_space_map() where it is RAM.  Anything else (a block, or a
+ * span crossing a security boundary) goes beat by beat through the MSC,
+ * which then does the blocking and raises its own interrupt.
+ */
+#define EDMA_MP_CSR             0x000
+#define EDMA_MP_ES              0x004
+#define EDMA_MP_INT             0x008
+#define EDMA_MP_HRS             0x00C
+
+#define EDMA_CH_CSR             0x00
+#define EDMA_CH_ES              0x04
+#define EDMA_CH_INT             0x08
+#define EDMA_CH_SBR             0x0C
+#define EDMA_CH_PRI             0x10
+#define EDMA_CH_TCD             0x20
+
+#define EDMA_MP_CSR_HALT        (1 << 5)
+#define EDMA_MP_CSR_ACTIVE      (1u << 31)
+
+#define EDMA_CH_CSR_ERQ         (1 << 0)
+#define EDMA_CH_CSR_EEI         (1 << 2)
+#define EDMA_CH_CSR_DONE        (1 << 30)
+#define EDMA_CH_CSR_ACTIVE      (1u << 31)
+
+#define EDMA_ES_DBE             (1 << 0)
+#define EDMA_ES_SBE             (1 << 1)
+#define EDMA_ES_SGE             (1 << 2)
+#define EDMA_ES_NCE             (1 << 3)
+#define EDMA_ES_ERR             (1u << 31)
+
+/* TCD layout, offsets into imx_edma_chan.tcd */
+#define TCD_SADDR               0x00
+#define TCD_SOFF                0x04
+#define TCD_ATTR                0x06
+#define TCD_NBYTES              0x08
+#define TCD_SLAST               0x0C
+#define TCD_DADDR               0x10
+#define TCD_DOFF                0x14
+#define TCD_CITER               0x16
+#define TCD_DLAST_SGA           0x18
+#define TCD_CSR                 0x1C
+#define TCD_BITER               0x1E
+
+#define TCD_CSR_START           (1 << 0)
+#define TCD_CSR_INTMAJOR        (1 << 1)
+#define TCD_CSR_INTHALF         (1 << 2)
+#define TCD_CSR_DREQ            (1 << 3)
+#define TCD_CSR_ESG             (1 << 4)
+#define TCD_CSR_MAJORELINK      (1 << 5)
+
+#define TCD_ITER_ELINK          (1 << 15)
+#define TCD_NBYTES_SMLOE        (1u << 31)
+#define TCD_NBYTES_DMLOE        (1 << 30)
+
+/* Smallest IDAU region granule on this board, see imx8ulp_m33_idau_check */
+#define IMX_MSC_GRANULE         0x100000
+
+static void imx_edma_start(imx_edma_state *s, int ch);
+
+static void imx_edma_update_irq(imx_edma_state *s, int ch)
+{
+    qemu_set_irq(s->irq[ch], s->ch[ch].intr & 1);
+}
+
+static void imx_edma_error(imx_edma_state *s, int ch, uint32_t err)
+{
+    imx_edma_chan *c = &s->ch[ch];
+
+    c->es |= err | EDMA_ES_ERR;
+    s->es = EDMA_ES_ERR | (ch << 24) | err;
+    c->csr &= ~EDMA_CH_CSR_ERQ;
+    if (c->csr & EDMA_CH_CSR_EEI) {
+        qemu_irq_raise(s->err_irq);
+    }
+}
+
+/*
+ * Mirror tz_msc_check() over [lo, hi]: true if every granule is allowed
+ * with the same security attribute, which is then set in attrs.  Shared
+ * with the crypto engine, which masters the bus through an MSC too.
+ */
+static bool imx_msc_allows(TZMSC *msc, Object *idau, hwaddr lo, hwaddr hi,
+        MemTxAttrs *attrs)
+{
+    IDAUInterfaceClass *iic = IDAU_INTERFACE_GET_CLASS(idau);
+    IDAUInterface *ii = IDAU_INTERFACE(idau);
+    hwaddr addr = lo;
+    int secure = -1;
+
+    for (;;) {
+        bool exempt = false, ns = true, nsc = true;
+        int region = IREGION_NOTVALID;
+        int sec;
+
+        iic->check(ii, addr, &region, &exempt, &ns, &nsc);
+        if (exempt) {
+            sec = !msc->cfg_nonsec;
+        } else if (ns) {
+            sec = 0;
+        } else if (!msc->cfg_nonsec) {
+            sec = 1;
+        } else {
+            return false;
+        }
+        if (secure >= 0 && sec != secure) {
+            return false;
+        }
+        secure = sec;
+
+        if (addr >= QEMU_ALIGN_DOWN(hi, IMX_MSC_GRANULE)) {
+            break;
+        }
+        addr = QEMU_ALIGN_DOWN(addr, IMX_MSC_GRANULE) + IMX_MSC_GRANULE;
+    }
+
+    attrs->secure = secure;
+    return true;
+}
+
+static void imx_edma_span(uint32_t addr, int32_t off, uint32_t size,
+        uint32_t nbytes, hwaddr *lo, hwaddr *hi)
+{
+    int64_t last = (int64_t)off * (nbytes / size - 1);
+
+    *lo = (hwaddr)addr + MIN(last, 0);
+    *hi = (hwaddr)addr + MAX(last, 0) + size - 1;
+}
+
+/*
+ * True if [addr, addr + len) is one directly accessible RAM section, so
+ * address_space_map() hands out a host pointer instead of bouncing (and,
+ * for a read, touching a device).
+ */
+static bool imx_edma_direct(AddressSpace *as, hwaddr addr, hwaddr len,
+        bool is_write, MemTxAttrs attrs)
+{
+    MemoryRegion *mr;
+    hwaddr xlat, l = len;
+    bool direct;
+
+    rcu_read_lock();
+    mr = address_space_translate(as, addr, &xlat, &l, is_write, attrs);
+    direct = l == len && memory_access_is_direct(mr, is_write);
+    rcu_read_unlock();
+    return direct;
+}
+
+/*
+ * Contiguous copy on the system address space, zero-copy if both are RAM.
+ * The path is picked before anything is mapped: mapping a device source
+ * would already read it into the bounce buffer, and the bounce copy
+ * below would then read it a second time.
+ */
+static MemTxResult imx_edma_bulk(hwaddr src, hwaddr dst, hwaddr len,
+        MemTxAttrs sattrs, MemTxAttrs dattrs, uint32_t *err)
+{
+    AddressSpace *as = &address_space_memory;
+    hwaddr slen = len, dlen = len;
+    void *sp = NULL, *dp = NULL;
+    uint8_t *buf;
+    MemTxResult res;
+
+    if (imx_edma_direct(as, src, len, false, sattrs) &&
+            imx_edma_direct(as, dst, len, true, dattrs)) {
+        sp = address_space_map(as, src, &slen, false, sattrs);
+        dp = sp ? address_space_map(as, dst, &dlen, true, dattrs) : NULL;
+    }
+    if (sp && dp && slen == len && dlen == len) {
+        memmove(dp, sp, len);
+        address_space_unmap(as, dp, dlen, true, len);
+        address_space_unmap(as, sp, slen, false, len);
+        return MEMTX_OK;
+    }
+    /* Only RAM was mapped here, so nothing has been read or written yet */
+    if (dp) {
+        address_space_unmap(as, dp, dlen, true, 0);
+    }
+    if (sp) {
+        address_space_unmap(as, sp, slen, false, 0);
+    }
+
+    /* Not all RAM: bounce, still one access per side */
+    buf = g_malloc(len);
+    res = address_space_read(as, src, sattrs, buf, len);
+    if (res != MEMTX_OK) {
+        *err |= EDMA_ES_SBE;
+    } else {
+        res = address_space_write(as, dst, dattrs, buf, len);
+        if (res != MEMTX_OK) {
+            *err |= EDMA_ES_DBE;
+        }
+    }
+    g_free(buf);
+    return res;
+}
+
+/* Beat by beat through the MSC */
+static void imx_edma_beats(imx_edma_state *s, uint32_t saddr, int32_t soff,
+        uint32_t ssize, uint32_t daddr, int32_t doff, uint32_t dsize,
+        uint32_t nbytes, uint32_t *err)
+{
+    uint8_t *buf = g_malloc(nbytes);
+    uint32_t i;
+
+    for (i = 0; i < nbytes; i += ssize, saddr += soff) {
+        if (address_space_read(&s->downstream_as, saddr,
+                    MEMTXATTRS_UNSPECIFIED, buf + i, ssize) != MEMTX_OK) {
+            *err |= EDMA_ES_SBE;
+            goto out;
+        }
+    }
+    for (i = 0; i < nbytes; i += dsize, daddr += doff) {
+        if (address_space_write(&s->downstream_as, daddr,
+                    MEMTXATTRS_UNSPECIFIED, buf + i, dsize) != MEMTX_OK) {
+            *err |= EDMA_ES_DBE;
+            goto out;
+        }
+    }
+out:
+    g_free(buf);
+}
+
+static void imx_edma_copy(imx_edma_state *s, uint32_t saddr, int32_t soff,
+        uint32_t ssize, uint32_t daddr, int32_t doff, uint32_t dsize,
+        uint32_t nbytes, uint32_t *err)
+{
+    MemTxAttrs sattrs = MEMTXATTRS_UNSPECIFIED;
+    MemTxAttrs dattrs = MEMTXATTRS_UNSPECIFIED;
+    hwaddr slo, shi, dlo, dhi;
+
+    imx_edma_span(saddr, soff, ssize, nbytes, &slo, &shi);
+    imx_edma_span(daddr, doff, dsize, nbytes, &dlo, &dhi);
+
+    if (soff == ssize && doff == dsize &&
+            imx_msc_allows(s->msc, s->idau, slo, shi, &sattrs) &&
+            imx_msc_allows(s->msc, s->idau, dlo, dhi, &dattrs)) {
+        imx_edma_bulk(saddr, daddr, nbytes, sattrs, dattrs, err);
+        return;
+    }
+    imx_edma_beats(s, saddr, soff, ssize, daddr, doff, dsize, nbytes, err);
+}
+
+/* Load the next TCD for scatter/gather */
+static bool imx_edma_load_tcd(imx_edma_state *s, int ch, uint32_t addr)
+{
+    imx_edma_chan *c = &s->ch[ch];
+    uint8_t tcd[IMX_EDMA_TCD_SIZE];
+
+    if (addr & (IMX_EDMA_TCD_SIZE - 1) ||
+            address_space_read(&s->downstream_as, addr,
+                MEMTXATTRS_UNSPECIFIED, tcd, sizeof(tcd)) != MEMTX_OK) {
+        return false;
+    }
+    memcpy(c->tcd, tcd, sizeof(tcd));
+    return true;
+}
+
+static void imx_edma_run(imx_edma_state *s, int ch)
+{
+    imx_edma_chan *c = &s->ch[ch];
+    uint8_t *t = c->tcd;
+    uint32_t saddr = ldl_le_p(t + TCD_SADDR);
+    uint32_t daddr = ldl_le_p(t + TCD_DADDR);
+    int32_t soff = (int16_t)lduw_le_p(t + TCD_SOFF);
+    int32_t doff = (int16_t)lduw_le_p(t + TCD_DOFF);
+    uint32_t attr = lduw_le_p(t + TCD_ATTR);
+    uint32_t nbytes_reg = ldl_le_p(t + TCD_NBYTES);
+    uint32_t citer_reg = lduw_le_p(t + TCD_CITER);
+    uint32_t biter_reg = lduw_le_p(t + TCD_BITER);
+    uint32_t tcsr = lduw_le_p(t + TCD_CSR);
+    uint32_t ssize = 1 << extract32(attr, 8, 3);
+    uint32_t dsize = 1 << extract32(attr, 0, 3);
+    uint32_t nbytes, citer, biter, citer_mask;
+    int32_t mloff = 0;
+    uint32_t err = 0;
+
+    tcsr &= ~TCD_CSR_START;
+    stw_le_p(t + TCD_CSR, tcsr);
+    c->csr = (c->csr & ~EDMA_CH_CSR_DONE) | EDMA_CH_CSR_ACTIVE;
+
+    if (nbytes_reg & (TCD_NBYTES_SMLOE | TCD_NBYTES_DMLOE)) {
+        nbytes = extract32(nbytes_reg, 0, 10);
+        mloff = sextract32(nbytes_reg, 10, 20);
+    } else {
+        nbytes = extract32(nbytes_reg, 0, 30);
+    }
+    citer_mask = citer_reg & TCD_ITER_ELINK ? 0x1ff : 0x7fff;
+    citer = citer_reg & citer_mask;
+    biter = biter_reg & (biter_reg & TCD_ITER_ELINK ? 0x1ff : 0x7fff);
+
+    if (!nbytes || nbytes % ssize || nbytes % dsize || ssize > 64 ||
+            dsize > 64 || !citer || !biter) {
+        c->csr &= ~EDMA_CH_CSR_ACTIVE;
+        imx_edma_error(s, ch, EDMA_ES_NCE);
+        return;
+    }
+    if (extract32(attr, 3, 5) || extract32(attr, 11, 5)) {
+        qemu_log_mask(LOG_UNIMP, "%s: address modulo not supported\n",
+                __func__);
+    }
+
+    imx_edma_copy(s, saddr, soff, ssize, daddr, doff, dsize, nbytes, &err);
+    c->csr &= ~EDMA_CH_CSR_ACTIVE;
+    if (err) {
+        imx_edma_error(s, ch, err);
+        return;
+    }
+
+    saddr += soff * (nbytes / ssize);
+    daddr += doff * (nbytes / dsize);
+    if (nbytes_reg & TCD_NBYTES_SMLOE) {
+        saddr += mloff;
+    }
+    if (nbytes_reg & TCD_NBYTES_DMLOE) {
+        daddr += mloff;
+    }
+    citer--;
+
+    if (citer) {
+        stl_le_p(t + TCD_SADDR, saddr);
+        stl_le_p(t + TCD_DADDR, daddr);
+        stw_le_p(t + TCD_CITER, (citer_reg & ~citer_mask) | citer);
+        if ((tcsr & TCD_CSR_INTHALF) && citer == biter / 2) {
+            c->intr = 1;
+            imx_edma_update_irq(s, ch);
+        }
+        if (citer_reg & TCD_ITER_ELINK) {
+            imx_edma_start(s, extract32(citer_reg, 9, 4));
+        }
+        return;
+    }
+
+    /* Major loop done */
+    c->csr |= EDMA_CH_CSR_DONE;
+    if (tcsr & TCD_CSR_DREQ) {
+        c->csr &= ~EDMA_CH_CSR_ERQ;
+    }
+    if (tcsr & TCD_CSR_INTMAJOR) {
+        c->intr = 1;
+        imx_edma_update_irq(s, ch);
+    }
+    stl_le_p(t + TCD_SADDR, saddr + ldl_le_p(t + TCD_SLAST));
+    if (tcsr & TCD_CSR_ESG) {
+        if (!imx_edma_load_tcd(s, ch, ldl_le_p(t + TCD_DLAST_SGA))) {
+            imx_edma_error(s, ch, EDMA_ES_SGE);
+            return;
+        }
+        if (lduw_le_p(t + TCD_CSR) & TCD_CSR_START) {
+            imx_edma_start(s, ch);
+        }
+    } else {
+        stl_le_p(t + TCD_DADDR, daddr + ldl_le_p(t + TCD_DLAST_SGA));
+        stw_le_p(t + TCD_CITER, biter_reg);
+    }
+    if (tcsr & TCD_CSR_MAJORELINK) {
+        imx_edma_start(s, extract32(tcsr, 8, 4));
+    }
+}
+
+/*
+ * Queue a service request.  Links are queued rather than run
+ * recursively, and the loop drains them in channel order.
+ */
+static void imx_edma_start(imx_edma_state *s, int ch)
+{
+    s->pending |= 1 << ch;
+    if (s->running) {
+        return;
+    }
+
+    s->running = true;
+    while (s->pending && !(s->csr & EDMA_MP_CSR_HALT)) {
+        ch = ctz32(s->pending);
+        s->pending &= ~(1 << ch);
+        imx_edma_run(s, ch);
+    }
+    s->running = false;
+}
+
+static uint64_t imx_edma_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_edma_state *s = (imx_edma_state *)opaque;
+    imx_edma_chan *c;
+    uint32_t ret = 0;
+    int ch;
+
+    if (offset < IMX_EDMA_CH_STRIDE) {
+        switch (offset) {
+        case EDMA_MP_CSR:
+            return s->csr;
+        case EDMA_MP_ES:
+            return s->es;
+        case EDMA_MP_INT:
+            for (ch = 0; ch < IMX_EDMA_NUM_CH; ch++) {
+                ret |= (s->ch[ch].intr & 1) << ch;
+            }
+            return ret;
+        }
+        return 0;
+    }
+
+    ch = offset / IMX_EDMA_CH_STRIDE - 1;
+    c = &s->ch[ch];
+    offset &= IMX_EDMA_CH_STRIDE - 1;
+    if (offset >= EDMA_CH_TCD && offset + size <= EDMA_CH_TCD +
+            IMX_EDMA_TCD_SIZE) {
+        return ldn_le_p(c->tcd + offset - EDMA_CH_TCD, size);
+    }
+    switch (offset) {
+    case EDMA_CH_CSR:
+        return c->csr;
+    case EDMA_CH_ES:
+        return c->es;
+    case EDMA_CH_INT:
+        return c->intr;
+    case EDMA_CH_SBR:
+        return c->sbr;
+    case EDMA_CH_PRI:
+        return c->pri;
+    }
+    return 0;
+}
+
+static void imx_edma_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_edma_state *s = (imx_edma_state *)opaque;
+    imx_edma_chan *c;
+    int ch;
+
+    if (offset < IMX_EDMA_CH_STRIDE) {
+        switch (offset) {
+        case EDMA_MP_CSR:
+            s->csr = value & ~EDMA_MP_CSR_ACTIVE;
+            if (!(s->csr & EDMA_MP_CSR_HALT) && s->pending) {
+                imx_edma_start(s, ctz32(s->pending));
+            }
+            break;
+        case EDMA_MP_ES:
+            break;
+        }
+        return;
+    }
+
+    ch = offset / IMX_EDMA_CH_STRIDE - 1;
+    c = &s->ch[ch];
+    offset &= IMX_EDMA_CH_STRIDE - 1;
+    if (offset >= EDMA_CH_TCD && offset + size <= EDMA_CH_TCD +
+            IMX_EDMA_TCD_SIZE) {
+        stn_le_p(c->tcd + offset - EDMA_CH_TCD, size, value);
+        if (lduw_le_p(c->tcd + TCD_CSR) & TCD_CSR_START) {
+            imx_edma_start(s, ch);
+        }
+        return;
+    }
+    switch (offset) {
+    case EDMA_CH_CSR:
+        c->csr = (c->csr & ~(0xF | (value & EDMA_CH_CSR_DONE))) |
+            (value & 0xF);
+        break;
+    case EDMA_CH_ES:
+        if (value & EDMA_ES_ERR) {
+            c->es = 0;
+            qemu_irq_lower(s->err_irq);
+        }
+        break;
+    case EDMA_CH_INT:
+        if (value & 1) {
+            c->intr = 0;
+            imx_edma_update_irq(s, ch);
+        }
+        break;
+    case EDMA_CH_SBR:
+        c->sbr = value;
+        break;
+    case EDMA_CH_PRI:
+        c->pri = value;
+        break;
+    }
+}
+
+static const MemoryRegionOps imx_edma_ops = {
+    .read = imx_edma_read,
+    .write = imx_edma_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 4,
+    .impl.min_access_size = 1,
+    .impl.max_access_size = 4,
+};
+
+static const VMStateDescription imx_edma_chan_vm = {
+    .name = "imx_edma_chan",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(csr, imx_edma_chan),
+        VMSTATE_UINT32(es, imx_edma_chan),
+        VMSTATE_UINT32(intr, imx_edma_chan),
+        VMSTATE_UINT32(sbr, imx_edma_chan),
+        VMSTATE_UINT32(pri, imx_edma_chan),
+        VMSTATE_UINT8_ARRAY(tcd, imx_edma_chan, IMX_EDMA_TCD_SIZE),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription imx_edma_vm = {
+    .name = TYPE_IMX_EDMA,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(csr, imx_edma_state),
+        VMSTATE_UINT32(es, imx_edma_state),
+        VMSTATE_UINT32(pending, imx_edma_state),
+        VMSTATE_STRUCT_ARRAY(ch, imx_edma_state, IMX_EDMA_NUM_CH, 1,
+                imx_edma_chan_vm, imx_edma_chan),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_edma_init(Object *obj)
+{
+    imx_edma_state *s = IMX_EDMA(obj);
+    int i;
+
+    memory_region_init_io(&s->iomem, obj, &imx_edma_ops, s, TYPE_IMX_EDMA,
+            (IMX_EDMA_NUM_CH + 1) * IMX_EDMA_CH_STRIDE);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    for (i = 0; i < IMX_EDMA_NUM_CH; i++) {
+        sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq[i]);
+    }
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->err_irq);
+}
+
+static void imx_edma_realize(DeviceState *dev, Error **errp)
+{
+    imx_edma_state *s = IMX_EDMA(dev);
+
+    if (!s->downstream || !s->msc || !s->idau) {
+        error_setg(errp, "%s: downstream, msc and idau must be set",
+                TYPE_IMX_EDMA);
+        return;
+    }
+    address_space_init(&s->downstream_as, s->downstream, "edma-downstream");
+}
+
+static void imx_edma_reset(DeviceState *dev)
+{
+    imx_edma_state *s = IMX_EDMA(dev);
+    int i;
+
+    s->csr = 0;
+    s->es = 0;
+    s->pending = 0;
+    memset(s->ch, 0, sizeof(s->ch));
+    for (i = 0; i < IMX_EDMA_NUM_CH; i++) {
+        imx_edma_update_irq(s, i);
+    }
+    qemu_irq_lower(s->err_irq);
+}
+
+static Property imx_edma_properties[] = {
+    DEFINE_PROP_LINK("downstream", imx_edma_state, downstream,
+            TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_LINK("msc", imx_edma_state, msc, TYPE_TZ_MSC, TZMSC *),
+    DEFINE_PROP_LINK("idau", imx_edma_state, idau, TYPE_IDAU_INTERFACE,
+            Object *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_edma_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_edma_realize;
+    dc->reset = imx_edma_reset;
+    dc->vmsd = &imx_edma_vm;
+    dc->props = imx_edma_properties;
+}
+
+static const TypeInfo imx_edma_info = {
+    .name          = TYPE_IMX_EDMA,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_edma_state),
+    .instance_init = imx_edma_init,
+    .class_init    = imx_edma_class_init,
+};
+
+static void imx_edma_types(void)
+{
+    type_register_static(&imx_edma_info);
+}
+
+type_init(imx_edma_types)
+
+/*=======================================
+    CMC Module Start
+ ========================================*/
+/*
+ * Core Mode Controller.  The guest picks a low-power mode in CKCTRL, sets
+ * SCR.SLEEPDEEP and executes WFI.  The board calls imx_cmc_core_sleep()
+ * when an interrupt reaches the sleeping core, and CKSTAT then reports
+ * the mode it was in.  WFI
+ * already halts the vCPU, so the host thread sleeps until an interrupt
+ * arrives.  To also skip the idle virtual time up to the next timer
+ * deadline, run with -icount shift=N,sleep=off; the board cannot turn
+ * that on.
+ */
+#define CMC_CKCTRL              0x10
+#define CMC_CKSTAT              0x14
+#define CMC_PMPROT              0x18
+#define CMC_PMCTRL              0x20
+#define CMC_SRS                 0x80
+#define CMC_SSRS                0x88
+#define CMC_MR0                 0xA0
+
+#define CMC_CKMODE_MASK         0xF
+#define CMC_LOCK                (1u << 31)
+#define CMC_CKSTAT_VALID        (1u << 31)
+
+/* SRS / SSRS */
+#define CMC_SRS_POR             (1 << 1)
+#define CMC_SRS_SW              (1 << 10)
+
+static uint64_t imx_cmc_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_cmc_state *s = (imx_cmc_state *)opaque;
+
+    return s->reg[offset / 4];
+}
+
+static void imx_cmc_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_cmc_state *s = (imx_cmc_state *)opaque;
+    uint32_t *reg = &s->reg[offset / 4];
+    uint32_t mode;
+
+    switch (offset) {
+    case CMC_CKCTRL:
+        if (*reg & CMC_LOCK) {
+            break;
+        }
+        mode = value & CMC_CKMODE_MASK;
+        /* PMPROT holds one allow bit per mode, RUN is always allowed */
+        if (mode && !(s->reg[CMC_PMPROT / 4] & (1 << mode))) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: mode %d not allowed\n",
+                    __func__, mode);
+            break;
+        }
+        *reg = value & (CMC_LOCK | CMC_CKMODE_MASK);
+        break;
+    case CMC_CKSTAT:
+        if (value & CMC_CKSTAT_VALID) {
+            *reg = 0;
+        }
+        break;
+    case CMC_PMPROT:
+    case CMC_PMCTRL:
+        if (!(*reg & CMC_LOCK)) {
+            *reg = value;
+        }
+        break;
+    case CMC_SRS:
+    case CMC_MR0:
+        break;
+    case CMC_SSRS:
+        *reg &= ~value;
+        break;
+    default:
+        *reg = value;
+        break;
+    }
+}
+
+/*
+ * The core is asleep in WFI.  Only a deep sleep hands over to the CMC; a
+ * plain sleep just gates the core clock.
+ */
+void imx_cmc_core_sleep(imx_cmc_state *s, bool deep)
+{
+    uint32_t mode = atomic_read(&s->reg[CMC_CKCTRL / 4]) & CMC_CKMODE_MASK;
+
+    if (deep && mode) {
+        atomic_set(&s->reg[CMC_CKSTAT / 4], CMC_CKSTAT_VALID | mode);
+    }
+}
+
+static const MemoryRegionOps imx_cmc_ops = {
+    .read = imx_cmc_read,
+    .write = imx_cmc_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static const VMStateDescription imx_cmc_vm = {
+    .name = TYPE_IMX_CMC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_BOOL(cold, imx_cmc_state),
+        VMSTATE_UINT32_ARRAY(reg, imx_cmc_state, IMX_CMC_SIZE / 4),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_cmc_init(Object *obj)
+{
+    imx_cmc_state *s = IMX_CMC(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_cmc_ops, s, TYPE_IMX_CMC,
+            IMX_CMC_SIZE);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    s->cold = true;
+}
+
+/* Any reset after the first one came from the system, not the supply */
+static void imx_cmc_reset(DeviceState *dev)
+{
+    imx_cmc_state *s = IMX_CMC(dev);
+    uint32_t srs = s->cold ? CMC_SRS_POR : CMC_SRS_SW;
+    uint32_t ssrs = s->cold ? 0 : s->reg[CMC_SSRS / 4];
+
+    memset(s->reg, 0, sizeof(s->reg));
+    s->reg[CMC_SRS / 4] = srs;
+    s->reg[CMC_SSRS / 4] = ssrs | srs;
+    s->reg[CMC_MR0 / 4] = s->mr0_reset;
+    s->cold = false;
+}
+
+static Property imx_cmc_properties[] = {
+    DEFINE_PROP_UINT32("mr0", imx_cmc_state, mr0_reset, 0),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_cmc_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = imx_cmc_reset;
+    dc->vmsd = &imx_cmc_vm;
+    dc->props = imx_cmc_properties;
+}
+
+static const TypeInfo imx_cmc_info = {
+    .name          = TYPE_IMX_CMC,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_cmc_state),
+    .instance_init = imx_cmc_init,
+    .class_init    = imx_cmc_class_init,
+};
+
+static void imx_cmc_types(void)
+{
+    type_register_static(&imx_cmc_info);
+}
+
+type_init(imx_cmc_types)
+
+/*=======================================
+    uPower Module Start
+ ========================================*/
+/*
+ * uPower behind its MU.  The guest writes the arguments to TR1..TR3 and
+ * then the header to TR0, which sends the request.  The header follows
+ * the upower_api layout: domain[0], service group[4:1], function[8:5].
+ * The request completes delay_ns of virtual time later: the response
+ * goes to RR0/RR1, RSR flags it and the IRQ fires if RCR enables it, so
+ * firmware can WFI instead of polling.  The response header echoes the
+ * request with an error code in [12:9].
+ */
+#define UPWR_MU_VER             0x000
+#define UPWR_MU_PAR             0x004
+#define UPWR_MU_CR              0x008
+#define UPWR_MU_SR              0x00C
+#define UPWR_MU_TCR             0x120
+#define UPWR_MU_TSR             0x124
+#define UPWR_MU_RCR             0x128
+#define UPWR_MU_RSR             0x12C
+#define UPWR_MU_TR              0x200
+#define UPWR_MU_RR              0x280
+
+#define UPWR_SG_EXCEPT          0
+#define UPWR_SG_PWRMGMT         1
+
+/* UPWR_SG_EXCEPT */
+#define UPWR_XCP_INIT           0
+#define UPWR_XCP_PING           1
+
+/* UPWR_SG_PWRMGMT: arg1 = mask, arg2 = new value for the masked bits */
+#define UPWR_PWM_SWITCH         1
+#define UPWR_PWM_RETAIN         2
+#define UPWR_PWM_STATUS         3
+
+#define UPWR_RESP_OK            0
+#define UPWR_RESP_BAD_REQ       1
+#define UPWR_RESP_BUSY          2
+
+#define UPWR_DEFAULT_DELAY_NS   20000
+
+static void imx_upower_update_irq(imx_upower_state *s)
+{
+    qemu_set_irq(s->irq, !!(s->rsr & s->rcr));
+}
+
+static void imx_upower_respond(imx_upower_state *s, uint32_t hdr,
+        uint32_t err, uint32_t ret)
+{
+    s->rr[0] = deposit32(hdr, 9, 4, err);
+    s->rr[1] = ret;
+    s->rsr |= 0x3;
+    imx_upower_update_irq(s);
+}
+
+static void imx_upower_complete(void *opaque)
+{
+    imx_upower_state *s = opaque;
+    uint32_t hdr = s->req[0];
+    uint32_t mask = s->req[1], val = s->req[2];
+    uint32_t ret = 0, err = UPWR_RESP_OK;
+
+    s->busy = false;
+    switch (extract32(hdr, 1, 4)) {
+    case UPWR_SG_EXCEPT:
+        break;
+    case UPWR_SG_PWRMGMT:
+        switch (extract32(hdr, 5, 4)) {
+        case UPWR_PWM_SWITCH:
+            s->switches = (s->switches & ~mask) | (val & mask);
+            ret = s->switches;
+            break;
+        case UPWR_PWM_RETAIN:
+            s->retention = (s->retention & ~mask) | (val & mask);
+            ret = s->retention;
+            break;
+        case UPWR_PWM_STATUS:
+            ret = s->switches;
+            break;
+        default:
+            err = UPWR_RESP_BAD_REQ;
+            break;
+        }
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "%s: service group %d\n", __func__,
+                extract32(hdr, 1, 4));
+        err = UPWR_RESP_BAD_REQ;
+        break;
+    }
+    imx_upower_respond(s, hdr, err, ret);
+}
+
+static void imx_upower_send(imx_upower_state *s)
+{
+    if (s->busy) {
+        imx_upower_respond(s, s->tr[0], UPWR_RESP_BUSY, 0);
+        return;
+    }
+    memcpy(s->req, s->tr, sizeof(s->req));
+    s->busy = true;
+    timer_mod(s->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + s->delay_ns);
+}
+
+static uint64_t imx_upower_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_upower_state *s = (imx_upower_state *)opaque;
+    uint32_t ret = 0;
+    int i;
+
+    switch (offset) {
+    case UPWR_MU_VER:
+        return 0x00040001;
+    case UPWR_MU_PAR:
+        return (IMX_UPOWER_NUM_RR << 8) | IMX_UPOWER_NUM_TR;
+    case UPWR_MU_CR:
+        return s->cr;
+    case UPWR_MU_SR:
+        return s->busy ? 1 : 0;
+    case UPWR_MU_TSR:
+        return (1 << IMX_UPOWER_NUM_TR) - 1;
+    case UPWR_MU_RCR:
+        return s->rcr;
+    case UPWR_MU_RSR:
+        return s->rsr;
+    }
+    if (offset >= UPWR_MU_TR && offset < UPWR_MU_TR + 4 * IMX_UPOWER_NUM_TR) {
+        return s->tr[(offset - UPWR_MU_TR) / 4];
+    }
+    if (offset >= UPWR_MU_RR && offset < UPWR_MU_RR + 4 * IMX_UPOWER_NUM_RR) {
+        i = (offset - UPWR_MU_RR) / 4;
+        ret = s->rr[i];
+        s->rsr &= ~(1 << i);
+        imx_upower_update_irq(s);
+    }
+    return ret;
+}
+
+static void imx_upower_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_upower_state *s = (imx_upower_state *)opaque;
+    int i;
+
+    switch (offset) {
+    case UPWR_MU_CR:
+        s->cr = value;
+        return;
+    case UPWR_MU_RCR:
+        s->rcr = value & ((1 << IMX_UPOWER_NUM_RR) - 1);
+        imx_upower_update_irq(s);
+        return;
+    }
+    if (offset >= UPWR_MU_TR && offset < UPWR_MU_TR + 4 * IMX_UPOWER_NUM_TR) {
+        i = (offset - UPWR_MU_TR) / 4;
+        s->tr[i] = value;
+        if (i == 0) {
+            imx_upower_send(s);
+        }
+    }
+}
+
+static const MemoryRegionOps imx_upower_ops = {
+    .read = imx_upower_read,
+    .write = imx_upower_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static const VMStateDescription imx_upower_vm = {
+    .name = TYPE_IMX_UPOWER,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_TIMER_PTR(timer, imx_upower_state),
+        VMSTATE_UINT32(cr, imx_upower_state),
+        VMSTATE_UINT32(rcr, imx_upower_state),
+        VMSTATE_UINT32(rsr, imx_upower_state),
+        VMSTATE_UINT32_ARRAY(tr, imx_upower_state, IMX_UPOWER_NUM_TR),
+        VMSTATE_UINT32_ARRAY(rr, imx_upower_state, IMX_UPOWER_NUM_RR),
+        VMSTATE_BOOL(busy, imx_upower_state),
+        VMSTATE_UINT32_ARRAY(req, imx_upower_state, IMX_UPOWER_NUM_TR),
+        VMSTATE_UINT32(switches, imx_upower_state),
+        VMSTATE_UINT32(retention, imx_upower_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_upower_init(Object *obj)
+{
+    imx_upower_state *s = IMX_UPOWER(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_upower_ops, s,
+            TYPE_IMX_UPOWER, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, imx_upower_complete, s);
+}
+
+static void imx_upower_reset(DeviceState *dev)
+{
+    imx_upower_state *s = IMX_UPOWER(dev);
+
+    timer_del(s->timer);
+    s->cr = 0;
+    s->rcr = 0;
+    s->rsr = 0;
+    memset(s->tr, 0, sizeof(s->tr));
+    memset(s->rr, 0, sizeof(s->rr));
+    memset(s->req, 0, sizeof(s->req));
+    s->busy = false;
+    /* Everything the ROM runs from is powered at reset */
+    s->switches = 0xFFFFFFFF;
+    s->retention = 0;
+    imx_upower_update_irq(s);
+}
+
+static Property imx_upower_properties[] = {
+    DEFINE_PROP_UINT32("delay-ns", imx_upower_state, delay_ns,
+            UPWR_DEFAULT_DELAY_NS),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_upower_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = imx_upower_reset;
+    dc->vmsd = &imx_upower_vm;
+    dc->props = imx_upower_properties;
+}
+
+static const TypeInfo imx_upower_info = {
+    .name          = TYPE_IMX_UPOWER,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_upower_state),
+    .instance_init = imx_upower_init,
+    .class_init    = imx_upower_class_init,
+};
+
+static void imx_upower_types(void)
+{
+    type_register_static(&imx_upower_info);
+}
+
+type_init(imx_upower_types)
+
+/*=======================================
+    Co-simulation Bridge Module Start
+ ========================================*/
+/*
+ * Forwards an MMIO window to an RTL simulator (e.g. a Verilator model)
+ * through the imx_cosim_shm rings in a shared file.  Writes are posted
+ * and published in batches; a read publishes everything queued before
+ * it and waits for its response.  Every quantum_ns of virtual time the
+ * emulator grants the simulator time up to the next quantum with a SYNC
+ * and only waits for the previous grant, so both sides keep running
+ * and neither gets more than a quantum ahead.  IRQ levels the simulator
+ * posts are picked up on every response and every quantum.
+ *
+ * A guest sleeping in WFI makes no accesses, and with quantum-ns=0 there
+ * are no quanta either, so every poll_us of host time the main loop also
+ * publishes posted writes and samples the IRQ levels.
+ */
+#define IMX_COSIM_SPINS         1000
+#define IMX_COSIM_TIMEOUT_MS    10000
+#define IMX_COSIM_DEFAULT_QUANTUM_NS    10000
+#define IMX_COSIM_DEFAULT_BATCH 32
+#define IMX_COSIM_DEFAULT_POLL_US       100
+
+static void imx_cosim_publish(imx_cosim_state *s)
+{
+    atomic_store_release(&s->shm->req_head, s->req_head);
+    s->posted = 0;
+}
+
+/* Spin briefly, then sleep so a stalled simulator costs no host CPU */
+static bool imx_cosim_backoff(imx_cosim_state *s, unsigned *spins,
+        int64_t start)
+{
+    if (++*spins < IMX_COSIM_SPINS) {
+        return true;
+    }
+    if (qemu_clock_get_ms(QEMU_CLOCK_REALTIME) - start >
+        IMX_COSIM_TIMEOUT_MS) {
+        error_report("%s: simulator on %s stopped answering, detaching",
+                     TYPE_IMX_COSIM, s->path);
+        s->dead = true;
+        return false;
+    }
+    g_usleep(10);
+    return true;
+}
+
+static bool imx_cosim_push(imx_cosim_state *s, uint32_t type,
+        uint32_t addr, uint32_t data, unsigned size, uint64_t time_ns)
+{
+    imx_cosim_shm *shm = s->shm;
+    imx_cosim_req *r;
+    int64_t start = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    unsigned spins = 0;
+
+    while (s->req_head - atomic_load_acquire(&shm->req_tail) >=
+           IMX_COSIM_RING) {
+        imx_cosim_publish(s);
+        if (!imx_cosim_backoff(s, &spins, start)) {
+            return false;
+        }
+    }
+    r = &shm->req[s->req_head % IMX_COSIM_RING];
+    r->type = type;
+    r->size = size;
+    r->addr = addr;
+    r->data = data;
+    r->time_ns = time_ns;
+    s->req_head++;
+    return true;
+}
+
+static void imx_cosim_update_irq(imx_cosim_state *s)
+{
+    uint32_t level = atomic_read(&s->shm->irq);
+    uint32_t changed = level ^ s->irq_level;
+    int i;
+
+    s->irq_level = level;
+    for (i = 0; i < IMX_COSIM_NUM_IRQ; i++) {
+        if (changed & (1 << i)) {
+            qemu_set_irq(s->irq[i], (level >> i) & 1);
+        }
+    }
+}
+
+/*
+ * Consume responses until the one for a READ arrives or, with data NULL,
+ * until at most max_syncs SYNCs are outstanding.
+ */
+static bool imx_cosim_drain(imx_cosim_state *s, uint32_t *data,
+        uint32_t max_syncs)
+{
+    imx_cosim_shm *shm = s->shm;
+    int64_t start = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    unsigned spins = 0;
+
+    while (data || s->syncs > max_syncs) {
+        uint64_t tail = shm->rsp_tail;
+        imx_cosim_rsp *r;
+
+        if (atomic_load_acquire(&shm->rsp_head) == tail) {
+            if (!imx_cosim_backoff(s, &spins, start)) {
+                return false;
+            }
+            continue;
+        }
+        r = &shm->rsp[tail % IMX_COSIM_RING];
+        s->cycles = r->cycles;
+        if (r->type == IMX_COSIM_REQ_SYNC) {
+            s->syncs--;
+        } else if (data) {
+            *data = r->data;
+            data = NULL;
+        }
+        atomic_store_release(&shm->rsp_tail, tail + 1);
+    }
+    imx_cosim_update_irq(s);
+    return true;
+}
+
+static void imx_cosim_tick(void *opaque)
+{
+    imx_cosim_state *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    if (s->dead) {
+        return;
+    }
+    if (!imx_cosim_push(s, IMX_COSIM_REQ_SYNC, 0, 0, 0,
+                        now + s->quantum_ns)) {
+        return;
+    }
+    imx_cosim_publish(s);
+    s->syncs++;
+    if (!imx_cosim_drain(s, NULL, 1)) {
+        return;
+    }
+    timer_mod(s->timer, now + s->quantum_ns);
+}
+
+static void imx_cosim_poll(void *opaque)
+{
+    imx_cosim_state *s = opaque;
+
+    if (s->dead) {
+        return;
+    }
+    if (s->posted) {
+        imx_cosim_publish(s);
+    }
+    imx_cosim_update_irq(s);
+    timer_mod(s->poll_timer,
+              qemu_clock_get_us(QEMU_CLOCK_VIRTUAL_RT) + s->poll_us);
+}
+
+static uint64_t imx_cosim_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_cosim_state *s = (imx_cosim_state *)opaque;
+    uint32_t data = 0;
+
+    if (s->dead ||
+        !imx_cosim_push(s, IMX_COSIM_REQ_READ, offset, 0, size,
+                        qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL))) {
+        return 0;
+    }
+    imx_cosim_publish(s);
+    imx_cosim_drain(s, &data, 1);
+    return data;
+}
+
+static void imx_cosim_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_cosim_state *s = (imx_cosim_state *)opaque;
+
+    if (s->dead ||
+        !imx_cosim_push(s, IMX_COSIM_REQ_WRITE, offset, value, size,
+                        qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL))) {
+        return;
+    }
+    if (++s->posted >= s->batch) {
+        imx_cosim_publish(s);
+    }
+}
+
+static const MemoryRegionOps imx_cosim_ops = {
+    .read = imx_cosim_read,
+    .write = imx_cosim_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 4,
+};
+
+/* The simulator process holds the other half of the state */
+static const VMStateDescription imx_cosim_vm = {
+    .name = TYPE_IMX_COSIM,
+    .unmigratable = 1,
+};
+
+static void imx_cosim_realize(DeviceState *dev, Error **errp)
+{
+    imx_cosim_state *s = IMX_COSIM(dev);
+    SysBusDevice *sbd = SYS_BUS_DEVICE(dev);
+    void *ptr;
+    int fd, i;
+
+    if (!s->path) {
+        error_setg(errp, "%s: path is not set", TYPE_IMX_COSIM);
+        return;
+    }
+    fd = qemu_open(s->path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(imx_cosim_shm)) < 0) {
+        error_setg_errno(errp, errno, "%s: cannot create %s",
+                         TYPE_IMX_COSIM, s->path);
+        if (fd >= 0) {
+            qemu_close(fd);
+        }
+        return;
+    }
+    ptr = mmap(NULL, sizeof(imx_cosim_shm), PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+    qemu_close(fd);
+    if (ptr == MAP_FAILED) {
+        error_setg_errno(errp, errno, "%s: cannot map %s",
+                         TYPE_IMX_COSIM, s->path);
+        return;
+    }
+
+    /* Start from empty rings; the simulator attaches once magic is set */
+    s->shm = ptr;
+    memset(s->shm, 0, sizeof(*s->shm));
+    s->shm->version = IMX_COSIM_VERSION;
+    s->shm->ring_size = IMX_COSIM_RING;
+    atomic_store_release(&s->shm->magic, IMX_COSIM_MAGIC);
+
+    memory_region_init_io(&s->iomem, OBJECT(s), &imx_cosim_ops, s,
+            TYPE_IMX_COSIM, s->size);
+    sysbus_init_mmio(sbd, &s->iomem);
+    for (i = 0; i < IMX_COSIM_NUM_IRQ; i++) {
+        sysbus_init_irq(sbd, &s->irq[i]);
+    }
+    if (s->batch == 0) {
+        s->batch = 1;
+    }
+    if (s->quantum_ns) {
+        s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, imx_cosim_tick, s);
+    }
+    if (s->poll_us) {
+        s->poll_timer = timer_new_us(QEMU_CLOCK_VIRTUAL_RT, imx_cosim_poll, s);
+    }
+}
+
+static void imx_cosim_unrealize(DeviceState *dev, Error **errp)
+{
+    imx_cosim_state *s = IMX_COSIM(dev);
+
+    if (s->timer) {
+        timer_free(s->timer);
+    }
+    if (s->poll_timer) {
+        timer_free(s->poll_timer);
+    }
+    munmap(s->shm, sizeof(*s->shm));
+}
+
+static void imx_cosim_reset(DeviceState *dev)
+{
+    imx_cosim_state *s = IMX_COSIM(dev);
+    int i;
+
+    /* Collect every grant still in flight so none is counted twice */
+    if (!s->dead) {
+        imx_cosim_publish(s);
+        imx_cosim_drain(s, NULL, 0);
+    }
+    s->syncs = 0;
+    s->irq_level = 0;
+    for (i = 0; i < IMX_COSIM_NUM_IRQ; i++) {
+        qemu_set_irq(s->irq[i], 0);
+    }
+    if (s->timer) {
+        timer_mod(s->timer,
+                  qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + s->quantum_ns);
+    }
+    if (s->poll_timer) {
+        timer_mod(s->poll_timer,
+                  qemu_clock_get_us(QEMU_CLOCK_VIRTUAL_RT) + s->poll_us);
+    }
+}
+
+static Property imx_cosim_properties[] = {
+    DEFINE_PROP_STRING("path", imx_cosim_state, path),
+    DEFINE_PROP_UINT64("size", imx_cosim_state, size, 0x1000),
+    DEFINE_PROP_UINT32("quantum-ns", imx_cosim_state, quantum_ns,
+            IMX_COSIM_DEFAULT_QUANTUM_NS),
+    DEFINE_PROP_UINT32("batch", imx_cosim_state, batch,
+            IMX_COSIM_DEFAULT_BATCH),
+    DEFINE_PROP_UINT32("poll-us", imx_cosim_state, poll_us,
+            IMX_COSIM_DEFAULT_POLL_US),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_cosim_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_cosim_realize;
+    dc->unrealize = imx_cosim_unrealize;
+    dc->reset = imx_cosim_reset;
+    dc->vmsd = &imx_cosim_vm;
+    dc->props = imx_cosim_properties;
+}
+
+static const TypeInfo imx_cosim_info = {
+    .name          = TYPE_IMX_COSIM,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_cosim_state),
+    .class_init    = imx_cosim_class_init,
+};
+
+static void imx_cosim_types(void)
+{
+    type_register_static(&imx_cosim_info);
+}
+
+type_init(imx_cosim_types)
+
+/*=======================================
+    MU Module Start
+ ========================================*/
+/*
+ * Messaging unit between the M33 (side A) and the A35 (side B).  A TR
+ * word written on one side shows up in the peer's RR, GCR raises the
+ * peer's GSR bits and FCR drives the peer's FSR.
+ */
+#define MU_VER          0x000
+#define MU_PAR          0x004
+#define MU_CR           0x008
+#define MU_SR           0x00C
+#define MU_FCR          0x100
+#define MU_FSR          0x104
+#define MU_GIER         0x110
+#define MU_GCR          0x114
+#define MU_GSR          0x118
+#define MU_TCR          0x120
+#define MU_TSR          0x124
+#define MU_RCR          0x128
+#define MU_RSR          0x12C
+#define MU_TR           0x200
+#define MU_RR           0x280
+
+#define MU_REG_MASK     ((1 << IMX_MU_NUM_REG) - 1)
+
+static void imx_mu_update_irq(imx_mu_state *s, int side)
+{
+    imx_mu_side *m = &s->side[side];
+
+    qemu_set_irq(s->irq[side], !!((m->tsr & m->tcr) | (m->rsr & m->rcr) |
+                                  (m->gsr & m->gier)));
+}
+
+static uint64_t imx_mu_read(imx_mu_state *s, int side, hwaddr offset)
+{
+    imx_mu_side *m = &s->side[side];
+    imx_mu_side *peer = &s->side[!side];
+    uint32_t ret = 0;
+    int i;
+
+    switch (offset) {
+    case MU_VER:
+        return 0x00020000;
+    case MU_PAR:
+        return (IMX_MU_NUM_REG << 8) | IMX_MU_NUM_REG;
+    case MU_CR:
+        return m->cr;
+    case MU_FCR:
+        return m->fcr;
+    case MU_FSR:
+        return peer->fcr;
+    case MU_GIER:
+        return m->gier;
+    case MU_GSR:
+        return m->gsr;
+    case MU_TCR:
+        return m->tcr;
+    case MU_TSR:
+        return m->tsr;
+    case MU_RCR:
+        return m->rcr;
+    case MU_RSR:
+        return m->rsr;
+    }
+    if (offset >= MU_RR && offset < MU_RR + 4 * IMX_MU_NUM_REG) {
+        i = (offset - MU_RR) / 4;
+        ret = m->rr[i];
+        m->rsr &= ~(1 << i);
+        peer->tsr |= 1 << i;
+        imx_mu_update_irq(s, side);
+        imx_mu_update_irq(s, !side);
+    }
+    return ret;
+}
+
+static void imx_mu_write(imx_mu_state *s, int side, hwaddr offset,
+        uint64_t value)
+{
+    imx_mu_side *m = &s->side[side];
+    imx_mu_side *peer = &s->side[!side];
+    int i;
+
+    switch (offset) {
+    case MU_CR:
+        m->cr = value;
+        return;
+    case MU_FCR:
+        m->fcr = value & 0x7;
+        return;
+    case MU_GIER:
+        m->gier = value & MU_REG_MASK;
+        break;
+    case MU_GCR:
+        peer->gsr |= value & MU_REG_MASK;
+        imx_mu_update_irq(s, !side);
+        return;
+    case MU_GSR:
+        m->gsr &= ~value;
+        break;
+    case MU_TCR:
+        m->tcr = value & MU_REG_MASK;
+        break;
+    case MU_RCR:
+        m->rcr = value & MU_REG_MASK;
+        break;
+    default:
+        if (offset >= MU_TR && offset < MU_TR + 4 * IMX_MU_NUM_REG) {
+            i = (offset - MU_TR) / 4;
+            peer->rr[i] = value;
+            peer->rsr |= 1 << i;
+            m->tsr &= ~(1 << i);
+            imx_mu_update_irq(s, !side);
+            break;
+        }
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n", __func__,
+                (uint32_t)offset);
+        return;
+    }
+    imx_mu_update_irq(s, side);
+}
+
+static uint64_t imx_mu_a_read(void *opaque, hwaddr offset, unsigned size)
+{
+    return imx_mu_read(opaque, 0, offset);
+}
+
+static void imx_mu_a_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_mu_write(opaque, 0, offset, value);
+}
+
+static uint64_t imx_mu_b_read(void *opaque, hwaddr offset, unsigned size)
+{
+    return imx_mu_read(opaque, 1, offset);
+}
+
+static void imx_mu_b_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_mu_write(opaque, 1, offset, value);
+}
+
+static const MemoryRegionOps imx_mu_ops[2] = { {
+    .read = imx_mu_a_read,
+    .write = imx_mu_a_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+}, {
+    .read = imx_mu_b_read,
+    .write = imx_mu_b_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+} };
+
+static const VMStateDescription imx_mu_side_vm = {
+    .name = TYPE_IMX_MU "-side",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(cr, imx_mu_side),
+        VMSTATE_UINT32(fcr, imx_mu_side),
+        VMSTATE_UINT32(gier, imx_mu_side),
+        VMSTATE_UINT32(gsr, imx_mu_side),
+        VMSTATE_UINT32(tcr, imx_mu_side),
+        VMSTATE_UINT32(tsr, imx_mu_side),
+        VMSTATE_UINT32(rcr, imx_mu_side),
+        VMSTATE_UINT32(rsr, imx_mu_side),
+        VMSTATE_UINT32_ARRAY(rr, imx_mu_side, IMX_MU_NUM_REG),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription imx_mu_vm = {
+    .name = TYPE_IMX_MU,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_STRUCT_ARRAY(side, imx_mu_state, 2, 1, imx_mu_side_vm,
+                             imx_mu_side),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_mu_init(Object *obj)
+{
+    imx_mu_state *s = IMX_MU(obj);
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        memory_region_init_io(&s->iomem[i], obj, &imx_mu_ops[i], s,
+                i ? TYPE_IMX_MU ".b" : TYPE_IMX_MU ".a", 0x1000);
+        sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem[i]);
+        sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq[i]);
+    }
+}
+
+static void imx_mu_reset(DeviceState *dev)
+{
+    imx_mu_state *s = IMX_MU(dev);
+    int i;
+
+    memset(s->side, 0, sizeof(s->side));
+    for (i = 0; i < 2; i++) {
+        s->side[i].tsr = MU_REG_MASK;
+        imx_mu_update_irq(s, i);
+    }
+}
+
+static void imx_mu_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = imx_mu_reset;
+    dc->vmsd = &imx_mu_vm;
+}
+
+static const TypeInfo imx_mu_info = {
+    .name          = TYPE_IMX_MU,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_mu_state),
+    .instance_init = imx_mu_init,
+    .class_init    = imx_mu_class_init,
+};
+
+static void imx_mu_types(void)
+{
+    type_register_static(&imx_mu_info);
+}
+
+type_init(imx_mu_types)
+
+/*=======================================
+    LPIT Module Start
+ ========================================*/
+/*
+ * Low-power periodic interrupt timer, 32-bit periodic mode.  A running
+ * channel does not tick: its counter is worked out from virtual time
+ * and one QEMUTimer is armed for the next expiry of any channel.  If
+ * the callback runs late, every period that passed is accounted for in
+ * one go, so the channel raises TIF once, its counter is where it would
+ * be, and chained channels count every missed expiry.  Each expiry also
+ * pulses the channel's trigger output, which other channels can start
+ * (TSOT) or reload (TROT) on.
+ */
+#define LPIT_VERID          0x00
+#define LPIT_PARAM          0x04
+#define LPIT_MCR            0x08
+#define LPIT_MSR            0x0C
+#define LPIT_MIER           0x10
+#define LPIT_SETTEN         0x14
+#define LPIT_CLRTEN         0x18
+#define LPIT_CHAN_BASE      0x20
+#define LPIT_TVAL           0x0
+#define LPIT_CVAL           0x4
+#define LPIT_TCTRL          0x8
+
+#define LPIT_MCR_M_CEN      (1 << 0)
+#define LPIT_MCR_SW_RST     (1 << 1)
+
+#define LPIT_TCTRL_T_EN     (1 << 0)
+#define LPIT_TCTRL_CHAIN    (1 << 1)
+#define LPIT_TCTRL_MODE     (3 << 2)
+#define LPIT_TCTRL_TSOT     (1 << 16)
+#define LPIT_TCTRL_TSOI     (1 << 17)
+#define LPIT_TCTRL_TROT     (1 << 18)
+#define LPIT_TCTRL_TRG_SRC  (1 << 23)
+#define LPIT_TCTRL_TRG_SEL_SHIFT    24
+#define LPIT_TCTRL_MASK     0x0F87000F
+
+static bool imx_lpit_active(imx_lpit_state *s)
+{
+    return (s->mcr & LPIT_MCR_M_CEN) && s->freq;
+}
+
+static bool imx_lpit_chained(imx_lpit_state *s, int i)
+{
+    return i > 0 && (s->chan[i].tctrl & LPIT_TCTRL_CHAIN);
+}
+
+/* Whether channel i is counting off virtual time */
+static bool imx_lpit_timed(imx_lpit_state *s, int i)
+{
+    return imx_lpit_active(s) && s->chan[i].running &&
+           !imx_lpit_chained(s, i);
+}
+
+static uint64_t imx_lpit_ticks(imx_lpit_state *s, imx_lpit_chan *c,
+        int64_t now)
+{
+    return muldiv64(now - c->start_ns, s->freq, NANOSECONDS_PER_SECOND);
+}
+
+/* Expirations since start_ns; the first comes one tick after 0 */
+static uint64_t imx_lpit_expirations(imx_lpit_chan *c, uint64_t ticks)
+{
+    if (ticks <= c->start_cnt) {
+        return 0;
+    }
+    return 1 + (ticks - c->start_cnt - 1) / ((uint64_t)c->tval + 1);
+}
+
+static uint32_t imx_lpit_cval(imx_lpit_state *s, int i, int64_t now)
+{
+    imx_lpit_chan *c = &s->chan[i];
+    uint64_t ticks;
+
+    if (!imx_lpit_timed(s, i)) {
+        return c->cnt;
+    }
+    ticks = imx_lpit_ticks(s, c, now);
+    if (ticks <= c->start_cnt) {
+        return c->start_cnt - ticks;
+    }
+    return c->tval - (ticks - c->start_cnt - 1) % ((uint64_t)c->tval + 1);
+}
+
+static void imx_lpit_start(imx_lpit_chan *c, int64_t now, uint32_t cnt)
+{
+    c->running = true;
+    c->cnt = cnt;
+    c->start_ns = now;
+    c->start_cnt = cnt;
+    c->done = 0;
+}
+
+/* Latch the time-derived counters, before the clock or timing changes */
+static void imx_lpit_freeze(imx_lpit_state *s, int64_t now)
+{
+    int i;
+
+    for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+        if (imx_lpit_timed(s, i)) {
+            s->chan[i].cnt = imx_lpit_cval(s, i, now);
+        }
+    }
+}
+
+/* and carry on counting from the latched values */
+static void imx_lpit_thaw(imx_lpit_state *s, int64_t now)
+{
+    int i;
+
+    for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+        if (s->chan[i].running) {
+            imx_lpit_start(&s->chan[i], now, s->chan[i].cnt);
+        }
+    }
+}
+
+static void imx_lpit_update_irq(imx_lpit_state *s)
+{
+    qemu_set_irq(s->irq, !!(s->msr & s->mier));
+}
+
+static void imx_lpit_trigger(imx_lpit_state *s, int src, int64_t now)
+{
+    int i;
+
+    for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+        imx_lpit_chan *c = &s->chan[i];
+
+        if (i == src || !(c->tctrl & LPIT_TCTRL_T_EN) ||
+            !(c->tctrl & LPIT_TCTRL_TRG_SRC) ||
+            (c->tctrl >> LPIT_TCTRL_TRG_SEL_SHIFT) != src) {
+            continue;
+        }
+        if ((!c->running && (c->tctrl & LPIT_TCTRL_TSOT)) ||
+            (c->running && (c->tctrl & LPIT_TCTRL_TROT))) {
+            imx_lpit_start(c, now, c->tval);
+        }
+    }
+}
+
+/* Account for every expiry up to now */
+static void imx_lpit_update(imx_lpit_state *s, int64_t now)
+{
+    uint64_t events[IMX_LPIT_NUM_CHAN] = { 0 };
+    int i;
+
+    if (!imx_lpit_active(s)) {
+        return;
+    }
+    for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+        imx_lpit_chan *c = &s->chan[i];
+        uint64_t n, period = (uint64_t)c->tval + 1;
+
+        if (!c->running) {
+            continue;
+        }
+        if (imx_lpit_chained(s, i)) {
+            /* Counts the previous channel's expiries instead of ticks */
+            n = events[i - 1];
+            if (n <= c->cnt) {
+                c->cnt -= n;
+                continue;
+            }
+            n -= c->cnt + 1;
+            c->cnt = c->tval - n % period;
+            n = 1 + n / period;
+        } else {
+            uint64_t total = imx_lpit_expirations(c,
+                    imx_lpit_ticks(s, c, now));
+
+            n = total - c->done;
+            c->done = total;
+        }
+        if (!n) {
+            continue;
+        }
+
+        events[i] = n;
+        s->msr |= 1 << i;
+        qemu_irq_pulse(s->trigger[i]);
+        if (c->tctrl & LPIT_TCTRL_TSOI) {
+            c->running = false;
+            c->cnt = c->tval;
+        }
+        imx_lpit_trigger(s, i, now);
+    }
+    imx_lpit_update_irq(s);
+}
+
+static void imx_lpit_schedule(imx_lpit_state *s)
+{
+    int64_t next = INT64_MAX;
+    int i;
+
+    for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+        imx_lpit_chan *c = &s->chan[i];
+        uint64_t ticks;
+        int64_t t;
+
+        if (!imx_lpit_timed(s, i)) {
+            continue;
+        }
+        ticks = c->start_cnt + 1 + c->done * ((uint64_t)c->tval + 1);
+        t = c->start_ns + muldiv64(ticks, NANOSECONDS_PER_SECOND, s->freq) + 1;
+        next = MIN(next, t);
+    }
+    if (next == INT64_MAX) {
+        timer_del(s->timer);
+    } else {
+        timer_mod(s->timer, next);
+    }
+}
+
+static void imx_lpit_tick(void *opaque)
+{
+    imx_lpit_state *s = opaque;
+
+    imx_lpit_update(s, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    imx_lpit_schedule(s);
+}
+
+static void imx_lpit_clk_changed(Notifier *n, void *data)
+{
+    imx_lpit_state *s = container_of(n, imx_lpit_state, clk_notifier);
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    imx_lpit_update(s, now);
+    imx_lpit_freeze(s, now);
+    s->freq = *(uint32_t *)data;
+    imx_lpit_thaw(s, now);
+    imx_lpit_schedule(s);
+}
+
+static void imx_lpit_reset_chans(imx_lpit_state *s)
+{
+    memset(s->chan, 0, sizeof(s->chan));
+    s->msr = 0;
+    s->mier = 0;
+}
+
+static uint64_t imx_lpit_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_lpit_state *s = (imx_lpit_state *)opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int i;
+
+    imx_lpit_update(s, now);
+    switch (offset) {
+    case LPIT_VERID:
+        return 0x01000000;
+    case LPIT_PARAM:
+        return (IMX_LPIT_NUM_CHAN << 8) | IMX_LPIT_NUM_CHAN;
+    case LPIT_MCR:
+        return s->mcr;
+    case LPIT_MSR:
+        return s->msr;
+    case LPIT_MIER:
+        return s->mier;
+    }
+    if (offset >= LPIT_CHAN_BASE &&
+        offset < LPIT_CHAN_BASE + 0x10 * IMX_LPIT_NUM_CHAN) {
+        i = (offset - LPIT_CHAN_BASE) / 0x10;
+        switch (offset & 0xF) {
+        case LPIT_TVAL:
+            return s->chan[i].tval;
+        case LPIT_CVAL:
+            return imx_lpit_cval(s, i, now);
+        case LPIT_TCTRL:
+            return s->chan[i].tctrl;
+        }
+    }
+    return 0;
+}
+
+static void imx_lpit_write_tctrl(imx_lpit_state *s, int i, uint32_t value,
+        int64_t now)
+{
+    imx_lpit_chan *c = &s->chan[i];
+    uint32_t old = c->tctrl;
+
+    if (value & LPIT_TCTRL_MODE) {
+        qemu_log_mask(LOG_UNIMP, "%s: channel %d mode %d\n", __func__, i,
+                (value & LPIT_TCTRL_MODE) >> 2);
+    }
+    if ((value & LPIT_TCTRL_TRG_SRC) == 0 && (value & LPIT_TCTRL_TSOT)) {
+        qemu_log_mask(LOG_UNIMP, "%s: external triggers\n", __func__);
+    }
+    c->tctrl = value & LPIT_TCTRL_MASK;
+
+    if (!(old & LPIT_TCTRL_T_EN) && (value & LPIT_TCTRL_T_EN)) {
+        /* TSOT channels wait for their trigger */
+        c->cnt = c->tval;
+        if (!(value & LPIT_TCTRL_TSOT)) {
+            imx_lpit_start(c, now, c->tval);
+        }
+    } else if ((old & LPIT_TCTRL_T_EN) && !(value & LPIT_TCTRL_T_EN)) {
+        c->cnt = imx_lpit_cval(s, i, now);
+        c->running = false;
+    }
+}
+
+static void imx_lpit_write(void *opaque, hwaddr offset, uint64_t value,
+        unsigned size)
+{
+    imx_lpit_state *s = (imx_lpit_state *)opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int i;
+
+    imx_lpit_update(s, now);
+    switch (offset) {
+    case LPIT_MCR:
+        imx_lpit_freeze(s, now);
+        s->mcr = value & 0xF;
+        if (s->mcr & LPIT_MCR_SW_RST) {
+            imx_lpit_reset_chans(s);
+        }
+        imx_lpit_thaw(s, now);
+        break;
+    case LPIT_MSR:
+        s->msr &= ~value;
+        break;
+    case LPIT_MIER:
+        s->mier = value & ((1 << IMX_LPIT_NUM_CHAN) - 1);
+        break;
+    case LPIT_SETTEN:
+    case LPIT_CLRTEN:
+        for (i = 0; i < IMX_LPIT_NUM_CHAN; i++) {
+            if (value & (1 << i)) {
+                imx_lpit_write_tctrl(s, i, offset == LPIT_SETTEN ?
+                        s->chan[i].tctrl | LPIT_TCTRL_T_EN :
+                        s->chan[i].tctrl & ~LPIT_TCTRL_T_EN, now);
+            }
+        }
+        break;
+    default:
+        if (offset < LPIT_CHAN_BASE ||
+            offset >= LPIT_CHAN_BASE + 0x10 * IMX_LPIT_NUM_CHAN) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n",
+                    __func__, (uint32_t)offset);
+            break;
+        }
+        i = (offset - LPIT_CHAN_BASE) / 0x10;
+        switch (offset & 0xF) {
+        case LPIT_TVAL:
+            /* The running count finishes, the new value comes at reload */
+            if (imx_lpit_timed(s, i)) {
+                s->chan[i].cnt = imx_lpit_cval(s, i, now);
+                s->chan[i].tval = value;
+                imx_lpit_start(&s->chan[i], now, s->chan[i].cnt);
+            } else {
+                s->chan[i].tval = value;
+            }
+            break;
+        case LPIT_TCTRL:
+            imx_lpit_write_tctrl(s, i, value, now);
+            break;
+        }
+        break;
+    }
+    imx_lpit_update_irq(s);
+    imx_lpit_schedule(s);
+}
+
+static const MemoryRegionOps imx_lpit_ops = {
+    .read = imx_lpit_read,
+    .write = imx_lpit_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static const VMStateDescription imx_lpit_chan_vm = {
+    .name = TYPE_IMX_LPIT "-chan",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(tval, imx_lpit_chan),
+        VMSTATE_UINT32(tctrl, imx_lpit_chan),
+        VMSTATE_BOOL(running, imx_lpit_chan),
+        VMSTATE_UINT32(cnt, imx_lpit_chan),
+        VMSTATE_INT64(start_ns, imx_lpit_chan),
+        VMSTATE_UINT32(start_cnt, imx_lpit_chan),
+        VMSTATE_UINT64(done, imx_lpit_chan),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription imx_lpit_vm = {
+    .name = TYPE_IMX_LPIT,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_TIMER_PTR(timer, imx_lpit_state),
+        VMSTATE_UINT32(freq, imx_lpit_state),
+        VMSTATE_UINT32(mcr, imx_lpit_state),
+        VMSTATE_UINT32(msr, imx_lpit_state),
+        VMSTATE_UINT32(mier, imx_lpit_state),
+        VMSTATE_STRUCT_ARRAY(chan, imx_lpit_state, IMX_LPIT_NUM_CHAN, 1,
+                             imx_lpit_chan_vm, imx_lpit_chan),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_lpit_init(Object *obj)
+{
+    imx_lpit_state *s = IMX_LPIT(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_lpit_ops, s, TYPE_IMX_LPIT,
+            0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_out_named(DEVICE(obj), s->trigger, "trigger",
+            IMX_LPIT_NUM_CHAN);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, imx_lpit_tick, s);
+    s->clk_notifier.notify = imx_lpit_clk_changed;
+}
+
+static void imx_lpit_reset(DeviceState *dev)
+{
+    imx_lpit_state *s = IMX_LPIT(dev);
+
+    timer_del(s->timer);
+    s->mcr = 0;
+    imx_lpit_reset_chans(s);
+    imx_lpit_update_irq(s);
+}
+
+static void imx_lpit_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = imx_lpit_reset;
+    dc->vmsd = &imx_lpit_vm;
+}
+
+static const TypeInfo imx_lpit_info = {
+    .name          = TYPE_IMX_LPIT,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_lpit_state),
+    .instance_init = imx_lpit_init,
+    .class_init    = imx_lpit_class_init,
+};
 
-void imx_fsb_init_cb(imx_fsb_state *fsb)
+static void imx_lpit_types(void)
 {
-    uint32_t i = 0;
-    /* BANK3 8 words*/
-    for (i = 0; i < 8; i++) {
-        fsb->reg[0 + i] = g_imx8ulp_arg.fuse[24 + i];
+    type_register_static(&imx_lpit_info);
+}
+
+type_init(imx_lpit_types)
+
+/*=======================================
+    Crypto Engine Module Start
+ ========================================*/
+/*
+ * Job ring crypto engine.  The guest fills descriptors in a ring in RAM
+ * and advances HEAD; TAIL follows as jobs complete.  Both are free
+ * running counts, entry n lives at RING_BASE + (n % RING_SIZE) * 32:
+ *
+ *   struct { uint32_t cmd, src, dst, len, key, iv, result, reserved; }
+ *
+ * cmd:    OP [3:0] (0 AES-CBC, 1 AES-CTR, 2 SHA-256), DECRYPT bit 4,
+ *         KEYLEN [9:8] (0 AES-128, 1 AES-192, 2 AES-256)
+ * AES:    len bytes from src to dst (may be the same buffer), CBC needs
+ *         whole blocks.  The 16-byte IV/counter at iv is updated so the
+ *         next job can carry on the stream.  A CTR job may end in a
+ *         partial block; its unused keystream is dropped and the counter
+ *         still moves on by the whole block.
+ * SHA-256: the digest of len bytes at src is written to dst.
+ * result: CRYPTO_RESULT_DONE | error code, written at completion.
+ *
+ * All jobs queued at a kick are read and their buffers mapped in one go,
+ * then run as a batch in the thread pool through the host crypto library
+ * (which uses AES-NI/SHA extensions where it has them).  STATUS.DONE and
+ * the IRQ follow when the whole batch has finished.
+ *
+ * Jobs in a batch run in ring order.  One that shares its IV address with
+ * an earlier job takes that job's updated IV in the worker; one that
+ * reads or writes memory an earlier job writes ends the batch, and starts
+ * the next one once the earlier results are back in guest memory.
+ *
+ * The engine masters the bus through MSC1 with the attributes of the
+ * HEAD write that queued the jobs.  Like the eDMA, a buffer the MSC lets
+ * through whole is accessed (or mapped) on the system address space;
+ * anything else goes through the MSC, which blocks it.
+ */
+#define CRYPTO_VERID        0x00
+#define CRYPTO_CTRL         0x04
+#define CRYPTO_RING_BASE    0x08
+#define CRYPTO_RING_SIZE    0x0C
+#define CRYPTO_HEAD         0x10
+#define CRYPTO_TAIL         0x14
+#define CRYPTO_STATUS       0x18
+#define CRYPTO_IRQ_EN       0x1C
+#define CRYPTO_JOBS         0x20    /* jobs completed without error */
+#define CRYPTO_BYTES_LO     0x24    /* bytes processed, reading LO latches HI */
+#define CRYPTO_BYTES_HI     0x28
+#define CRYPTO_HOST_NS_LO   0x2C    /* host ns spent in batches, likewise */
+#define CRYPTO_HOST_NS_HI   0x30
+
+#define CRYPTO_CTRL_EN      (1 << 0)
+#define CRYPTO_CTRL_RST     (1 << 1)
+
+#define CRYPTO_STATUS_DONE  (1 << 0)
+#define CRYPTO_STATUS_ERR   (1 << 1)
+#define CRYPTO_STATUS_BUSY  (1 << 2)
+
+#define CRYPTO_CMD_OP       0xF
+#define CRYPTO_CMD_DECRYPT  (1 << 4)
+#define CRYPTO_CMD_KEYLEN   (3 << 8)
+#define CRYPTO_OP_AES_CBC   0
+#define CRYPTO_OP_AES_CTR   1
+#define CRYPTO_OP_SHA256    2
+
+#define CRYPTO_DESC_SIZE    32
+#define CRYPTO_DESC_RESULT  24
+#define CRYPTO_RESULT_DONE  (1u << 31)
+#define CRYPTO_ERR_OP       1
+#define CRYPTO_ERR_LEN      2
+#define CRYPTO_ERR_BUS      3
+#define CRYPTO_ERR_ENGINE   4
+
+#define CRYPTO_MAX_RING     256
+#define CRYPTO_MAX_LEN      (16 * MiB)
+
+typedef struct imx_crypto_job {
+    uint32_t addr;              /* descriptor */
+    uint32_t d[8];
+    uint8_t key[32];
+    uint8_t iv[16];
+    void *src;
+    void *dst;
+    hwaddr dst_len;
+    bool src_mapped;
+    bool dst_mapped;
+    uint32_t err;
+    struct imx_crypto_job *iv_from;     /* earlier job on the same IV */
+} imx_crypto_job;
+
+typedef struct {
+    imx_crypto_state *s;
+    MemTxAttrs attrs;
+    uint32_t gen;
+    uint32_t n;
+    int64_t ns;
+    imx_crypto_job job[];
+} imx_crypto_batch;
+
+static bool imx_crypto_is_aes(uint32_t cmd)
+{
+    return (cmd & CRYPTO_CMD_OP) == CRYPTO_OP_AES_CBC ||
+           (cmd & CRYPTO_CMD_OP) == CRYPTO_OP_AES_CTR;
+}
+
+static size_t imx_crypto_key_len(uint32_t cmd)
+{
+    return 16 + 8 * ((cmd & CRYPTO_CMD_KEYLEN) >> 8);
+}
+
+/* System address space if the MSC passes the whole span, else the MSC */
+static AddressSpace *imx_crypto_as(imx_crypto_state *s, hwaddr addr,
+        hwaddr len, MemTxAttrs *attrs)
+{
+    if (len && imx_msc_allows(s->msc, s->idau, addr, addr + len - 1, attrs)) {
+        return &address_space_memory;
     }
+    return &s->downstream_as;
+}
 
-    /* BANK4 8 words */
-    for (i = 0; i < 8; i++) {
-        fsb->reg[8 + i] = g_imx8ulp_arg.fuse[32 + i];
+static MemTxResult imx_crypto_read_mem(imx_crypto_state *s,
+        MemTxAttrs attrs, hwaddr addr, void *buf, hwaddr len)
+{
+    AddressSpace *as = imx_crypto_as(s, addr, len, &attrs);
+
+    return address_space_read(as, addr, attrs, buf, len);
+}
+
+static MemTxResult imx_crypto_write_mem(imx_crypto_state *s,
+        MemTxAttrs attrs, hwaddr addr, const void *buf, hwaddr len)
+{
+    AddressSpace *as = imx_crypto_as(s, addr, len, &attrs);
+
+    return address_space_write(as, addr, attrs, buf, len);
+}
+
+/*
+ * Map a buffer in place if it is all RAM the MSC lets through, otherwise
+ * bounce it.  A source bounce buffer is filled here, a destination one is
+ * written back at completion.
+ */
+static bool imx_crypto_map(imx_crypto_state *s, MemTxAttrs attrs,
+        hwaddr addr, hwaddr len, bool is_write, void **buf, bool *mapped)
+{
+    AddressSpace *as;
+    hwaddr plen = len;
+
+    *buf = NULL;
+    *mapped = true;
+    if (!len) {
+        return true;
+    }
+    as = imx_crypto_as(s, addr, len, &attrs);
+    if (as == &address_space_memory) {
+        *buf = address_space_map(as, addr, &plen, is_write, attrs);
+        if (*buf && plen == len) {
+            return true;
+        }
+        if (*buf) {
+            address_space_unmap(as, *buf, plen, is_write, 0);
+        }
+    }
+    *mapped = false;
+    *buf = g_malloc(len);
+    if (!is_write && address_space_read(as, addr, attrs, *buf, len) !=
+            MEMTX_OK) {
+        g_free(*buf);
+        *buf = NULL;
+        return false;
     }
+    return true;
+}
 
-    /* BANK5 8 words */
-    for (i = 0; i < 8; i++) {
-        fsb->reg[64 + i] = g_imx8ulp_arg.fuse[40 + i];
+static void imx_crypto_unmap(void *buf, bool mapped, hwaddr len,
+        bool is_write)
+{
+    if (!buf) {
+        return;
+    }
+    if (mapped) {
+        address_space_unmap(&address_space_memory, buf, len, is_write, len);
+    } else {
+        g_free(buf);
+    }
+}
+
+/* Main thread: fetch what the job needs and map its buffers */
+static void imx_crypto_prepare(imx_crypto_batch *b, imx_crypto_job *j)
+{
+    imx_crypto_state *s = b->s;
+    uint32_t cmd = j->d[0], len = j->d[3];
+    uint32_t op = cmd & CRYPTO_CMD_OP;
+
+    if (op != CRYPTO_OP_AES_CBC && op != CRYPTO_OP_AES_CTR &&
+        op != CRYPTO_OP_SHA256) {
+        j->err = CRYPTO_ERR_OP;
+        return;
+    }
+    if (imx_crypto_is_aes(cmd) && imx_crypto_key_len(cmd) > 32) {
+        j->err = CRYPTO_ERR_OP;
+        return;
+    }
+    if (len > CRYPTO_MAX_LEN || (op == CRYPTO_OP_AES_CBC && len % 16)) {
+        j->err = CRYPTO_ERR_LEN;
+        return;
+    }
+
+    if (imx_crypto_is_aes(cmd) &&
+        (imx_crypto_read_mem(s, b->attrs, j->d[4], j->key,
+                imx_crypto_key_len(cmd)) != MEMTX_OK ||
+         imx_crypto_read_mem(s, b->attrs, j->d[5], j->iv, 16) != MEMTX_OK)) {
+        j->err = CRYPTO_ERR_BUS;
+        return;
+    }
+
+    j->dst_len = op == CRYPTO_OP_SHA256 ? 32 : len;
+    if (!imx_crypto_map(s, b->attrs, j->d[1], len, false,
+                &j->src, &j->src_mapped) ||
+        !imx_crypto_map(s, b->attrs, j->d[2], j->dst_len, true,
+                &j->dst, &j->dst_mapped)) {
+        j->err = CRYPTO_ERR_BUS;
+    }
+}
+
+/* Reuse the key schedule while the guest keeps the same key */
+static QCryptoCipher *imx_crypto_cipher(imx_crypto_state *s,
+        imx_crypto_job *j)
+{
+    static const QCryptoCipherAlgorithm algs[] = {
+        QCRYPTO_CIPHER_ALG_AES_128,
+        QCRYPTO_CIPHER_ALG_AES_192,
+        QCRYPTO_CIPHER_ALG_AES_256,
+    };
+    uint32_t cmd = j->d[0] & (CRYPTO_CMD_OP | CRYPTO_CMD_KEYLEN);
+    size_t nkey = imx_crypto_key_len(cmd);
+
+    if (s->cipher && s->cipher_cmd == cmd &&
+        !memcmp(s->cipher_key, j->key, nkey)) {
+        return s->cipher;
+    }
+    qcrypto_cipher_free(s->cipher);
+    s->cipher = qcrypto_cipher_new(algs[(cmd & CRYPTO_CMD_KEYLEN) >> 8],
+            (cmd & CRYPTO_CMD_OP) == CRYPTO_OP_AES_CBC ?
+            QCRYPTO_CIPHER_MODE_CBC : QCRYPTO_CIPHER_MODE_CTR,
+            j->key, nkey, NULL);
+    s->cipher_cmd = cmd;
+    memcpy(s->cipher_key, j->key, nkey);
+    return s->cipher;
+}
+
+/* Add n to a 128-bit big-endian counter */
+static void imx_crypto_ctr_add(uint8_t *ctr, uint64_t n)
+{
+    int i;
+
+    for (i = 15; i >= 0 && n; i--) {
+        n += ctr[i];
+        ctr[i] = n;
+        n >>= 8;
+    }
+}
+
+/*
+ * The host ciphers only take whole blocks, so the last partial CTR block
+ * is XORed here with the keystream of its counter
+ */
+static int imx_crypto_ctr_tail(QCryptoCipher *cipher, imx_crypto_job *j,
+        uint32_t whole)
+{
+    uint8_t ctr[16], ks[16] = { 0 };
+    uint8_t *src = j->src, *dst = j->dst;
+    uint32_t i;
+
+    memcpy(ctr, j->iv, 16);
+    imx_crypto_ctr_add(ctr, whole / 16);
+    if (qcrypto_cipher_setiv(cipher, ctr, 16, NULL) < 0 ||
+        qcrypto_cipher_encrypt(cipher, ks, ks, 16, NULL) < 0) {
+        return -1;
+    }
+    for (i = whole; i < j->d[3]; i++) {
+        dst[i] = src[i] ^ ks[i - whole];
+    }
+    return 0;
+}
+
+/* Worker thread */
+static void imx_crypto_run(imx_crypto_state *s, imx_crypto_job *j)
+{
+    uint32_t cmd = j->d[0], len = j->d[3];
+    uint32_t whole = QEMU_ALIGN_DOWN(len, 16);
+    bool decrypt = cmd & CRYPTO_CMD_DECRYPT;
+    QCryptoCipher *cipher;
+    uint8_t *digest = NULL;
+    size_t digest_len = 0;
+    uint8_t next_iv[16];
+    int ret;
+
+    if ((cmd & CRYPTO_CMD_OP) == CRYPTO_OP_SHA256) {
+        if (qcrypto_hash_bytes(QCRYPTO_HASH_ALG_SHA256, j->src, len,
+                    &digest, &digest_len, NULL) < 0) {
+            j->err = CRYPTO_ERR_ENGINE;
+            return;
+        }
+        memcpy(j->dst, digest, MIN(digest_len, j->dst_len));
+        g_free(digest);
+        return;
+    }
+    if (!len) {
+        return;
+    }
+
+    cipher = imx_crypto_cipher(s, j);
+    if (!cipher || qcrypto_cipher_setiv(cipher, j->iv, 16, NULL) < 0) {
+        j->err = CRYPTO_ERR_ENGINE;
+        return;
+    }
+    /* CBC decryption chains on the last ciphertext block, maybe in place */
+    if (decrypt && (cmd & CRYPTO_CMD_OP) == CRYPTO_OP_AES_CBC) {
+        memcpy(next_iv, (uint8_t *)j->src + len - 16, 16);
+    }
+    ret = 0;
+    if (whole) {
+        ret = decrypt ?
+            qcrypto_cipher_decrypt(cipher, j->src, j->dst, whole, NULL) :
+            qcrypto_cipher_encrypt(cipher, j->src, j->dst, whole, NULL);
+    }
+    if (ret < 0 || (whole < len && imx_crypto_ctr_tail(cipher, j, whole))) {
+        j->err = CRYPTO_ERR_ENGINE;
+        return;
+    }
+
+    if ((cmd & CRYPTO_CMD_OP) == CRYPTO_OP_AES_CTR) {
+        imx_crypto_ctr_add(j->iv, DIV_ROUND_UP(len, 16));
+    } else if (decrypt) {
+        memcpy(j->iv, next_iv, 16);
+    } else {
+        memcpy(j->iv, (uint8_t *)j->dst + len - 16, 16);
+    }
+}
+
+static int imx_crypto_worker(void *opaque)
+{
+    imx_crypto_batch *b = opaque;
+    int64_t start = get_clock();
+    uint32_t i;
+
+    for (i = 0; i < b->n; i++) {
+        imx_crypto_job *j = &b->job[i], *from = j->iv_from;
+
+        if (j->err) {
+            continue;
+        }
+        /* Skip jobs that failed, they leave the IV alone */
+        while (from && from->err) {
+            from = from->iv_from;
+        }
+        if (from) {
+            memcpy(j->iv, from->iv, 16);
+        }
+        imx_crypto_run(b->s, j);
+    }
+    b->ns = get_clock() - start;
+    return 0;
+}
+
+static void imx_crypto_update_irq(imx_crypto_state *s)
+{
+    qemu_set_irq(s->irq, !!(s->status & s->irq_en));
+}
+
+static void imx_crypto_kick(imx_crypto_state *s);
+
+/* Main thread: write results back, the batch may predate a reset */
+static void imx_crypto_complete(void *opaque, int ret)
+{
+    imx_crypto_batch *b = opaque;
+    imx_crypto_state *s = b->s;
+    bool current = b->gen == s->gen;
+    uint32_t i, result;
+
+    for (i = 0; i < b->n; i++) {
+        imx_crypto_job *j = &b->job[i];
+
+        imx_crypto_unmap(j->src, j->src_mapped, j->d[3], false);
+        if (current && !j->err && j->dst && !j->dst_mapped &&
+            imx_crypto_write_mem(s, b->attrs, j->d[2], j->dst,
+                    j->dst_len) != MEMTX_OK) {
+            j->err = CRYPTO_ERR_BUS;
+        }
+        imx_crypto_unmap(j->dst, j->dst_mapped, j->dst_len, true);
+        if (!current) {
+            continue;
+        }
+
+        if (!j->err && imx_crypto_is_aes(j->d[0]) &&
+            imx_crypto_write_mem(s, b->attrs, j->d[5], j->iv, 16) !=
+                MEMTX_OK) {
+            j->err = CRYPTO_ERR_BUS;
+        }
+        result = CRYPTO_RESULT_DONE | j->err;
+        imx_crypto_write_mem(s, b->attrs, j->addr + CRYPTO_DESC_RESULT,
+                &result, 4);
+        if (j->err) {
+            s->status |= CRYPTO_STATUS_ERR;
+        } else {
+            s->jobs++;
+            s->bytes += j->d[3];
+        }
+    }
+
+    if (current) {
+        s->tail += b->n;
+        s->host_ns += b->ns;
+        s->status |= CRYPTO_STATUS_DONE;
+        imx_crypto_update_irq(s);
+    }
+    s->busy = false;
+    g_free(b);
+    imx_crypto_kick(s);
+}
+
+static bool imx_crypto_overlap(uint32_t a, uint32_t alen,
+        uint32_t b, uint32_t blen)
+{
+    return alen && blen &&
+           a < (uint64_t)b + blen && b < (uint64_t)a + alen;
+}
+
+/*
+ * Does job j touch memory that the earlier job k writes?  Jobs sharing an
+ * IV address are fine, the worker hands the IV on.
+ */
+static bool imx_crypto_depends(imx_crypto_job *j, imx_crypto_job *k)
+{
+    uint32_t jkey = imx_crypto_is_aes(j->d[0]) ?
+        imx_crypto_key_len(j->d[0]) : 0;
+    uint32_t jiv = imx_crypto_is_aes(j->d[0]) ? 16 : 0;
+    uint32_t kiv = imx_crypto_is_aes(k->d[0]) ? 16 : 0;
+    uint32_t kdst = (k->d[0] & CRYPTO_CMD_OP) == CRYPTO_OP_SHA256 ?
+        32 : k->d[3];
+    uint32_t jdst = (j->d[0] & CRYPTO_CMD_OP) == CRYPTO_OP_SHA256 ?
+        32 : j->d[3];
+
+    if (k->err) {
+        return false;
+    }
+    if (imx_crypto_overlap(j->d[1], j->d[3], k->d[2], kdst) ||
+        imx_crypto_overlap(j->d[2], jdst, k->d[2], kdst) ||
+        imx_crypto_overlap(j->d[4], jkey, k->d[2], kdst) ||
+        imx_crypto_overlap(j->d[5], jiv, k->d[2], kdst)) {
+        return true;
+    }
+    if (j->d[5] == k->d[5] && jiv && kiv) {
+        return false;
+    }
+    return imx_crypto_overlap(j->d[1], j->d[3], k->d[5], kiv) ||
+           imx_crypto_overlap(j->d[2], jdst, k->d[5], kiv) ||
+           imx_crypto_overlap(j->d[4], jkey, k->d[5], kiv) ||
+           imx_crypto_overlap(j->d[5], jiv, k->d[5], kiv);
+}
+
+static void imx_crypto_kick(imx_crypto_state *s)
+{
+    uint32_t n = s->head - s->tail;
+    imx_crypto_batch *b;
+    uint32_t i, k;
+
+    if (s->busy || !(s->ctrl & CRYPTO_CTRL_EN) || !n) {
+        return;
+    }
+    if (!s->ring_size || n > s->ring_size) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: %u jobs queued in a ring of %u\n",
+                __func__, n, s->ring_size);
+        s->status |= CRYPTO_STATUS_ERR;
+        imx_crypto_update_irq(s);
+        return;
+    }
+
+    b = g_malloc0(sizeof(*b) + n * sizeof(imx_crypto_job));
+    b->s = s;
+    b->attrs = s->attrs;
+    b->gen = s->gen;
+    b->n = n;
+    for (i = 0; i < n; i++) {
+        imx_crypto_job *j = &b->job[i];
+
+        j->addr = s->ring_base +
+            ((s->tail + i) & (s->ring_size - 1)) * CRYPTO_DESC_SIZE;
+        if (imx_crypto_read_mem(s, b->attrs, j->addr, j->d,
+                    sizeof(j->d)) != MEMTX_OK) {
+            j->err = CRYPTO_ERR_BUS;
+            continue;
+        }
+        for (k = 0; k < i; k++) {
+            if (imx_crypto_depends(j, &b->job[k])) {
+                break;
+            }
+            if (!b->job[k].err && imx_crypto_is_aes(j->d[0]) &&
+                imx_crypto_is_aes(b->job[k].d[0]) &&
+                j->d[5] == b->job[k].d[5]) {
+                j->iv_from = &b->job[k];
+            }
+        }
+        if (k < i) {
+            /* Left for the next batch, after this one's write-back */
+            b->n = i;
+            break;
+        }
+        imx_crypto_prepare(b, j);
+    }
+
+    s->busy = true;
+    thread_pool_submit_aio(aio_get_thread_pool(qemu_get_aio_context()),
+                           imx_crypto_worker, b, imx_crypto_complete, b);
+}
+
+/* Run the thread pool completions until no batch is in flight */
+static void imx_crypto_drain(imx_crypto_state *s)
+{
+    while (s->busy) {
+        aio_poll(qemu_get_aio_context(), true);
+    }
+}
+
+/*
+ * Drop queued jobs.  A batch still running is waited for, so nothing it
+ * writes through its mapped buffers lands after the reset, and then
+ * discarded: its results, TAIL and counters are not updated.
+ */
+static void imx_crypto_reset_ring(imx_crypto_state *s)
+{
+    s->gen++;
+    s->head = 0;
+    s->tail = 0;
+    imx_crypto_drain(s);
+    s->status = 0;
+    imx_crypto_update_irq(s);
+}
+
+static uint64_t imx_crypto_read(void *opaque, hwaddr offset, unsigned size)
+{
+    imx_crypto_state *s = (imx_crypto_state *)opaque;
+
+    switch (offset) {
+    case CRYPTO_VERID:
+        return 0x01000000;
+    case CRYPTO_CTRL:
+        return s->ctrl;
+    case CRYPTO_RING_BASE:
+        return s->ring_base;
+    case CRYPTO_RING_SIZE:
+        return s->ring_size;
+    case CRYPTO_HEAD:
+        return s->head;
+    case CRYPTO_TAIL:
+        return s->tail;
+    case CRYPTO_STATUS:
+        return s->status | (s->busy ? CRYPTO_STATUS_BUSY : 0);
+    case CRYPTO_IRQ_EN:
+        return s->irq_en;
+    case CRYPTO_JOBS:
+        return s->jobs;
+    case CRYPTO_BYTES_LO:
+        s->hi = s->bytes >> 32;
+        return (uint32_t)s->bytes;
+    case CRYPTO_HOST_NS_LO:
+        s->hi = s->host_ns >> 32;
+        return (uint32_t)s->host_ns;
+    case CRYPTO_BYTES_HI:
+    case CRYPTO_HOST_NS_HI:
+        return s->hi;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n",
+                __func__, (uint32_t)offset);
+        return 0;
+    }
+}
+
+static MemTxResult imx_crypto_write(void *opaque, hwaddr offset,
+        uint64_t value, unsigned size, MemTxAttrs attrs)
+{
+    imx_crypto_state *s = (imx_crypto_state *)opaque;
+
+    switch (offset) {
+    case CRYPTO_CTRL:
+        s->ctrl = value & CRYPTO_CTRL_EN;
+        if (value & CRYPTO_CTRL_RST) {
+            imx_crypto_reset_ring(s);
+        }
+        break;
+    case CRYPTO_RING_BASE:
+        s->ring_base = value & ~(CRYPTO_DESC_SIZE - 1);
+        break;
+    case CRYPTO_RING_SIZE:
+        if (!is_power_of_2(value) || value > CRYPTO_MAX_RING) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: bad ring size %u\n",
+                    __func__, (uint32_t)value);
+            break;
+        }
+        s->ring_size = value;
+        break;
+    case CRYPTO_HEAD:
+        s->head = value;
+        s->attrs = attrs;
+        break;
+    case CRYPTO_STATUS:
+        s->status &= ~(value & (CRYPTO_STATUS_DONE | CRYPTO_STATUS_ERR));
+        break;
+    case CRYPTO_IRQ_EN:
+        s->irq_en = value & (CRYPTO_STATUS_DONE | CRYPTO_STATUS_ERR);
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad offset 0x%x\n",
+                __func__, (uint32_t)offset);
+        break;
+    }
+    imx_crypto_update_irq(s);
+    imx_crypto_kick(s);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps imx_crypto_ops = {
+    .read = imx_crypto_read,
+    .write_with_attrs = imx_crypto_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+/* Save with no batch in flight, its results then are in guest memory */
+static int imx_crypto_pre_save(void *opaque)
+{
+    imx_crypto_drain(opaque);
+    return 0;
+}
+
+static int imx_crypto_post_load(void *opaque, int version_id)
+{
+    imx_crypto_kick(opaque);
+    return 0;
+}
+
+static const VMStateDescription imx_crypto_vm = {
+    .name = TYPE_IMX_CRYPTO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .pre_save = imx_crypto_pre_save,
+    .post_load = imx_crypto_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(ctrl, imx_crypto_state),
+        VMSTATE_UINT32(ring_base, imx_crypto_state),
+        VMSTATE_UINT32(ring_size, imx_crypto_state),
+        VMSTATE_UINT32(head, imx_crypto_state),
+        VMSTATE_UINT32(tail, imx_crypto_state),
+        VMSTATE_UINT32(status, imx_crypto_state),
+        VMSTATE_UINT32(irq_en, imx_crypto_state),
+        VMSTATE_UINT32(jobs, imx_crypto_state),
+        VMSTATE_UINT64(bytes, imx_crypto_state),
+        VMSTATE_UINT64(host_ns, imx_crypto_state),
+        VMSTATE_UINT32(hi, imx_crypto_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void imx_crypto_init(Object *obj)
+{
+    imx_crypto_state *s = IMX_CRYPTO(obj);
+
+    memory_region_init_io(&s->iomem, obj, &imx_crypto_ops, s,
+            TYPE_IMX_CRYPTO, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+}
+
+static void imx_crypto_reset(DeviceState *dev)
+{
+    imx_crypto_state *s = IMX_CRYPTO(dev);
+
+    s->ctrl = 0;
+    s->ring_base = 0;
+    s->ring_size = 0;
+    s->irq_en = 0;
+    s->jobs = 0;
+    s->bytes = 0;
+    s->host_ns = 0;
+    s->attrs = MEMTXATTRS_UNSPECIFIED;
+    imx_crypto_reset_ring(s);
+}
+
+static void imx_crypto_realize(DeviceState *dev, Error **errp)
+{
+    imx_crypto_state *s = IMX_CRYPTO(dev);
+
+    if (!s->downstream || !s->msc || !s->idau) {
+        error_setg(errp, "%s: downstream, msc and idau must be set",
+                TYPE_IMX_CRYPTO);
+        return;
+    }
+    address_space_init(&s->downstream_as, s->downstream, "crypto-downstream");
+}
+
+static Property imx_crypto_properties[] = {
+    DEFINE_PROP_LINK("downstream", imx_crypto_state, downstream,
+            TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_LINK("msc", imx_crypto_state, msc, TYPE_TZ_MSC, TZMSC *),
+    DEFINE_PROP_LINK("idau", imx_crypto_state, idau, TYPE_IDAU_INTERFACE,
+            Object *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void imx_crypto_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = imx_crypto_realize;
+    dc->reset = imx_crypto_reset;
+    dc->vmsd = &imx_crypto_vm;
+    dc->props = imx_crypto_properties;
+}
+
+static const TypeInfo imx_crypto_info = {
+    .name          = TYPE_IMX_CRYPTO,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(imx_crypto_state),
+    .instance_init = imx_crypto_init,
+    .class_init    = imx_crypto_class_init,
+};
+
+static void imx_crypto_types(void)
+{
+    type_register_static(&imx_crypto_info);
+}
+
+type_init(imx_crypto_types)
+
+/*=======================================
+    Profiler Module Start
+ ========================================*/
+/*
+ * Sampling guest profiler.  A QEMU_CLOCK_VIRTUAL timer queues a sample on
+ * the CPU every interval_ns; with -icount the virtual clock counts
+ * instructions, so the interval becomes an instruction count.  The sample
+ * runs on the vCPU thread between TBs, so the cost is one exit from the
+ * execution loop per sample.
+ *
+ * Unwinding: the ROM and most firmware are built without frame pointers,
+ * so after PC and LR the stack is scanned for Thumb return addresses,
+ * i.e. odd words that point just after a BL/BLX into a known symbol.
+ * Symbols are those of the ELF loaded from -kernel.  At exit the stacks
+ * are written in the folded format taken by flamegraph.pl.
+ */
+
+/*
+ * Debug read that only touches RAM or ROM.  Stack words are arbitrary
+ * guest data, and a debug read of a device still runs its read callback
+ * (popping a FIFO, clearing latched status).
+ */
+static bool imx_prof_read(CPUState *cs, uint32_t addr, void *buf, int len)
+{
+    MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
+    MemoryRegion *mr;
+    hwaddr phys, xlat, l = len;
+    bool ok;
+
+    phys = cpu_get_phys_page_attrs_debug(cs, addr & TARGET_PAGE_MASK, &attrs);
+    if (phys == -1) {
+        return false;
+    }
+    phys += addr & ~TARGET_PAGE_MASK;
+
+    rcu_read_lock();
+    mr = address_space_translate(cpu_get_address_space(cs,
+                    cpu_asidx_from_attrs(cs, attrs)), phys, &xlat, &l,
+            false, attrs);
+    ok = l == len && !memory_region_is_ram_device(mr) &&
+         (memory_region_is_ram(mr) || memory_region_is_romd(mr));
+    rcu_read_unlock();
+
+    return ok && cpu_memory_rw_debug(cs, addr, buf, len, 0) == 0;
+}
+
+static bool imx_prof_is_call_site(CPUState *cs, uint32_t ret)
+{
+    uint16_t hw[2];
+
+    if (!(ret & 1) || ret >= 0xF0000000 ||
+        !imx_prof_read(cs, (ret & ~1) - 4, hw, 4)) {
+        return false;
+    }
+    /* BL / BLX imm: 32-bit, BLX Rm: 16-bit */
+    if ((hw[0] & 0xF800) == 0xF000 && (hw[1] & 0xC000) == 0xC000) {
+        return true;
+    }
+    return (hw[1] & 0xFF87) == 0x4780;
+}
+
+static const char *imx_prof_name(uint32_t addr, char *buf, size_t len)
+{
+    const char *name = lookup_symbol(addr);
+
+    if (name && *name) {
+        return name;
+    }
+    snprintf(buf, len, "0x%08x", addr);
+    return buf;
+}
+
+static void imx_prof_sample(CPUState *cs, run_on_cpu_data data)
+{
+    imx_prof_state *p = data.host_ptr;
+    CPUARMState *env = &ARM_CPU(cs)->env;
+    uint32_t frames[IMX_PROF_MAX_DEPTH];
+    uint32_t stack[IMX_PROF_SCAN_WORDS];
+    const char *last = NULL;
+    char buf[16];
+    GString *key;
+    gpointer count;
+    int n = 0, i;
+
+    if (cs->halted) {
+        key = g_string_new("[idle]");
+        goto record;
+    }
+
+    frames[n++] = env->regs[15];
+    if (imx_prof_is_call_site(cs, env->regs[14])) {
+        frames[n++] = env->regs[14] & ~1;
+    }
+    if (imx_prof_read(cs, env->regs[13], stack, sizeof(stack))) {
+        for (i = 0; i < IMX_PROF_SCAN_WORDS && n < IMX_PROF_MAX_DEPTH; i++) {
+            if (imx_prof_is_call_site(cs, stack[i]) &&
+                    *lookup_symbol(stack[i] & ~1)) {
+                frames[n++] = stack[i] & ~1;
+            }
+        }
+    }
+
+    /* Folded stacks go root first, drop repeats of the same function */
+    key = g_string_new(NULL);
+    for (i = n - 1; i >= 0; i--) {
+        const char *name = imx_prof_name(frames[i], buf, sizeof(buf));
+
+        if (last && !strcmp(last, name)) {
+            continue;
+        }
+        if (key->len) {
+            g_string_append_c(key, ';');
+        }
+        g_string_append(key, name);
+        last = lookup_symbol(frames[i]);
+    }
+
+record:
+    count = g_hash_table_lookup(p->stacks, key->str);
+    g_hash_table_replace(p->stacks, g_string_free(key, false),
+            GSIZE_TO_POINTER(GPOINTER_TO_SIZE(count) + 1));
+    p->samples++;
+}
+
+static void imx_prof_tick(void *opaque)
+{
+    imx_prof_state *p = opaque;
+
+    async_run_on_cpu(p->cpu, imx_prof_sample, RUN_ON_CPU_HOST_PTR(p));
+    timer_mod(p->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + p->interval_ns);
+}
+
+static void imx_prof_dump(Notifier *n, void *data)
+{
+    imx_prof_state *p = container_of(n, imx_prof_state, exit);
+    GHashTableIter iter;
+    gpointer key, value;
+    FILE *f = fopen(p->out, "w");
+
+    if (!f) {
+        error_report("profiler: cannot write %s", p->out);
+        return;
+    }
+    g_hash_table_iter_init(&iter, p->stacks);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        fprintf(f, "%s %zu\n", (char *)key, GPOINTER_TO_SIZE(value));
     }
+    fclose(f);
+    info_report("profiler: %" PRIu64 " samples written to %s",
+            p->samples, p->out);
+}
+
+void imx_prof_start(imx_prof_state *p, CPUState *cpu, const char *out,
+        uint64_t interval_ns)
+{
+    p->cpu = cpu;
+    p->out = g_strdup(out);
+    p->interval_ns = interval_ns ? interval_ns : IMX_PROF_DEFAULT_NS;
+    p->stacks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    p->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, imx_prof_tick, p);
+    timer_mod(p->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + p->interval_ns);
+
+    p->exit.notify = imx_prof_dump;
+    qemu_add_exit_notifier(&p->exit);
+}
+
+/*=======================================
+    ARG Module Start
+ ========================================*/
+imx8ulp_arg_t g_imx8ulp_arg;
+
+static void imx8ulp_arg_handle_fuse(char *fuse_str);
+static uint32_t imx8ulp_arg_hex2dec(char *hex);
+
+/* Fuse banks the FSB shadows, in 32-bit words */
+static const struct {
+    uint16_t fsb;
+    uint16_t fuse;
+    uint16_t count;
+} imx_fsb_map[] = {
+    {   0,  24,  8 },   /* BANK3 */
+    {   8,  32,  8 },   /* BANK4 */
+    {  64,  40,  8 },   /* BANK5 */
+    {  72,  48,  8 },   /* BANK6 */
+    {  96, 224, 32 },   /* BANK28-31, M33 ROM patch */
+    { 128, 296, 64 },   /* BANK37-44 */
+};
+
+void imx_fsb_reload_word(imx_fsb_state *fsb, uint32_t fuse_word,
+        uint32_t value)
+{
+    uint32_t i;
 
-    /* BANK6 8 words */
-    for (i = 0; i < 8; i++) {
-        fsb->reg[72 + i] = g_imx8ulp_arg.fuse[48 + i];
+    for (i = 0; i < ARRAY_SIZE(imx_fsb_map); i++) {
+        if (fuse_word >= imx_fsb_map[i].fuse &&
+            fuse_word < imx_fsb_map[i].fuse + imx_fsb_map[i].count) {
+            fsb->reg[imx_fsb_map[i].fsb + fuse_word - imx_fsb_map[i].fuse] =
+                value;
+        }
     }
+}
 
-    /* BANK28-31 32 words */
-    for (i = 0; i < 32; i++) {
-        //printf("%s: m33 rom patch:%x\n", __func__, g_imx8ulp_arg.fuse[224 + i]);
-        fsb->reg[96 + i] = g_imx8ulp_arg.fuse[224 + i];
-    }
+void imx_fsb_init_cb(imx_fsb_state *fsb)
+{
+    uint32_t i, j;
 
-    /* BANK37-44 64 words */
-    for (i = 0; i < 64; i++) {
-        fsb->reg[128 + i] = g_imx8ulp_arg.fuse[296 + i];
+    for (i = 0; i < ARRAY_SIZE(imx_fsb_map); i++) {
+        for (j = 0; j < imx_fsb_map[i].count; j++) {
+            fsb->reg[imx_fsb_map[i].fsb + j] =
+                g_imx8ulp_arg.fuse[imx_fsb_map[i].fuse + j];
+        }
     }
 }
 
@@ -560,12 +6705,16 @@ static void imx8ulp_arg_parse(void)
 
     printf("%s entry\n", __func__);
 
-    while (!feof(arg)) {
-        fgets(buf, ARG_BUF_SIZE, arg);
+    /* Without a run.arg the zeroed defaults stand: boot mode 0, no fuses */
+    if (!arg) {
+        return;
+    }
+
+    while (fgets(buf, ARG_BUF_SIZE, arg)) {
         key = strtok(buf, "=");
         value = strtok(NULL, "\n");
 
-        if (strcmp(key, "C_ARG +") == 0) {
+        if (key && strcmp(key, "C_ARG +") == 0) {
             imx8ulp_arg_handle_fuse(value);
         }
 
@@ -587,6 +6736,7 @@ static void imx8ulp_arg_parse(void)
         }
 
     }
+    fclose(arg);
 }
 
 /*=======================================
@@ -597,7 +6747,7 @@ static qemu_irq get_sse_irq_in(IMX8ULP_M33_MachineState *mms, int irqno)
 
     assert(irqno < IMX8ULP_M33_NUMIRQ);
 
-    return qdev_get_gpio_in_named(DEVICE(&mms->iotkit), "EXP_IRQ", irqno);
+    return mms->exp_irq[irqno];
 }
 
 static MemoryRegion *make_unimp_dev(IMX8ULP_M33_MachineState *mms,
@@ -618,6 +6768,87 @@ static MemoryRegion *make_unimp_dev(IMX8ULP_M33_MachineState *mms,
     return sysbus_mmio_get_region(SYS_BUS_DEVICE(uds), 0);
 }
 
+/*
+ * Back the boot ROM with a private, read-only mapping of rom-image.
+ * Instances started from the same file share its page cache pages; only
+ * a page that ROMCP patches gets copied.  The region is read-only to the
+ * guest, so stray stores never invalidate the translated ROM code.
+ */
+static void imx8ulp_map_rom_image(IMX8ULP_M33_MachineState *mms,
+        MemoryRegion *mr, const char *name, uint32_t size)
+{
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    fd = qemu_open(mms->rom_image, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        error_report("cannot open rom-image %s: %s", mms->rom_image,
+                     strerror(errno));
+        exit(1);
+    }
+    if (st.st_size > size) {
+        error_report("rom-image %s is larger than the %u byte ROM",
+                     mms->rom_image, size);
+        exit(1);
+    }
+
+    /* Anonymous zero pages past the end of a short image */
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED ||
+        (st.st_size && mmap(ptr, st.st_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+        error_report("cannot map rom-image %s: %s", mms->rom_image,
+                     strerror(errno));
+        exit(1);
+    }
+    qemu_close(fd);
+
+    memory_region_init_ram_ptr(mr, NULL, name, size, ptr);
+    memory_region_set_readonly(mr, true);
+}
+
+/*
+ * Would -kernel land in the ROM window?  An ELF is checked segment by
+ * segment, anything else is loaded raw at 0.  A file that cannot be read
+ * is left to armv7m_load_kernel() to report.
+ */
+static bool imx8ulp_kernel_hits_rom(const char *filename)
+{
+    Elf32_Ehdr *eh;
+    Elf32_Phdr *ph;
+    gchar *buf;
+    gsize len;
+    bool hit = false;
+    int i;
+
+    if (!g_file_get_contents(filename, &buf, &len, NULL)) {
+        return false;
+    }
+    eh = (Elf32_Ehdr *)buf;
+    if (len < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG)) {
+        hit = ranges_overlap(0, len, IMX_ROM_START, IMX_ROM_SIZE);
+    } else if (eh->e_ident[EI_CLASS] == ELFCLASS32) {
+        for (i = 0; i < le16_to_cpu(eh->e_phnum) && !hit; i++) {
+            uint64_t off = le32_to_cpu(eh->e_phoff) +
+                           (uint64_t)i * le16_to_cpu(eh->e_phentsize);
+
+            if (off + sizeof(*ph) > len) {
+                break;
+            }
+            ph = (Elf32_Phdr *)(buf + off);
+            hit = le32_to_cpu(ph->p_type) == PT_LOAD &&
+                  le32_to_cpu(ph->p_memsz) &&
+                  ranges_overlap(le32_to_cpu(ph->p_paddr),
+                                 le32_to_cpu(ph->p_memsz),
+                                 IMX_ROM_START, IMX_ROM_SIZE);
+        }
+    }
+    g_free(buf);
+    return hit;
+}
+
 static MemoryRegion *make_mpc(IMX8ULP_M33_MachineState *mms, void *opaque,
         const char *name, hwaddr size)
 {
@@ -626,19 +6857,14 @@ static MemoryRegion *make_mpc(IMX8ULP_M33_MachineState *mms, void *opaque,
     MemoryRegion *ssram = &mms->ssram[i];
     MemoryRegion *upstream;
     char *mpcname = g_strdup_printf("%s-mpc", name);
-    static uint32_t ramsize[] = {
-        0x00030000,
-        0x00080000,
-        0x00040000,
-    };
-    static uint32_t rambase[] = {
-        0x10000000,
-        0x30000000,
-        0x1ffc0000,
-    };
+    const imx_mem_region *map = &imx_ssram_map[i];
 
-    memory_region_init_ram(ssram, NULL, name, ramsize[i], &error_fatal);
-    //memory_region_init_ram_device_ptr(ssram, NULL, name, ramsize[i], &error_fatal);
+    if (i == IMX_SSRAM_ROM && mms->rom_image) {
+        imx8ulp_map_rom_image(mms, ssram, name, map->size);
+    } else {
+        memory_region_init_ram(ssram, NULL, name, map->size, &error_fatal);
+    }
+    //memory_region_init_ram_device_ptr(ssram, NULL, name, map->size, &error_fatal);
 
     sysbus_init_child_obj(OBJECT(mms), mpcname, mpc, sizeof(mms->ssram_mpc[0]),
             TYPE_TZ_MPC);
@@ -647,7 +6873,7 @@ static MemoryRegion *make_mpc(IMX8ULP_M33_MachineState *mms, void *opaque,
     object_property_set_bool(OBJECT(mpc), true, "realized", &error_fatal);
     /* Map the upstream end of the MPC into system memory */
     upstream = sysbus_mmio_get_region(SYS_BUS_DEVICE(mpc), 1);
-    memory_region_add_subregion(get_system_memory(), rambase[i], upstream);
+    memory_region_add_subregion(get_system_memory(), map->base, upstream);
     /* and connect its interrupt to the IoTKit */
     qdev_connect_gpio_out_named(DEVICE(mpc), "irq", 0,
             qdev_get_gpio_in_named(DEVICE(&mms->iotkit),
@@ -673,6 +6899,378 @@ static MemoryRegion *make_spi(IMX8ULP_M33_MachineState *mms, void *opaque,
     return sysbus_mmio_get_region(s, 0);
 }
 
+static MemoryRegion *make_cgc(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_cgc_state *cgc = opaque;
+
+    sysbus_init_child_obj(OBJECT(mms), name, cgc, sizeof(mms->cgc0),
+            TYPE_IMX_CGC);
+    qdev_prop_set_uint32(DEVICE(cgc), "sosc-freq", SYSCLK_FRQ);
+    object_property_set_bool(OBJECT(cgc), true, "realized", &error_fatal);
+    return sysbus_mmio_get_region(SYS_BUS_DEVICE(cgc), 0);
+}
+
+static MemoryRegion *make_pcc(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_pcc_state *pcc = opaque;
+
+    sysbus_init_child_obj(OBJECT(mms), name, pcc, sizeof(mms->pcc[0]),
+            TYPE_IMX_PCC);
+    object_property_set_link(OBJECT(pcc), OBJECT(&mms->cgc0), "cgc",
+            &error_fatal);
+    object_property_set_bool(OBJECT(pcc), true, "realized", &error_fatal);
+    return sysbus_mmio_get_region(SYS_BUS_DEVICE(pcc), 0);
+}
+
+static MemoryRegion *make_romcp(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_romcp_state *romcp = opaque;
+
+    sysbus_init_child_obj(OBJECT(mms), name, romcp, sizeof(mms->romcp0),
+            TYPE_IMX_ROMCP);
+    qdev_prop_set_uint64(DEVICE(romcp), "rom-base", IMX_ROM_START);
+    qdev_prop_set_uint32(DEVICE(romcp), "rom-size", IMX_ROM_SIZE);
+    object_property_set_bool(OBJECT(romcp), true, "realized", &error_fatal);
+    return sysbus_mmio_get_region(SYS_BUS_DEVICE(romcp), 0);
+}
+
+static MemoryRegion *make_lpuart(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_lpuart_state *uart = opaque;
+    int i = uart - &mms->uart[0];
+    SysBusDevice *s;
+
+    sysbus_init_child_obj(OBJECT(mms), name, uart, sizeof(mms->uart[0]),
+            TYPE_IMX_LPUART);
+    qdev_prop_set_chr(DEVICE(uart), "chardev", serial_hd(i));
+    object_property_set_bool(OBJECT(uart), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(uart);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_LPUART_IRQ_BASE + i));
+    imx_pcc_connect_clock(&mms->pcc[0], IMX_PCC0_LPUART0 + 4 * i,
+            &uart->clk_notifier);
+    return sysbus_mmio_get_region(s, 0);
+}
+
+static MemoryRegion *make_lpit(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_lpit_state *lpit = opaque;
+    SysBusDevice *s;
+
+    sysbus_init_child_obj(OBJECT(mms), name, lpit, sizeof(mms->lpit0),
+            TYPE_IMX_LPIT);
+    object_property_set_bool(OBJECT(lpit), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(lpit);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_LPIT0_IRQ));
+    imx_pcc_connect_clock(&mms->pcc[0], IMX_PCC0_LPIT0, &lpit->clk_notifier);
+    return sysbus_mmio_get_region(s, 0);
+}
+
+/*
+ * MSC i in front of a bus master, on the IoTKit's mscexp lines i as the
+ * MPS2 DMAs are.  Returns the MSC; its region 0 is the master's view.
+ */
+static TZMSC *make_master_msc(IMX8ULP_M33_MachineState *mms, int i,
+        const char *name)
+{
+    TZMSC *msc = &mms->msc[i];
+    DeviceState *iotkitdev = DEVICE(&mms->iotkit);
+    char *mscname = g_strdup_printf("%s-msc", name);
+
+    sysbus_init_child_obj(OBJECT(mms), mscname, msc, sizeof(*msc),
+            TYPE_TZ_MSC);
+    object_property_set_link(OBJECT(msc), OBJECT(get_system_memory()),
+            "downstream", &error_fatal);
+    object_property_set_link(OBJECT(msc), OBJECT(mms), "idau", &error_fatal);
+    object_property_set_bool(OBJECT(msc), true, "realized", &error_fatal);
+    g_free(mscname);
+
+    qdev_connect_gpio_out_named(DEVICE(msc), "irq", 0,
+            qdev_get_gpio_in_named(iotkitdev, "mscexp_status", i));
+    qdev_connect_gpio_out_named(iotkitdev, "mscexp_clear", i,
+            qdev_get_gpio_in_named(DEVICE(msc), "irq_clear", 0));
+    qdev_connect_gpio_out_named(iotkitdev, "mscexp_ns", i,
+            qdev_get_gpio_in_named(DEVICE(msc), "cfg_nonsec", 0));
+    qdev_connect_gpio_out(DEVICE(&mms->sec_resp_splitter),
+            ARRAY_SIZE(mms->ppc) + i, qdev_get_gpio_in_named(DEVICE(msc),
+                "cfg_sec_resp", 0));
+    return msc;
+}
+
+static MemoryRegion *make_crypto(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_crypto_state *crypto = opaque;
+    TZMSC *msc = make_master_msc(mms, 1, name);
+    SysBusDevice *s;
+
+    sysbus_init_child_obj(OBJECT(mms), name, crypto, sizeof(mms->crypto),
+            TYPE_IMX_CRYPTO);
+    object_property_set_link(OBJECT(crypto),
+            OBJECT(sysbus_mmio_get_region(SYS_BUS_DEVICE(msc), 0)),
+            "downstream", &error_fatal);
+    object_property_set_link(OBJECT(crypto), OBJECT(msc), "msc", &error_fatal);
+    object_property_set_link(OBJECT(crypto), OBJECT(mms), "idau",
+            &error_fatal);
+    object_property_set_bool(OBJECT(crypto), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(crypto);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_CRYPTO_IRQ));
+    return sysbus_mmio_get_region(s, 0);
+}
+
+static MemoryRegion *make_flexspi(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_flexspi_state *fspi = opaque;
+    SysBusDevice *s;
+
+    sysbus_init_child_obj(OBJECT(mms), name, fspi, sizeof(mms->flexspi0),
+            TYPE_IMX_FLEXSPI);
+    if (mms->flexspi_image) {
+        qdev_prop_set_string(DEVICE(fspi), "image", mms->flexspi_image);
+    }
+    qdev_prop_set_uint64(DEVICE(fspi), "xip-base", IMX_FLEXSPI0_AMBA);
+    object_property_set_bool(OBJECT(fspi), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(fspi);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_FLEXSPI0_IRQ));
+    /* The AHB window sits outside the PPC, straight on the system bus */
+    memory_region_add_subregion(get_system_memory(), IMX_FLEXSPI0_AMBA,
+            sysbus_mmio_get_region(s, 1));
+    return sysbus_mmio_get_region(s, 0);
+}
+
+static MemoryRegion *make_upower(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_upower_state *upower = opaque;
+    SysBusDevice *s;
+
+    sysbus_init_child_obj(OBJECT(mms), name, upower, sizeof(mms->upower),
+            TYPE_IMX_UPOWER);
+    object_property_set_bool(OBJECT(upower), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(upower);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_UPOWER_IRQ));
+    return sysbus_mmio_get_region(s, 0);
+}
+
+static MemoryRegion *make_cosim(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_cosim_state *cosim = opaque;
+    SysBusDevice *s;
+    int i;
+
+    sysbus_init_child_obj(OBJECT(mms), name, cosim, sizeof(mms->cosim),
+            TYPE_IMX_COSIM);
+    qdev_prop_set_string(DEVICE(cosim), "path", mms->cosim_path);
+    qdev_prop_set_uint64(DEVICE(cosim), "size", size);
+    object_property_set_bool(OBJECT(cosim), true, "realized", &error_fatal);
+    s = SYS_BUS_DEVICE(cosim);
+    for (i = 0; i < IMX_COSIM_NUM_IRQ; i++) {
+        sysbus_connect_irq(s, i, get_sse_irq_in(mms, IMX_COSIM_IRQ_BASE + i));
+    }
+    return sysbus_mmio_get_region(s, 0);
+}
+
+static MemoryRegion *make_edma(IMX8ULP_M33_MachineState *mms, void *opaque,
+        const char *name, hwaddr size)
+{
+    imx_edma_state *edma = opaque;
+    /* The eDMA masters the bus through MSC0 */
+    TZMSC *msc = make_master_msc(mms, 0, name);
+    SysBusDevice *s;
+    int i;
+
+    sysbus_init_child_obj(OBJECT(mms), name, edma, sizeof(mms->edma0),
+            TYPE_IMX_EDMA);
+    object_property_set_link(OBJECT(edma),
+            OBJECT(sysbus_mmio_get_region(SYS_BUS_DEVICE(msc), 0)),
+            "downstream", &error_fatal);
+    object_property_set_link(OBJECT(edma), OBJECT(msc), "msc", &error_fatal);
+    object_property_set_link(OBJECT(edma), OBJECT(mms), "idau", &error_fatal);
+    object_property_set_bool(OBJECT(edma), true, "realized", &error_fatal);
+
+    s = SYS_BUS_DEVICE(edma);
+    for (i = 0; i < IMX_EDMA_NUM_CH; i++) {
+        sysbus_connect_irq(s, i, get_sse_irq_in(mms, IMX_EDMA0_IRQ_BASE + i));
+    }
+    sysbus_connect_irq(s, IMX_EDMA_NUM_CH,
+            get_sse_irq_in(mms, IMX_EDMA0_ERR_IRQ));
+    return sysbus_mmio_get_region(s, 0);
+}
+
+/* For CPUs that are not on a qbus, so no device reset reaches them */
+static void imx8ulp_cpu_reset(void *opaque)
+{
+    cpu_reset(CPU(opaque));
+}
+
+/*
+ * Cortex-A35 application domain of imx8ulp-dual.  QEMU has no A35, the
+ * A53 implements the same ARMv8-A profile.  The domain has its own
+ * address space; it shares DRAM and SSRAM with the M33 and talks to it
+ * through MU0.  Every vCPU runs on its own MTTCG thread.
+ *
+ * CPU0 runs a35-image from reset.  The others start powered off and are
+ * released with PSCI CPU_ON over SMC, which QEMU implements itself;
+ * CPU n has MPIDR affinity n.
+ */
+static void imx8ulp_a35_create_cpus(IMX8ULP_M33_MachineState *mms, int n)
+{
+    int i;
+
+    memory_region_init(&mms->a35_mem, OBJECT(mms), "a35.memory", UINT64_MAX);
+    for (i = 0; i < n; i++) {
+        Object *cpuobj = object_new(ARM_CPU_TYPE_NAME("cortex-a53"));
+        char *name = g_strdup_printf("a35[%d]", i);
+
+        object_property_add_child(OBJECT(mms), name, cpuobj, &error_abort);
+        g_free(name);
+        object_property_set_link(cpuobj, OBJECT(&mms->a35_mem), "memory",
+                &error_abort);
+        object_property_set_int(cpuobj, IMX_A35_SSRAM_START, "rvbar",
+                &error_abort);
+        object_property_set_int(cpuobj, i, "mp-affinity", &error_abort);
+        object_property_set_int(cpuobj, QEMU_PSCI_CONDUIT_SMC,
+                "psci-conduit", &error_abort);
+        object_property_set_bool(cpuobj, i > 0 || !mms->a35_image,
+                "start-powered-off", &error_abort);
+        object_property_set_bool(cpuobj, true, "realized", &error_fatal);
+        object_unref(cpuobj);
+        mms->a35[i] = ARM_CPU(cpuobj);
+        qemu_register_reset(imx8ulp_cpu_reset, mms->a35[i]);
+    }
+}
+
+static void imx8ulp_a35_init(IMX8ULP_M33_MachineState *mms)
+{
+    IMX8ULP_MachineClass *mmc = IMX8ULP_MACHINE_GET_CLASS(mms);
+    int n = mmc->num_a35;
+    SysBusDevice *gicbusdev;
+    SysBusDevice *s;
+    int i, irq;
+
+    /* GIC-500 style GICv3, timers on their usual PPIs */
+    mms->a35_gic = qdev_create(NULL, TYPE_ARM_GICV3);
+    qdev_prop_set_uint32(mms->a35_gic, "revision", 3);
+    qdev_prop_set_uint32(mms->a35_gic, "num-cpu", n);
+    qdev_prop_set_uint32(mms->a35_gic, "num-irq", IMX_A35_NUM_SPI + 32);
+    qdev_prop_set_bit(mms->a35_gic, "has-security-extensions", true);
+    qdev_prop_set_uint32(mms->a35_gic, "len-redist-region-count", 1);
+    qdev_prop_set_uint32(mms->a35_gic, "redist-region-count[0]", n);
+    qdev_init_nofail(mms->a35_gic);
+    gicbusdev = SYS_BUS_DEVICE(mms->a35_gic);
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_GICD_START,
+            sysbus_mmio_get_region(gicbusdev, 0));
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_GICR_START,
+            sysbus_mmio_get_region(gicbusdev, 1));
+
+    for (i = 0; i < n; i++) {
+        DeviceState *cpudev = DEVICE(mms->a35[i]);
+        int ppibase = IMX_A35_NUM_SPI + i * 32;
+        static const int timer_irq[] = {
+            [GTIMER_PHYS] = 30,
+            [GTIMER_VIRT] = 27,
+            [GTIMER_HYP]  = 26,
+            [GTIMER_SEC]  = 29,
+        };
+
+        for (irq = 0; irq < ARRAY_SIZE(timer_irq); irq++) {
+            qdev_connect_gpio_out(cpudev, irq,
+                    qdev_get_gpio_in(mms->a35_gic, ppibase + timer_irq[irq]));
+        }
+        qdev_connect_gpio_out_named(cpudev, "gicv3-maintenance-interrupt", 0,
+                qdev_get_gpio_in(mms->a35_gic, ppibase + 25));
+        sysbus_connect_irq(gicbusdev, i,
+                qdev_get_gpio_in(cpudev, ARM_CPU_IRQ));
+        sysbus_connect_irq(gicbusdev, i + n,
+                qdev_get_gpio_in(cpudev, ARM_CPU_FIQ));
+        sysbus_connect_irq(gicbusdev, i + 2 * n,
+                qdev_get_gpio_in(cpudev, ARM_CPU_VIRQ));
+        sysbus_connect_irq(gicbusdev, i + 3 * n,
+                qdev_get_gpio_in(cpudev, ARM_CPU_VFIQ));
+    }
+
+    /* Shared memories; DRAM is not behind the M33's TRDC on this side */
+    memory_region_init_alias(&mms->a35_ssram, OBJECT(mms), "a35.ssram",
+            &mms->ssram[1], 0, memory_region_size(&mms->ssram[1]));
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_SSRAM_START,
+            &mms->a35_ssram);
+    memory_region_init_alias(&mms->a35_dram, OBJECT(mms), "a35.dram",
+            &mms->psram, 0, memory_region_size(&mms->psram));
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_DRAM_START,
+            &mms->a35_dram);
+
+    /* MU0: side A to the M33, side B to the A35 */
+    sysbus_init_child_obj(OBJECT(mms), "mu0", &mms->mu0, sizeof(mms->mu0),
+            TYPE_IMX_MU);
+    object_property_set_bool(OBJECT(&mms->mu0), true, "realized",
+            &error_fatal);
+    s = SYS_BUS_DEVICE(&mms->mu0);
+    sysbus_mmio_map(s, 0, IMX_MU0_START);
+    sysbus_connect_irq(s, 0, get_sse_irq_in(mms, IMX_MU0_IRQ));
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_MU0_START,
+            sysbus_mmio_get_region(s, 1));
+    sysbus_connect_irq(s, 1,
+            qdev_get_gpio_in(mms->a35_gic, IMX_A35_MU0_SPI));
+
+    /* The A35 boot pins land in its own CMC, as the M33's do in CMC0 */
+    sysbus_init_child_obj(OBJECT(mms), "cmc1", &mms->cmc1,
+            sizeof(mms->cmc1), TYPE_IMX_CMC);
+    qdev_prop_set_uint32(DEVICE(&mms->cmc1), "mr0",
+            (g_imx8ulp_arg.bt_mode << 30) | (g_imx8ulp_arg.a35_bt_cfg));
+    object_property_set_bool(OBJECT(&mms->cmc1), true, "realized",
+            &error_fatal);
+    memory_region_add_subregion(&mms->a35_mem, IMX_A35_CMC1_START,
+            sysbus_mmio_get_region(SYS_BUS_DEVICE(&mms->cmc1), 0));
+
+    address_space_init(&mms->a35_as, &mms->a35_mem, "a35");
+    if (mms->a35_image &&
+        load_image_targphys_as(mms->a35_image, IMX_A35_SSRAM_START,
+                memory_region_size(&mms->a35_ssram), &mms->a35_as) < 0) {
+        error_report("cannot load a35-image %s", mms->a35_image);
+        exit(1);
+    }
+}
+
+/*
+ * SysTick counts the core clock when CLKSOURCE is set.  A new rate takes
+ * effect at the next reload.  The IoTKit's own CMSDK timers keep the
+ * MAINCLK they were realized with.
+ */
+static void imx8ulp_core_clk_changed(Notifier *n, void *data)
+{
+    uint32_t freq = *(uint32_t *)data;
+
+    if (freq) {
+        system_clock_scale = MAX(NANOSECONDS_PER_SECOND / freq, 1);
+    }
+}
+
+/*
+ * Sleep signalling from the M33 to CMC0.  Every expansion interrupt goes
+ * through here on its way to the NVIC: one that rises while the core is
+ * halted in WFI finds it asleep, in the mode SCR.SLEEPDEEP selected.
+ * SysTick, which bypasses this path, stops in deep sleep anyway.
+ */
+static void imx8ulp_exp_irq(void *opaque, int n, int level)
+{
+    IMX8ULP_M33_MachineState *mms = opaque;
+    CPUState *cs = CPU(mms->iotkit.armv7m[0].cpu);
+
+    if (level && atomic_read(&cs->halted)) {
+        CPUARMState *env = &ARM_CPU(cs)->env;
+
+        imx_cmc_core_sleep(&mms->cmc0,
+                env->v7m.scr[env->v7m.secure] & R_V7M_SCR_SLEEPDEEP_MASK);
+    }
+    qemu_set_irq(mms->sse_irq[n], level);
+}
+
 static void imx8ulp_m33_common_init(MachineState *machine)
 {
     IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(machine);
@@ -681,6 +7279,8 @@ static void imx8ulp_m33_common_init(MachineState *machine)
     MemoryRegion *system_memory = get_system_memory();
     DeviceState *iotkitdev;
     DeviceState *dev_splitter;
+    DeviceState *dev;
+    uint32_t tmp;
     int i;
 
     if (strcmp(machine->cpu_type, mc->default_cpu_type) != 0) {
@@ -689,6 +7289,14 @@ static void imx8ulp_m33_common_init(MachineState *machine)
         exit(1);
     }
 
+    /*
+     * The GICv3 CPU interfaces bind to CPUs 0..n-1, so the A35s have to
+     * be realized before the SSE creates the M33.
+     */
+    if (mmc->num_a35) {
+        imx8ulp_a35_create_cpus(mms, mmc->num_a35);
+    }
+
     sysbus_init_child_obj(OBJECT(machine), "iotkit", &mms->iotkit,
             sizeof(mms->iotkit), mmc->armsse_type);
     iotkitdev = DEVICE(&mms->iotkit);
@@ -698,7 +7306,11 @@ static void imx8ulp_m33_common_init(MachineState *machine)
     qdev_prop_set_uint32(iotkitdev, "MAINCLK", SYSCLK_FRQ);
     object_property_set_bool(OBJECT(&mms->iotkit), true, "realized",
             &error_fatal);
-
+    for (i = 0; i < IMX8ULP_M33_NUMIRQ; i++) {
+        mms->sse_irq[i] = qdev_get_gpio_in_named(iotkitdev, "EXP_IRQ", i);
+    }
+    mms->exp_irq = qemu_allocate_irqs(imx8ulp_exp_irq, mms,
+            IMX8ULP_M33_NUMIRQ);
 
     /* The sec_resp_cfg output from the IoTKit must be split into multiple
      * lines, one for each of the PPCs we create here, plus one per MSC.
@@ -728,22 +7340,17 @@ static void imx8ulp_m33_common_init(MachineState *machine)
      */
 
     memory_region_allocate_system_memory(&mms->psram,
-            NULL, "mps.ram", 16 * MiB);
-    memory_region_add_subregion(system_memory, 0x80000000, &mms->psram);
+            NULL, "mps.ram", IMX_PSRAM_SIZE);
 
-    /* The overflow IRQs for all UARTs are ORed together.
-     * Tx, Rx and "combined" IRQs are sent to the NVIC separately.
-     * Create the OR gate for this.
-     */
-    object_initialize_child(OBJECT(mms), "uart-irq-orgate",
-            &mms->uart_irq_orgate, sizeof(mms->uart_irq_orgate),
-            TYPE_OR_IRQ, &error_abort, NULL);
-    object_property_set_int(OBJECT(&mms->uart_irq_orgate), 10, "num-lines",
+    /* PSRAM is reached through the TRDC memory block checker */
+    sysbus_init_child_obj(OBJECT(machine), "trdc", &mms->trdc,
+            sizeof(mms->trdc), TYPE_IMX_TRDC);
+    object_property_set_link(OBJECT(&mms->trdc), OBJECT(&mms->psram),
+            "downstream", &error_fatal);
+    object_property_set_bool(OBJECT(&mms->trdc), true, "realized",
             &error_fatal);
-    object_property_set_bool(OBJECT(&mms->uart_irq_orgate), true,
-            "realized", &error_fatal);
-    qdev_connect_gpio_out(DEVICE(&mms->uart_irq_orgate), 0,
-            get_sse_irq_in(mms, 15));
+    sysbus_mmio_map(SYS_BUS_DEVICE(&mms->trdc), 0, IMX_TRDC_START);
+    sysbus_mmio_map(SYS_BUS_DEVICE(&mms->trdc), 1, IMX_PSRAM_START);
 
     /* Most of the devices in the FPGA are behind Peripheral Protection
      * Controllers. The required order for initializing things is:
@@ -759,11 +7366,12 @@ static void imx8ulp_m33_common_init(MachineState *machine)
     const PPCInfo ppcs[] = { {
         .name = "apb_ppcexp0",
         .ports = {
-            {"cgc0", make_unimp_dev, &mms->cgc0, IMX_CGC0_START, 0x1000},
-            {"pcc0", make_unimp_dev, &mms->pcc0, IMX_PCC0_START, 0x1000},
-            {"pcc1", make_unimp_dev, &mms->pcc1, IMX_PCC1_START, 0x1000},
-            {"romcp0", make_unimp_dev, &mms->romcp0, IMX_ROMCP0_START, 0x1000},
-            {"upower", make_unimp_dev, &mms->upower, 0x28350000, 0x1000},
+            {"cgc0", make_cgc, &mms->cgc0, IMX_CGC0_START, 0x1000},
+            {"pcc0", make_pcc, &mms->pcc[0], IMX_PCC0_START, 0x1000},
+            {"pcc1", make_pcc, &mms->pcc[1], IMX_PCC1_START, 0x1000},
+            {"romcp0", make_romcp, &mms->romcp0, IMX_ROMCP0_START, 0x1000},
+            {"upower", make_upower, &mms->upower, IMX_UPOWER_START, 0x1000},
+            {"lpit0", make_lpit, &mms->lpit0, IMX_LPIT0_START, 0x1000},
             { "ssram-0", make_mpc, &mms->ssram_mpc[0], 0x58007000, 0x1000 },
             { "ssram-1", make_mpc, &mms->ssram_mpc[1], 0x58008000, 0x1000 },
             { "ssram-2", make_mpc, &mms->ssram_mpc[2], 0x58009000, 0x1000 },
@@ -773,6 +7381,15 @@ static void imx8ulp_m33_common_init(MachineState *machine)
         .ports = {
             { "spi0", make_spi, &mms->spi[0], 0x40205000, 0x1000 },
             { "i2c0", make_unimp_dev, &mms->i2c[0], 0x40207000, 0x1000 },
+            { "lpuart0", make_lpuart, &mms->uart[0], IMX_LPUART0_START, 0x1000 },
+            { "lpuart1", make_lpuart, &mms->uart[1], IMX_LPUART1_START, 0x1000 },
+            { "lpuart2", make_lpuart, &mms->uart[2], IMX_LPUART2_START, 0x1000 },
+            { "lpuart3", make_lpuart, &mms->uart[3], IMX_LPUART3_START, 0x1000 },
+            { "flexspi0", make_flexspi, &mms->flexspi0, IMX_FLEXSPI0_START, 0x1000 },
+            { "edma0", make_edma, &mms->edma0, IMX_EDMA0_START, IMX_EDMA0_SIZE },
+            { "crypto", make_crypto, &mms->crypto, IMX_CRYPTO_START, 0x1000 },
+            { "cosim", mms->cosim_path ? make_cosim : NULL, &mms->cosim,
+              mms->cosim_base, mms->cosim_size },
         },
     },
     };
@@ -848,18 +7465,41 @@ static void imx8ulp_m33_common_init(MachineState *machine)
                     "cfg_sec_resp", 0));
     }
 
+    mms->core_clk_notifier.notify = imx8ulp_core_clk_changed;
+    imx_cgc_connect_clock(&mms->cgc0, IMX_CGC_CORE, &mms->core_clk_notifier);
+
     imx8ulp_arg_parse();
     /* create the verilog debug */
-    sysbus_create_simple(TYPE_VERILOG_DEBUG, VERILOG_DEBUG_START, NULL);
-    sysbus_create_simple(TYPE_IMX_FSB, IMX_FSB_START, NULL);
+    dev = qdev_create(NULL, TYPE_VERILOG_DEBUG);
+    if (mms->vdebug_dir) {
+        qdev_prop_set_string(dev, "dir", mms->vdebug_dir);
+    }
+    qdev_init_nofail(dev);
+    sysbus_mmio_map(SYS_BUS_DEVICE(dev), 0, VERILOG_DEBUG_START);
+    sysbus_connect_irq(SYS_BUS_DEVICE(dev), 0,
+            get_sse_irq_in(mms, VERILOG_DEBUG_IRQ));
+    dev = sysbus_create_simple(TYPE_IMX_FSB, IMX_FSB_START, NULL);
+    sysbus_init_child_obj(OBJECT(machine), "ocotp", &mms->ocotp,
+            sizeof(mms->ocotp), TYPE_IMX_OCOTP);
+    object_property_set_link(OBJECT(&mms->ocotp), OBJECT(dev), "fsb",
+            &error_abort);
+    if (mms->fuse_file) {
+        qdev_prop_set_string(DEVICE(&mms->ocotp), "file", mms->fuse_file);
+    }
+    object_property_set_bool(OBJECT(&mms->ocotp), true, "realized",
+            &error_fatal);
+    sysbus_mmio_map(SYS_BUS_DEVICE(&mms->ocotp), 0, IMX_OCOTP_START);
     sysbus_create_simple(TYPE_IMX_S400_MU, IMX_S400_MU_START, NULL);
     sysbus_create_simple(TYPE_IMX_SIM0, IMX_SIM0_S_START, NULL);
     sysbus_create_simple(TYPE_IMX_TSTMR, IMX_TSTMR_START, NULL);
 
-    memory_region_allocate_system_memory(&mms->cmc0, NULL, "cmc0.ram", 0x1000);
-    memory_region_add_subregion(system_memory, IMX_CMC0_START, &mms->cmc0);
-    uint32_t tmp = (g_imx8ulp_arg.bt_mode << 30) | (g_imx8ulp_arg.m33_bt_cfg);
-    cpu_physical_memory_write(IMX_CMC0_START + 0xA0, &tmp, 4);
+    sysbus_init_child_obj(OBJECT(machine), "cmc0", &mms->cmc0,
+            sizeof(mms->cmc0), TYPE_IMX_CMC);
+    qdev_prop_set_uint32(DEVICE(&mms->cmc0), "mr0",
+            (g_imx8ulp_arg.bt_mode << 30) | (g_imx8ulp_arg.m33_bt_cfg));
+    object_property_set_bool(OBJECT(&mms->cmc0), true, "realized",
+            &error_fatal);
+    sysbus_mmio_map(SYS_BUS_DEVICE(&mms->cmc0), 0, IMX_CMC0_START);
 
     memory_region_allocate_system_memory(&mms->fsb_low, NULL, "fsb_low.ram", 0x800);
     memory_region_add_subregion(system_memory, IMX_FSB_LOW_START, &mms->fsb_low);
@@ -867,7 +7507,31 @@ static void imx8ulp_m33_common_init(MachineState *machine)
     cpu_physical_memory_write(IMX_FSB_LOW_START + 0x41c, &tmp, 4);
 
 
-    armv7m_load_kernel(ARM_CPU(first_cpu), machine->kernel_filename, 0x400000);
+    if (mmc->num_a35) {
+        imx8ulp_a35_init(mms);
+    }
+
+    /*
+     * With rom-image the ROM is already there.  -kernel is optional then
+     * (its symbols still feed the profiler), but may not load over it.
+     */
+    if (mms->rom_image && machine->kernel_filename &&
+        imx8ulp_kernel_hits_rom(machine->kernel_filename)) {
+        error_report("-kernel %s overlaps the ROM that rom-image provides",
+                     machine->kernel_filename);
+        exit(1);
+    }
+    if (!mms->rom_image || machine->kernel_filename) {
+        armv7m_load_kernel(mms->iotkit.armv7m[0].cpu,
+                machine->kernel_filename, 0x400000);
+    } else {
+        qemu_register_reset(imx8ulp_cpu_reset, mms->iotkit.armv7m[0].cpu);
+    }
+
+    if (mms->profile) {
+        imx_prof_start(&mms->prof, CPU(mms->iotkit.armv7m[0].cpu),
+                mms->profile, mms->profile_interval);
+    }
 }
 
 static void imx8ulp_m33_idau_check(IDAUInterface *ii, uint32_t address,
@@ -888,6 +7552,206 @@ static void imx8ulp_m33_idau_check(IDAUInterface *ii, uint32_t address,
     *iregion = region;
 }
 
+static char *imx8ulp_get_flexspi_image(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->flexspi_image);
+}
+
+static void imx8ulp_set_flexspi_image(Object *obj, const char *value,
+        Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->flexspi_image);
+    mms->flexspi_image = g_strdup(value);
+}
+
+static char *imx8ulp_get_rom_image(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->rom_image);
+}
+
+static void imx8ulp_set_rom_image(Object *obj, const char *value,
+        Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->rom_image);
+    mms->rom_image = g_strdup(value);
+}
+
+static char *imx8ulp_get_cosim(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->cosim_path);
+}
+
+static void imx8ulp_set_cosim(Object *obj, const char *value, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->cosim_path);
+    mms->cosim_path = g_strdup(value);
+}
+
+static void imx8ulp_get_cosim_u64(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    visit_type_uint64(v, name, opaque, errp);
+}
+
+static void imx8ulp_set_cosim_u64(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    visit_type_uint64(v, name, opaque, errp);
+}
+
+static char *imx8ulp_get_a35_image(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->a35_image);
+}
+
+static void imx8ulp_set_a35_image(Object *obj, const char *value,
+        Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->a35_image);
+    mms->a35_image = g_strdup(value);
+}
+
+static char *imx8ulp_get_vdebug_dir(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->vdebug_dir);
+}
+
+static void imx8ulp_set_vdebug_dir(Object *obj, const char *value,
+        Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->vdebug_dir);
+    mms->vdebug_dir = g_strdup(value);
+}
+
+static char *imx8ulp_get_fuse_file(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->fuse_file);
+}
+
+static void imx8ulp_set_fuse_file(Object *obj, const char *value,
+        Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->fuse_file);
+    mms->fuse_file = g_strdup(value);
+}
+
+static char *imx8ulp_get_profile(Object *obj, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    return g_strdup(mms->profile);
+}
+
+static void imx8ulp_set_profile(Object *obj, const char *value, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    g_free(mms->profile);
+    mms->profile = g_strdup(value);
+}
+
+static void imx8ulp_get_profile_interval(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    visit_type_uint64(v, name, &mms->profile_interval, errp);
+}
+
+static void imx8ulp_set_profile_interval(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    visit_type_uint64(v, name, &mms->profile_interval, errp);
+}
+
+static void imx8ulp_instance_init(Object *obj)
+{
+    IMX8ULP_M33_MachineState *mms = IMX8ULP_MACHINE(obj);
+
+    object_property_add_str(obj, "flexspi-image", imx8ulp_get_flexspi_image,
+            imx8ulp_set_flexspi_image, NULL);
+    object_property_set_description(obj, "flexspi-image",
+            "Host file backing the FlexSPI0 serial NOR", NULL);
+
+    object_property_add_str(obj, "rom-image", imx8ulp_get_rom_image,
+            imx8ulp_set_rom_image, NULL);
+    object_property_set_description(obj, "rom-image",
+            "Boot ROM image, mapped shared between instances", NULL);
+
+    object_property_add_str(obj, "cosim", imx8ulp_get_cosim,
+            imx8ulp_set_cosim, NULL);
+    object_property_set_description(obj, "cosim",
+            "Shared ring file of an RTL simulator backing the cosim window",
+            NULL);
+    mms->cosim_base = IMX_COSIM_START;
+    object_property_add(obj, "cosim-base", "uint64", imx8ulp_get_cosim_u64,
+            imx8ulp_set_cosim_u64, NULL, &mms->cosim_base, NULL);
+    object_property_set_description(obj, "cosim-base",
+            "Address of the cosim window", NULL);
+    mms->cosim_size = 0x1000;
+    object_property_add(obj, "cosim-size", "uint64", imx8ulp_get_cosim_u64,
+            imx8ulp_set_cosim_u64, NULL, &mms->cosim_size, NULL);
+    object_property_set_description(obj, "cosim-size",
+            "Size of the cosim window", NULL);
+
+    if (IMX8ULP_MACHINE_GET_CLASS(obj)->num_a35) {
+        object_property_add_str(obj, "a35-image", imx8ulp_get_a35_image,
+                imx8ulp_set_a35_image, NULL);
+        object_property_set_description(obj, "a35-image",
+                "Raw image the A35 boots from, loaded at the start of SSRAM",
+                NULL);
+    }
+
+    object_property_add_str(obj, "vdebug-dir", imx8ulp_get_vdebug_dir,
+            imx8ulp_set_vdebug_dir, NULL);
+    object_property_set_description(obj, "vdebug-dir",
+            "Host directory the verilog_debug file commands work in", NULL);
+
+    object_property_add_str(obj, "fuse-file", imx8ulp_get_fuse_file,
+            imx8ulp_set_fuse_file, NULL);
+    object_property_set_description(obj, "fuse-file",
+            "Host file holding the OTP fuses, programmed fuses persist", NULL);
+
+    object_property_add_str(obj, "profile", imx8ulp_get_profile,
+            imx8ulp_set_profile, NULL);
+    object_property_set_description(obj, "profile",
+            "Sample the guest and write folded stacks to this file", NULL);
+
+    mms->profile_interval = IMX_PROF_DEFAULT_NS;
+    object_property_add(obj, "profile-interval", "uint64",
+            imx8ulp_get_profile_interval, imx8ulp_set_profile_interval,
+            NULL, NULL, NULL);
+    object_property_set_description(obj, "profile-interval",
+            "Virtual ns between samples (instructions with -icount shift=0)",
+            NULL);
+}
+
 static void imx8ulp_class_init(ObjectClass *oc, void *data)
 {
     MachineClass *mc = MACHINE_CLASS(oc);
@@ -910,11 +7774,29 @@ static void imx8ulp_m33_class_init(ObjectClass *oc, void *data)
     mmc->armsse_type = TYPE_IOTKIT;
 }
 
+#ifdef TARGET_AARCH64
+static void imx8ulp_dual_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+    IMX8ULP_MachineClass *mmc = IMX8ULP_MACHINE_CLASS(oc);
+
+    mc->desc = "i.MX8ULP with the Cortex-M33 and Cortex-A35 domains";
+    /* The M33 plus every A35; each one is a CPU the board creates */
+    mc->default_cpus = 1 + IMX_A35_NUM_CPUS;
+    mc->min_cpus = mc->default_cpus;
+    mc->max_cpus = mc->default_cpus;
+    mc->default_cpu_type = ARM_CPU_TYPE_NAME("cortex-m33");
+    mmc->armsse_type = TYPE_IOTKIT;
+    mmc->num_a35 = IMX_A35_NUM_CPUS;
+}
+#endif
+
 static const TypeInfo imx8ulp_info = {
     .name = TYPE_IMX8ULP_MACHINE,
     .parent = TYPE_MACHINE,
     .abstract = true,
     .instance_size = sizeof(IMX8ULP_M33_MachineState),
+    .instance_init = imx8ulp_instance_init,
     .class_size = sizeof(IMX8ULP_MachineClass),
     .class_init = imx8ulp_class_init,
     .interfaces = (InterfaceInfo[]) {
@@ -929,10 +7811,21 @@ static const TypeInfo imx8ulp_m33_info = {
     .class_init = imx8ulp_m33_class_init,
 };
 
+#ifdef TARGET_AARCH64
+static const TypeInfo imx8ulp_dual_info = {
+    .name = TYPE_IMX8ULP_DUAL_MACHINE,
+    .parent = TYPE_IMX8ULP_MACHINE,
+    .class_init = imx8ulp_dual_class_init,
+};
+#endif
+
 static void imx8ulp_machine_init(void)
 {
     type_register_static(&imx8ulp_info);
     type_register_static(&imx8ulp_m33_info);
+#ifdef TARGET_AARCH64
+    type_register_static(&imx8ulp_dual_info);
+#endif
 }
 
 type_init(imx8ulp_machine_init);
@@ -5,26 +5,61 @@
 #include "qemu/units.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "qemu/host-utils.h"
 #include "hw/arm/boot.h"
 #include "hw/arm/armv7m.h"
-#include "hw/or-irq.h"
 #include "hw/boards.h"
 #include "exec/address-spaces.h"
 #include "sysemu/sysemu.h"
+#include "sysemu/reset.h"
 #include "hw/misc/unimp.h"
-#include "hw/char/cmsdk-apb-uart.h"
 #include "hw/misc/tz-mpc.h"
 #include "hw/misc/tz-msc.h"
 #include "hw/arm/armsse.h"
+#include "hw/intc/arm_gicv3.h"
+#include "hw/loader.h"
+#include "elf.h"
+#include "qemu/range.h"
 #include "hw/ssi/pl022.h"
+#include "imx_test_status.h"
+#include "imx8ulp_memmap.h"
 #include "hw/core/split-irq.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "chardev/char-fe.h"
+#include "chardev/char-serial.h"
+#include "qemu/notify.h"
+#include "qapi/visitor.h"
+#include "qemu/timer.h"
+#include "disas/disas.h"
+#include "crypto/hash.h"
+#include "crypto/cipher.h"
 #include "migration/vmstate.h"
+#include "block/thread-pool.h"
 
 /*=======================================
     Verilog debug module
  ========================================*/
 #define TYPE_VERILOG_DEBUG "verilog_debug"
 #define VERILOG_PRINT       0x41
+#define VERILOG_FOPEN       0x42
+#define VERILOG_FREAD       0x43
+#define VERILOG_FWRITE      0x44
+#define VERILOG_FCLOSE      0x45
+#define VERILOG_EXIT        0x46
+
+/*
+ * VERILOG_EXIT takes the status word from imx_test_status.h.  With
+ * TEST_STATUS_DEFER the code is only recorded and used when the ROM
+ * issues AHAB_RESET.
+ */
+#define TEST_STATUS_DEFER   (1 << 15)
+
+/* Third write of a file command: complete in the background */
+#define VERILOG_ASYNC       0x1
+
+#define VERILOG_MAX_FILES   16
 
 typedef struct {
     SysBusDevice parent_obj;
@@ -35,6 +70,12 @@ typedef struct {
     uint32_t reg1;
     uint32_t reg2;
     uint32_t reg3;
+
+    char *dir;                      /* sandbox for the file commands */
+    int dirfd;
+    int fds[VERILOG_MAX_FILES];
+    uint32_t pending[VERILOG_MAX_FILES];    /* async I/O in flight per fd */
+    uint32_t inflight;                      /* and in total */
 } verilog_debug_state;
 
 #define VERILOG_DEBUG(obj) \
@@ -58,6 +99,33 @@ typedef struct {
     OBJECT_CHECK(imx_fsb_state, (obj), TYPE_IMX_FSB)
 
 extern void imx_fsb_init_cb(imx_fsb_state *fsb);
+extern void imx_fsb_reload_word(imx_fsb_state *fsb, uint32_t fuse_word,
+        uint32_t value);
+
+/*=======================================
+    OCOTP Module Start
+ ========================================*/
+#define TYPE_IMX_OCOTP "imx_ocotp"
+#define IMX_FUSE_WORDS      512
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    imx_fsb_state *fsb;
+    char *file;
+
+    uint32_t *fuse;                 /* the file, or g_imx8ulp_arg.fuse */
+    uint32_t num_fuse;              /* IMX_FUSE_WORDS, for the vmstate */
+    unsigned long *dirty;           /* programmed since reload */
+    int32_t dirty_bits;
+    uint32_t ctrl;
+    uint32_t timing;
+    uint32_t read_data;
+} imx_ocotp_state;
+
+#define IMX_OCOTP(obj) \
+    OBJECT_CHECK(imx_ocotp_state, (obj), TYPE_IMX_OCOTP)
 
 /*=======================================
     S400 MU Start
@@ -87,6 +155,10 @@ typedef struct {
     uint32_t reserved4[14];     //< 288h - 2BCh
     uint32_t mu_attr;           //< 2C0h S4MUA Master Attributes register
 
+    /* Container between AUTH_CONTAINER and RELEASE_CONTAINER */
+    uint8_t *container;
+    uint32_t container_len;
+    uint32_t auth_status;       //< AUTH_CONTAINER status, 0 if none
 } imx_s400_mu_state;
 
 
@@ -138,6 +210,561 @@ typedef struct {
     OBJECT_CHECK(imx_tstmr_state, (obj), TYPE_IMX_TSTMR)
 
 
+/*=======================================
+    LPUART Module Start
+ ========================================*/
+#define TYPE_IMX_LPUART "imx_lpuart"
+#define IMX_LPUART_FIFO_MAX 128
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    qemu_irq irq;
+    MemoryRegion iomem;
+    CharBackend chr;
+    QEMUBH *tx_bh;
+    guint watch_tag;
+    Notifier clk_notifier;
+    Notifier exit_notifier;
+    uint32_t clk_freq;
+
+    uint32_t txfifo_depth;
+    uint32_t rxfifo_depth;
+
+    uint32_t global;            /* 08h: LPUART Global Register */
+    uint32_t pincfg;            /* 0Ch: LPUART Pin Configuration Register */
+    uint32_t baud;              /* 10h: LPUART Baud Rate Register */
+    uint32_t stat;              /* 14h: LPUART Status Register */
+    uint32_t ctrl;              /* 18h: LPUART Control Register */
+    uint32_t match;             /* 20h: LPUART Match Address Register */
+    uint32_t modir;             /* 24h: LPUART Modem IrDA Register */
+    uint32_t fifo;              /* 28h: LPUART FIFO Register */
+    uint32_t water;             /* 2Ch: LPUART Watermark Register */
+
+    /*
+     * Bytes written by the guest are collected here and handed to the
+     * chardev in one go, either when the FIFO fills or from a bottom
+     * half once the vCPU leaves the MMIO path.  They only become guest
+     * visible in WATER.TXCOUNT while the backend is applying backpressure.
+     */
+    uint8_t tx_fifo[IMX_LPUART_FIFO_MAX];
+    uint32_t tx_head;
+    uint32_t tx_count;
+    uint8_t rx_fifo[IMX_LPUART_FIFO_MAX];
+    uint32_t rx_head;
+    uint32_t rx_count;
+} imx_lpuart_state;
+
+#define IMX_LPUART(obj) \
+    OBJECT_CHECK(imx_lpuart_state, (obj), TYPE_IMX_LPUART)
+
+/*=======================================
+    FlexSPI Module Start
+ ========================================*/
+#define TYPE_IMX_FLEXSPI "imx_flexspi"
+#define IMX_FLEXSPI_LUT_NUM     128
+#define IMX_FLEXSPI_FIFO_WORDS  32
+#define IMX_FLEXSPI_DATA_MAX    0x10000
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    qemu_irq irq;
+    MemoryRegion iomem;
+    MemoryRegion xip;           /* AHB window, ROM device in ROMD mode */
+
+    char *image;
+    uint32_t flash_size;
+    uint64_t xip_base;
+    uint32_t jedec_id;
+    uint8_t *storage;
+    int image_fd;               /* writable image, written through */
+
+    uint32_t reg[64];           /* 000h - 0FCh: control and status */
+    uint32_t lut[IMX_FLEXSPI_LUT_NUM];  /* 200h - 3FCh: LUT */
+    uint32_t tfdr[IMX_FLEXSPI_FIFO_WORDS];
+
+    /* IP command data, moved to and from the array in one copy */
+    uint8_t rx_buf[IMX_FLEXSPI_DATA_MAX];
+    uint32_t rx_len;
+    uint32_t rx_pos;
+    uint8_t tx_buf[IMX_FLEXSPI_DATA_MAX];
+    uint32_t tx_len;
+
+    /* IP command waiting for its TX data */
+    uint8_t pend_opcode;
+    uint32_t pend_addr;
+    uint32_t pend_size;
+
+    uint8_t nor_sr;
+} imx_flexspi_state;
+
+#define IMX_FLEXSPI(obj) \
+    OBJECT_CHECK(imx_flexspi_state, (obj), TYPE_IMX_FLEXSPI)
+
+/*=======================================
+    CGC / PCC Module Start
+ ========================================*/
+#define TYPE_IMX_CGC "imx_cgc"
+#define TYPE_IMX_PCC "imx_pcc"
+
+/* CGC clock nodes, in topological order: parents come before children */
+enum {
+    IMX_CGC_SOSC,
+    IMX_CGC_FRO,
+    IMX_CGC_LPOSC,
+    IMX_CGC_PLL0,
+    IMX_CGC_PLL1,
+    IMX_CGC_SOSC_DIV1,
+    IMX_CGC_SOSC_DIV2,
+    IMX_CGC_SOSC_DIV3,
+    IMX_CGC_FRO_DIV1,
+    IMX_CGC_FRO_DIV2,
+    IMX_CGC_FRO_DIV3,
+    IMX_CGC_PLL1_VCODIV,
+    IMX_CGC_CM33_SEL,
+    IMX_CGC_CORE,
+    IMX_CGC_BUS,
+    IMX_CGC_SLOW,
+    IMX_CGC_CLK_NUM,
+};
+
+#define IMX_CGC_REG_NUM     (0x700 / 4)
+#define IMX_PCC_SLOT_NUM    128
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+
+    uint32_t sosc_freq;
+    uint32_t reg[IMX_CGC_REG_NUM];
+    uint32_t freq[IMX_CGC_CLK_NUM];
+    NotifierList notifiers[IMX_CGC_CLK_NUM];
+} imx_cgc_state;
+
+#define IMX_CGC(obj) \
+    OBJECT_CHECK(imx_cgc_state, (obj), TYPE_IMX_CGC)
+
+typedef struct imx_pcc_state imx_pcc_state;
+
+typedef struct {
+    Notifier n;
+    imx_pcc_state *pcc;
+    uint32_t pcs;
+} imx_pcc_src_notifier;
+
+struct imx_pcc_state {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    imx_cgc_state *cgc;
+
+    imx_pcc_src_notifier src_notifier[8];
+    uint32_t slot[IMX_PCC_SLOT_NUM];
+    uint32_t freq[IMX_PCC_SLOT_NUM];
+    NotifierList notifiers[IMX_PCC_SLOT_NUM];
+};
+
+#define IMX_PCC(obj) \
+    OBJECT_CHECK(imx_pcc_state, (obj), TYPE_IMX_PCC)
+
+/* PCC0 slot offsets of the peripherals we model */
+#define IMX_PCC0_LPIT0      0x6C
+#define IMX_PCC0_FLEXSPI0   0x84
+#define IMX_PCC0_LPUART0    0xA8
+#define IMX_PCC0_LPUART1    0xAC
+#define IMX_PCC0_LPUART2    0xB0
+#define IMX_PCC0_LPUART3    0xB4
+
+/* Attach a consumer to a CGC node, called like imx_pcc_connect_clock() */
+extern void imx_cgc_connect_clock(imx_cgc_state *cgc, int clk, Notifier *n);
+
+/*
+ * Attach a consumer to a PCC slot.  The notifier is called with a
+ * pointer to the new frequency in Hz (0 when gated) straight away and
+ * then whenever the slot's frequency changes.
+ */
+extern void imx_pcc_connect_clock(imx_pcc_state *pcc, uint32_t offset,
+                                  Notifier *n);
+extern uint32_t imx_pcc_get_freq(imx_pcc_state *pcc, uint32_t offset);
+
+/*=======================================
+    ROMCP Module Start
+ ========================================*/
+#define TYPE_IMX_ROMCP "imx_romcp"
+#define IMX_ROMCP_NUM_ADDR  16
+#define IMX_ROMCP_NUM_DATA  8
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    uint64_t rom_base;
+    uint32_t rom_size;
+
+    uint32_t data[IMX_ROMCP_NUM_DATA];  /* D4h - F0h: ROMC_DATA7 .. DATA0 */
+    uint32_t cntl;                      /* F4h: ROMC Control Register */
+    uint32_t enl;                       /* FCh: ROMC Enable Register Low */
+    uint32_t addr[IMX_ROMCP_NUM_ADDR];  /* 100h - 13Ch: ROMC_ADDR0 .. 15 */
+    uint32_t sr;                        /* 208h: ROMC Status Register */
+
+    /* Patches currently written into the ROM and the words they hide */
+    uint32_t applied[IMX_ROMCP_NUM_ADDR];
+    uint32_t applied_addr[IMX_ROMCP_NUM_ADDR];
+    uint32_t applied_val[IMX_ROMCP_NUM_ADDR];
+    uint32_t shadow[IMX_ROMCP_NUM_ADDR];
+} imx_romcp_state;
+
+#define IMX_ROMCP(obj) \
+    OBJECT_CHECK(imx_romcp_state, (obj), TYPE_IMX_ROMCP)
+
+/*=======================================
+    TRDC Module Start
+ ========================================*/
+#define TYPE_IMX_TRDC "imx_trdc"
+#define TYPE_IMX_TRDC_IOMMU_MEMORY_REGION "imx-trdc-iommu-memory-region"
+
+#define IMX_TRDC_NUM_DOMAINS    16
+#define IMX_TRDC_NUM_GLBAC      8
+#define IMX_TRDC_BLK_SHIFT      16      /* 64K blocks */
+#define IMX_TRDC_MAX_BLOCKS     256
+#define IMX_TRDC_NUM_IDX        4       /* secure << 1 | user */
+
+/* Precomputed access, one byte per block */
+#define IMX_TRDC_PERM_R         (1 << 0)
+#define IMX_TRDC_PERM_W         (1 << 1)
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    IOMMUMemoryRegion upstream;
+    MemoryRegion *downstream;
+    AddressSpace downstream_as;
+    MemoryRegion readonly_io;
+    AddressSpace readonly_as;
+    MemoryRegion blocked_io;
+    AddressSpace blocked_as;
+    uint32_t num_blocks;
+
+    uint32_t cr;                                /* 000h: TRDC_CR */
+    uint32_t mda;                               /* 800h: MDA_W0_0 for CM33 */
+    uint32_t glbac[IMX_TRDC_NUM_GLBAC];         /* 10000h: MBC0_MEMN_GLBAC */
+    uint32_t blk_cfg[IMX_TRDC_NUM_DOMAINS][IMX_TRDC_MAX_BLOCKS / 8];
+
+    /* Access of the CM33's current domain, rebuilt on config writes */
+    uint8_t perm[IMX_TRDC_NUM_IDX][IMX_TRDC_MAX_BLOCKS];
+} imx_trdc_state;
+
+#define IMX_TRDC(obj) \
+    OBJECT_CHECK(imx_trdc_state, (obj), TYPE_IMX_TRDC)
+
+/*=======================================
+    eDMA Module Start
+ ========================================*/
+#define TYPE_IMX_EDMA "imx_edma"
+
+#define IMX_EDMA_NUM_CH         16
+#define IMX_EDMA_CH_STRIDE      0x1000
+#define IMX_EDMA_TCD_SIZE       32
+
+typedef struct {
+    uint32_t csr;                   /* 00h: CHn_CSR */
+    uint32_t es;                    /* 04h: CHn_ES */
+    uint32_t intr;                  /* 08h: CHn_INT */
+    uint32_t sbr;                   /* 0Ch: CHn_SBR */
+    uint32_t pri;                   /* 10h: CHn_PRI */
+    uint8_t tcd[IMX_EDMA_TCD_SIZE]; /* 20h - 3Fh: TCDn, little endian */
+} imx_edma_chan;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    qemu_irq irq[IMX_EDMA_NUM_CH];
+    qemu_irq err_irq;
+
+    /* Per-beat path through the MSC, and what the MSC checks against */
+    MemoryRegion *downstream;
+    AddressSpace downstream_as;
+    TZMSC *msc;
+    Object *idau;
+
+    uint32_t csr;                   /* 00h: MP_CSR */
+    uint32_t es;                    /* 04h: MP_ES */
+    uint32_t pending;               /* channels with a service request */
+    bool running;
+    imx_edma_chan ch[IMX_EDMA_NUM_CH];
+} imx_edma_state;
+
+#define IMX_EDMA(obj) \
+    OBJECT_CHECK(imx_edma_state, (obj), TYPE_IMX_EDMA)
+
+/*=======================================
+    CMC Module Start
+ ========================================*/
+#define TYPE_IMX_CMC "imx_cmc"
+
+#define IMX_CMC_SIZE            0x1000
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    uint32_t mr0_reset;             /* boot config latched from the pins */
+    bool cold;                      /* next reset is a power-on reset */
+
+    /*
+     * Offsets without a model below read back what was written, as the
+     * ROM uses some of them as scratch.
+     */
+    uint32_t reg[IMX_CMC_SIZE / 4];
+} imx_cmc_state;
+
+#define IMX_CMC(obj) \
+    OBJECT_CHECK(imx_cmc_state, (obj), TYPE_IMX_CMC)
+
+extern void imx_cmc_core_sleep(imx_cmc_state *s, bool deep);
+
+/*=======================================
+    uPower Module Start
+ ========================================*/
+#define TYPE_IMX_UPOWER "imx_upower"
+
+#define IMX_UPOWER_NUM_TR       4
+#define IMX_UPOWER_NUM_RR       4
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    qemu_irq irq;
+    QEMUTimer *timer;
+    uint32_t delay_ns;              /* virtual time a request takes */
+
+    /* MU side */
+    uint32_t cr;                    /* 08h: CR */
+    uint32_t rcr;                   /* 128h: RCR, receive interrupt enables */
+    uint32_t rsr;                   /* 12Ch: RSR, response words pending */
+    uint32_t tr[IMX_UPOWER_NUM_TR]; /* 200h: TR */
+    uint32_t rr[IMX_UPOWER_NUM_RR]; /* 280h: RR */
+
+    /* uPower side */
+    bool busy;
+    uint32_t req[IMX_UPOWER_NUM_TR];    /* request being executed */
+    uint32_t switches;              /* power switches that are on */
+    uint32_t retention;             /* memories kept in retention */
+} imx_upower_state;
+
+#define IMX_UPOWER(obj) \
+    OBJECT_CHECK(imx_upower_state, (obj), TYPE_IMX_UPOWER)
+
+/*=======================================
+    Co-simulation Bridge Module Start
+ ========================================*/
+#define TYPE_IMX_COSIM "imx_cosim"
+
+#define IMX_COSIM_MAGIC         0x4d49534f43383849ULL   /* "I88COSIM" */
+#define IMX_COSIM_VERSION       1
+#define IMX_COSIM_RING          256     /* entries, power of two */
+#define IMX_COSIM_NUM_IRQ       8
+
+#define IMX_COSIM_REQ_READ      0
+#define IMX_COSIM_REQ_WRITE     1
+#define IMX_COSIM_REQ_SYNC      2
+
+/*
+ * Layout of the shared file.  The emulator produces req[] and consumes
+ * rsp[], the simulator does the opposite; each index is only written
+ * by one side and sits in its own cache line.  READ and SYNC requests
+ * get a response, in request order; WRITEs are posted.
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t size;              /* 1, 2 or 4 */
+    uint32_t addr;              /* offset in the window */
+    uint32_t data;
+    uint64_t time_ns;           /* SYNC: simulator may run up to here */
+} imx_cosim_req;
+
+typedef struct {
+    uint32_t type;
+    uint32_t data;              /* READ: value */
+    uint64_t cycles;            /* simulator cycle count when answered */
+} imx_cosim_rsp;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t ring_size;
+    uint64_t req_head QEMU_ALIGNED(64);     /* emulator */
+    uint64_t req_tail QEMU_ALIGNED(64);     /* simulator */
+    uint64_t rsp_head QEMU_ALIGNED(64);     /* simulator */
+    uint64_t rsp_tail QEMU_ALIGNED(64);     /* emulator */
+    uint32_t irq QEMU_ALIGNED(64);          /* simulator: IRQ line levels */
+    imx_cosim_req req[IMX_COSIM_RING] QEMU_ALIGNED(64);
+    imx_cosim_rsp rsp[IMX_COSIM_RING];
+} imx_cosim_shm;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    qemu_irq irq[IMX_COSIM_NUM_IRQ];
+    QEMUTimer *timer;
+    QEMUTimer *poll_timer;      /* host time: flush writes, sample IRQs */
+
+    char *path;
+    uint64_t size;
+    uint32_t quantum_ns;
+    uint32_t batch;             /* posted writes published together */
+    uint32_t poll_us;
+
+    imx_cosim_shm *shm;
+    uint64_t req_head;          /* local, published as shm->req_head */
+    uint32_t posted;            /* writes queued but not yet published */
+    uint32_t syncs;             /* SYNCs without a response yet */
+    uint32_t irq_level;
+    uint64_t cycles;
+    bool dead;
+} imx_cosim_state;
+
+#define IMX_COSIM(obj) \
+    OBJECT_CHECK(imx_cosim_state, (obj), TYPE_IMX_COSIM)
+
+/*=======================================
+    MU Module Start
+ ========================================*/
+#define TYPE_IMX_MU "imx_mu"
+#define IMX_MU_NUM_REG  4
+
+/* One side of a messaging unit; side A is the M33, side B the A35 */
+typedef struct {
+    uint32_t cr;
+    uint32_t fcr;                   /* 100h: flags shown to the other side */
+    uint32_t gier;                  /* 110h */
+    uint32_t gsr;                   /* 118h: general purpose requests */
+    uint32_t tcr;                   /* 120h */
+    uint32_t tsr;                   /* 124h: TR words the peer has read */
+    uint32_t rcr;                   /* 128h */
+    uint32_t rsr;                   /* 12Ch: RR words not yet read */
+    uint32_t rr[IMX_MU_NUM_REG];    /* 280h */
+} imx_mu_side;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem[2];
+    qemu_irq irq[2];
+    imx_mu_side side[2];
+} imx_mu_state;
+
+#define IMX_MU(obj) \
+    OBJECT_CHECK(imx_mu_state, (obj), TYPE_IMX_MU)
+
+/*=======================================
+    LPIT Module Start
+ ========================================*/
+#define TYPE_IMX_LPIT "imx_lpit"
+#define IMX_LPIT_NUM_CHAN   4
+
+typedef struct {
+    uint32_t tval;
+    uint32_t tctrl;
+    bool running;
+    uint32_t cnt;           /* counter when stopped, gated or chained */
+
+    /* Unchained and running: the counter is derived from virtual time */
+    int64_t start_ns;
+    uint32_t start_cnt;
+    uint64_t done;          /* expirations already handled */
+} imx_lpit_chan;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    qemu_irq irq;
+    qemu_irq trigger[IMX_LPIT_NUM_CHAN];
+    QEMUTimer *timer;
+    Notifier clk_notifier;
+    uint32_t freq;
+
+    uint32_t mcr;
+    uint32_t msr;
+    uint32_t mier;
+    imx_lpit_chan chan[IMX_LPIT_NUM_CHAN];
+} imx_lpit_state;
+
+#define IMX_LPIT(obj) \
+    OBJECT_CHECK(imx_lpit_state, (obj), TYPE_IMX_LPIT)
+
+/*=======================================
+    Crypto Engine Module Start
+ ========================================*/
+#define TYPE_IMX_CRYPTO "imx_crypto"
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    qemu_irq irq;
+
+    /* Bus path through the MSC, as for the eDMA */
+    MemoryRegion *downstream;
+    AddressSpace downstream_as;
+    TZMSC *msc;
+    Object *idau;
+    MemTxAttrs attrs;               /* of the last HEAD write */
+
+    uint32_t ctrl;
+    uint32_t ring_base;             /* job descriptors, 32 bytes each */
+    uint32_t ring_size;             /* entries, power of two */
+    uint32_t head;                  /* jobs queued by the guest */
+    uint32_t tail;                  /* jobs completed */
+    uint32_t status;
+    uint32_t irq_en;
+
+    /* Throughput counters */
+    uint32_t jobs;
+    uint64_t bytes;
+    uint64_t host_ns;               /* host time spent running jobs */
+    uint32_t hi;                    /* latched high word of a 64-bit read */
+
+    /* One batch of jobs runs in the thread pool at a time */
+    bool busy;
+    uint32_t gen;                   /* bumped by reset, stale batches drop */
+
+    /* Key schedule of the last job, only used by the worker */
+    QCryptoCipher *cipher;
+    uint32_t cipher_cmd;
+    uint8_t cipher_key[32];
+} imx_crypto_state;
+
+#define IMX_CRYPTO(obj) \
+    OBJECT_CHECK(imx_crypto_state, (obj), TYPE_IMX_CRYPTO)
+
+/*=======================================
+    Profiler Module Start
+ ========================================*/
+#define IMX_PROF_MAX_DEPTH      32
+#define IMX_PROF_SCAN_WORDS     256
+#define IMX_PROF_DEFAULT_NS     100000
+
+typedef struct {
+    CPUState *cpu;
+    QEMUTimer *timer;
+    uint64_t interval_ns;
+    char *out;
+    GHashTable *stacks;     /* folded stack -> sample count */
+    uint64_t samples;
+    Notifier exit;
+} imx_prof_state;
+
+extern void imx_prof_start(imx_prof_state *p, CPUState *cpu, const char *out,
+        uint64_t interval_ns);
+
 /*=======================================
     ARG Module Start
  ========================================*/
@@ -167,10 +794,47 @@ extern imx8ulp_arg_t g_imx8ulp_arg;
 #define IMX_SIM0_S_START    0x3802B000
 #define IMX_TSTMR_START     0x3802AC00
 #define IMX_CMC0_START   0x38025000
+#define IMX_OCOTP_START     0x38026000
+#define IMX_LPUART0_START   0x38032000
+#define IMX_LPUART1_START   0x38033000
+#define IMX_LPUART2_START   0x38034000
+#define IMX_LPUART3_START   0x38035000
+#define IMX_LPUART_IRQ_BASE 56
+#define IMX_FLEXSPI0_START  0x38039000
+#define IMX_FLEXSPI0_AMBA   0x04000000
+#define IMX_FLEXSPI0_IRQ    60
+#define IMX_TRDC_START      0x38100000
+#define IMX_EDMA0_START     0x38000000
+#define IMX_EDMA0_SIZE      0x11000
+#define IMX_EDMA0_IRQ_BASE  61
+#define IMX_EDMA0_ERR_IRQ   77
+#define IMX_UPOWER_START    0x28350000
+#define IMX_UPOWER_IRQ      78
+#define IMX_COSIM_START     0x40208000
+#define IMX_COSIM_IRQ_BASE  79
+#define IMX_MU0_START       0x38220000
+#define IMX_MU0_IRQ         87
+#define VERILOG_DEBUG_IRQ   88
+#define IMX_LPIT0_START     0x3802E000
+#define IMX_LPIT0_IRQ       89
+#define IMX_CRYPTO_START    0x38120000
+#define IMX_CRYPTO_IRQ      90
+
+/* Cortex-A35 domain, own address space */
+#define IMX_A35_NUM_CPUS    2
+#define IMX_A35_SSRAM_START 0x20000000
+#define IMX_A35_MU0_START   0x29220000
+#define IMX_A35_CMC1_START  0x29240000
+#define IMX_A35_GICD_START  0x2D400000
+#define IMX_A35_GICR_START  0x2D440000
+#define IMX_A35_DRAM_START  0x80000000
+#define IMX_A35_NUM_SPI     224
+#define IMX_A35_MU0_SPI     99
 
 typedef struct {
     MachineClass parent;
     const char *armsse_type;
+    int num_a35;
 } IMX8ULP_MachineClass;
 
 typedef struct {
@@ -178,32 +842,63 @@ typedef struct {
 
     ARMSSE iotkit;
     MemoryRegion psram;
-    MemoryRegion ssram[3];
+    MemoryRegion ssram[IMX_SSRAM_NUM];
     MemoryRegion ssram1_m;
-    MemoryRegion cmc0;
+    imx_cmc_state cmc0;
+    imx_ocotp_state ocotp;
     MemoryRegion fsb_low;
     MemoryRegion tstmr0;
 
     TZPPC ppc[5];
-    TZMPC ssram_mpc[3];
+    TZMPC ssram_mpc[IMX_SSRAM_NUM];
     PL022State spi[5];
+    imx_flexspi_state flexspi0;
     UnimplementedDeviceState i2c[4];
 
-    UnimplementedDeviceState cgc0;
-    UnimplementedDeviceState pcc0;
-    UnimplementedDeviceState pcc1;
-    UnimplementedDeviceState romcp0;
-    UnimplementedDeviceState upower;
+    imx_cgc_state cgc0;
+    imx_pcc_state pcc[2];
+    imx_romcp_state romcp0;
+    imx_trdc_state trdc;
+    imx_edma_state edma0;
+    imx_upower_state upower;
+    imx_cosim_state cosim;
+    imx_mu_state mu0;
+    imx_lpit_state lpit0;
+    imx_crypto_state crypto;
+
+    /* Cortex-A35 domain, imx8ulp-dual only */
+    ARMCPU *a35[IMX_A35_NUM_CPUS];
+    MemoryRegion a35_mem;
+    AddressSpace a35_as;
+    MemoryRegion a35_ssram;
+    MemoryRegion a35_dram;
+    DeviceState *a35_gic;
+    imx_cmc_state cmc1;
 
     TZMSC msc[4];
-    CMSDKAPBUART uart[5];
+    imx_lpuart_state uart[4];
     SplitIRQ sec_resp_splitter;
-    qemu_or_irq uart_irq_orgate;
     SplitIRQ cpu_irq_splitter[IMX8ULP_M33_NUMIRQ];
+    qemu_irq sse_irq[IMX8ULP_M33_NUMIRQ];  /* NVIC expansion inputs */
+    qemu_irq *exp_irq;                      /* the same, via the CMC0 hook */
+
+    char *flexspi_image;
+    char *rom_image;
+    char *a35_image;
+    char *vdebug_dir;
+    char *fuse_file;
+    char *cosim_path;
+    uint64_t cosim_base;
+    uint64_t cosim_size;
+    char *profile;
+    uint64_t profile_interval;
+    imx_prof_state prof;
+    Notifier core_clk_notifier;         /* CGC core clock -> SysTick */
 } IMX8ULP_M33_MachineState;
 
 #define TYPE_IMX8ULP_MACHINE "imx8ulp"
 #define TYPE_IMX8ULP_M33_MACHINE MACHINE_TYPE_NAME("imx8ulp-m33")
+#define TYPE_IMX8ULP_DUAL_MACHINE MACHINE_TYPE_NAME("imx8ulp-dual")
 
 #define IMX8ULP_MACHINE(obj) \
     OBJECT_CHECK(IMX8ULP_M33_MachineState, obj, TYPE_IMX8ULP_MACHINE)
@@ -0,0 +1,39 @@
+/*
+ * Memories of the imx8ulp-m33 machine, shared by the board and the
+ * imx8ulp TCG plugins so both see the same bases and sizes.
+ *
+ * imx_ssram_map[] is indexed like mms->ssram[]: make_mpc() creates each
+ * entry behind ssram_mpc[i].
+ */
+#ifndef IMX8ULP_MEMMAP_H
+#define IMX8ULP_MEMMAP_H
+
+#include <stdint.h>
+
+#define IMX_ROM_START       0x10000000
+#define IMX_ROM_SIZE        0x00030000
+#define IMX_SSRAM_START     0x30000000
+#define IMX_SSRAM_SIZE      0x00080000
+#define IMX_TCM_START       0x1ffc0000
+#define IMX_TCM_SIZE        0x00040000
+#define IMX_PSRAM_START     0x80000000
+#define IMX_PSRAM_SIZE      0x01000000
+
+#define IMX_SSRAM_ROM       0
+#define IMX_SSRAM_SYS       1
+#define IMX_SSRAM_TCM       2
+#define IMX_SSRAM_NUM       3
+
+typedef struct {
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+} imx_mem_region;
+
+static const imx_mem_region imx_ssram_map[IMX_SSRAM_NUM] = {
+    [IMX_SSRAM_ROM] = { "rom",   IMX_ROM_START,   IMX_ROM_SIZE },
+    [IMX_SSRAM_SYS] = { "ssram", IMX_SSRAM_START, IMX_SSRAM_SIZE },
+    [IMX_SSRAM_TCM] = { "tcm",   IMX_TCM_START,   IMX_TCM_SIZE },
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Minimal ELF32 symbol table reader for the imx8ulp TCG plugins.
+ *
+ * Plugins only see the public plugin API, so they cannot use the
+ * symbols QEMU itself loaded from -kernel.  Pass the same ELF to the
+ * plugin with elf=<file> and look addresses up here.
+ */
+#ifndef IMX8ULP_PLUGIN_ELF_H
+#define IMX8ULP_PLUGIN_ELF_H
+
+#include <elf.h>
+#include <glib.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    char *name;
+    int type;               /* STT_FUNC or STT_OBJECT */
+} imx_elf_sym;
+
+typedef struct {
+    char *path;
+    imx_elf_sym *syms;
+    size_t nsyms;
+} imx_elf_symtab;
+
+static inline gint imx_elf_sym_cmp(gconstpointer a, gconstpointer b)
+{
+    const imx_elf_sym *sa = a, *sb = b;
+
+    return sa->addr < sb->addr ? -1 : sa->addr > sb->addr;
+}
+
+/*
+ * Collect STT_FUNC symbols, and STT_OBJECT ones too with objects set,
+ * with the Thumb bit stripped, sorted by address.
+ */
+static inline bool imx_elf_load_symbols(imx_elf_symtab *tab,
+                                        const char *path, bool objects)
+{
+    gchar *buf;
+    gsize len;
+    const Elf32_Ehdr *eh;
+    const Elf32_Shdr *sh;
+    GArray *syms;
+    int i;
+
+    memset(tab, 0, sizeof(*tab));
+    if (!g_file_get_contents(path, &buf, &len, NULL)) {
+        return false;
+    }
+    eh = (const Elf32_Ehdr *)buf;
+    if (len < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) ||
+        eh->e_ident[EI_CLASS] != ELFCLASS32 ||
+        eh->e_ident[EI_DATA] != ELFDATA2LSB ||
+        eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(*sh) > len) {
+        g_free(buf);
+        return false;
+    }
+
+    sh = (const Elf32_Shdr *)(buf + eh->e_shoff);
+    syms = g_array_new(false, false, sizeof(imx_elf_sym));
+    for (i = 0; i < eh->e_shnum; i++) {
+        const Elf32_Sym *sym;
+        const char *strtab;
+        size_t n, j;
+
+        if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum ||
+            sh[i].sh_offset + (uint64_t)sh[i].sh_size > len ||
+            sh[sh[i].sh_link].sh_offset +
+            (uint64_t)sh[sh[i].sh_link].sh_size > len) {
+            continue;
+        }
+        sym = (const Elf32_Sym *)(buf + sh[i].sh_offset);
+        n = sh[i].sh_size / sizeof(*sym);
+        strtab = buf + sh[sh[i].sh_link].sh_offset;
+
+        for (j = 0; j < n; j++) {
+            int type = ELF32_ST_TYPE(sym[j].st_info);
+            imx_elf_sym s;
+
+            if ((type != STT_FUNC && (!objects || type != STT_OBJECT)) ||
+                sym[j].st_shndx == SHN_UNDEF ||
+                sym[j].st_name >= sh[sh[i].sh_link].sh_size) {
+                continue;
+            }
+            s.addr = type == STT_FUNC ? sym[j].st_value & ~1u
+                                      : sym[j].st_value;
+            s.type = type;
+            s.size = sym[j].st_size;
+            s.name = g_strndup(strtab + sym[j].st_name,
+                               sh[sh[i].sh_link].sh_size - sym[j].st_name);
+            g_array_append_val(syms, s);
+        }
+    }
+    g_free(buf);
+
+    g_array_sort(syms, imx_elf_sym_cmp);
+    tab->path = g_strdup(path);
+    tab->nsyms = syms->len;
+    tab->syms = (imx_elf_sym *)g_array_free(syms, false);
+    return true;
+}
+
+static inline bool imx_elf_load_symtab(imx_elf_symtab *tab, const char *path)
+{
+    return imx_elf_load_symbols(tab, path, false);
+}
+
+/* The symbol containing addr; symbols without a size extend to the next */
+static inline const imx_elf_sym *imx_elf_lookup(const imx_elf_symtab *tab,
+                                                uint64_t addr)
+{
+    size_t lo = 0, hi = tab->nsyms;
+    const imx_elf_sym *s;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (tab->syms[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return NULL;
+    }
+    s = &tab->syms[lo - 1];
+    if (s->size && addr >= s->addr + s->size) {
+        return NULL;
+    }
+    return s;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Test status word shared by the imx8ulp verilog_debug exit and the
+ * mysoc test_ip STATUS register: TEST_STATUS_MAGIC in [31:16], the
+ * process exit code in [7:0] (0 pass).
+ *
+ * The guest may also point at a counter table to print first,
+ *
+ *   struct { uint32_t n; uint32_t value[n]; }
+ *
+ * exit() still runs the exit notifiers, so profilers are written out
+ * and the LPUARTs send what is left in their TX FIFOs before the
+ * process goes.
+ */
+#ifndef IMX_TEST_STATUS_H
+#define IMX_TEST_STATUS_H
+
+#include "exec/cpu-common.h"
+#include "qemu/timer.h"
+
+#define TEST_STATUS_MAGIC   0x7E57
+#define TEST_MAX_COUNTERS   64
+
+static inline void imx_test_status_exit(int code, hwaddr counters)
+{
+    uint32_t n = 0, value, i;
+
+    if (counters) {
+        cpu_physical_memory_read(counters, &n, 4);
+        n = MIN(n, TEST_MAX_COUNTERS);
+    }
+    for (i = 0; i < n; i++) {
+        cpu_physical_memory_read(counters + 4 + i * 4, &value, 4);
+        fprintf(stderr, "test counter %u: %u\n", i, value);
+    }
+    fprintf(stderr, "test %s, exit code %d, virtual time %" PRId64 " ns\n",
+            code ? "failed" : "passed", code,
+            qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    exit(code);
+}
+
+#endif
@@ -1,20 +1,36 @@
 #include "qemu/osdep.h"
+#include <sys/mman.h>
 #include "qapi/error.h"
+#include "qemu/error-report.h"
 #include "hw/arm/boot.h"
 #include "hw/boards.h"
 #include "qemu/log.h"
 #include "exec/address-spaces.h"
 #include "sysemu/sysemu.h"
+#include "sysemu/reset.h"
 #include "hw/arm/armv7m.h"
 #include "hw/char/pl011.h"
 #include "hw/irq.h"
+#include "hw/qdev-properties.h"
 #include "migration/vmstate.h"
+#include "qapi/visitor.h"
+#include "qemu/timer.h"
+#include "qemu/main-loop.h"
 #include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/ram_addr.h"
+#include "imx_test_status.h"
 
 #define TYPE_TEST_IP "my_test_ip"
+#define TYPE_MYSOC_MAILBOX "mysoc_mailbox"
+#define TYPE_MYSOC_FLASH "mysoc_flash"
+#define TYPE_MYSOC_BITBAND "mysoc_bitband"
+#define TYPE_MYSOC_MACHINE MACHINE_TYPE_NAME("mysoc_evb")
+#define TYPE_MYSOC_MP_MACHINE MACHINE_TYPE_NAME("mysoc_evb_mp")
 
 #define MY_SOC_FLASH_START  (0x0)
 #define MY_SOC_FLASH_SIZE   (4 * 1024 * 1024) //< 4M
+#define MY_SOC_FLASH_SECTOR (4 * 1024)        //< erase block
 
 #define MY_SOC_SRAM_START    (0x20000000)
 #define MY_SOC_SRAM_SIZE     (16 * 1024 * 1024) //<16M
@@ -23,9 +39,26 @@
 #define PL011_UART0_IRQn    (0)
 
 #define MY_TEST_IP_START    (0x40001000)
+#define MY_TEST_IP_IRQn     (2)
+
+#define MYSOC_MAILBOX_START (0x40002000)
+#define MYSOC_MAILBOX_IRQn  (1)
+
+#define MYSOC_FLASH_CTRL_START (0x40003000)
+
+#define MYSOC_SRAM_BB_ALIAS   (0x22000000)
+#define MYSOC_PERIPH_BB_BASE  (0x40000000)
+#define MYSOC_PERIPH_BB_ALIAS (0x42000000)
+#define MYSOC_BB_ALIAS_SIZE   (32 * 1024 * 1024)    //< covers 1M of bits
 
 #define NUM_IRQ_LINES 64
 
+/* mysoc_evb_mp: private SRAM per core, the rest of the 16M is shared */
+#define MYSOC_MP_MAX_CORES      16
+#define MYSOC_MP_PRIV_SRAM_SIZE (1 * 1024 * 1024) //< 1M, the bit-band range
+#define MYSOC_MP_SHARED_START   (MY_SOC_SRAM_START + MYSOC_MP_PRIV_SRAM_SIZE)
+#define MYSOC_MP_SHARED_SIZE    (MY_SOC_SRAM_SIZE - MYSOC_MP_PRIV_SRAM_SIZE)
+
 typedef struct {
     SysBusDevice parent_obj;
 
@@ -39,30 +72,157 @@ typedef struct {
     uint32_t id5;       //I
     uint32_t id6;       //P
     uint32_t test_reg;
+
+    /* Emulator benchmark registers, see my_test_ip_read() */
+    QEMUTimer *db_timer;
+    uint32_t db_delay;
+    uint32_t irq_pending;
+    uint32_t host_hi;
+    uint32_t virt_hi;
+    int64_t irq_time;
+    uint32_t counters;
 } my_test_ip_state;
 
 my_test_ip_state test_ip;
 
+typedef struct {
+    SysBusDevice parent_obj;
+
+    qemu_irq irq[MYSOC_MP_MAX_CORES];
+    MemoryRegion iomem;
+    uint32_t num_cores;
+    uint32_t data[MYSOC_MP_MAX_CORES];
+    uint32_t status[MYSOC_MP_MAX_CORES];
+    uint32_t doorbell[MYSOC_MP_MAX_CORES];
+} mysoc_mailbox_state;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion array;     //< romd: reads and fetches hit RAM, writes trap
+    MemoryRegion iomem;     //< controller registers
+    char *image;
+    uint32_t base;
+    uint32_t size;
+    uint32_t sector_size;
+    uint8_t *backing;       //< shared mapping of the image, or NULL
+    uint32_t key_state;
+    uint32_t sr;
+    uint32_t cr;
+    uint32_t ar;
+    int64_t dirty_start;    //< range not yet msync'd, within one block
+    int64_t dirty_end;
+} mysoc_flash_state;
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion iomem;
+    MemoryRegion *source_memory;
+    MemoryRegion *ram;      //< if set, RAM at base in source_memory
+    AddressSpace source_as;
+    uint32_t base;
+} mysoc_bitband_state;
+
+typedef struct {
+    MachineState parent;
+
+    char *flash_image;
+} MySocMachineState;
+
+#define MYSOC_MACHINE(obj) \
+    OBJECT_CHECK(MySocMachineState, (obj), TYPE_MYSOC_MACHINE)
+
+typedef struct {
+    MySocMachineState parent;
+
+    uint32_t num_cores;
+    DeviceState *armv7m[MYSOC_MP_MAX_CORES];
+    MemoryRegion core_mem[MYSOC_MP_MAX_CORES];
+    MemoryRegion core_sram[MYSOC_MP_MAX_CORES];
+    MemoryRegion core_shared[MYSOC_MP_MAX_CORES];
+} MySocMPMachineState;
+
+#define MYSOC_MP_MACHINE(obj) \
+    OBJECT_CHECK(MySocMPMachineState, (obj), TYPE_MYSOC_MP_MACHINE)
+
+/* CPUs are not on a bus, so cores booted without a kernel need this */
+static void mysoc_cpu_reset(void *opaque)
+{
+    cpu_reset(CPU(opaque));
+}
+
+/*
+ * Bit-band alias for the first 1M of source_memory at base.  Passing the
+ * RAM behind it lets the alias do its read-modify-write on host memory.
+ */
+static void mysoc_create_bitband(MemoryRegion *container, hwaddr alias,
+                                 MemoryRegion *source, hwaddr base,
+                                 MemoryRegion *ram)
+{
+    DeviceState *dev = qdev_create(NULL, TYPE_MYSOC_BITBAND);
+
+    qdev_prop_set_uint32(dev, "base", base);
+    object_property_set_link(OBJECT(dev), OBJECT(source), "source-memory",
+                             &error_abort);
+    if (ram) {
+        object_property_set_link(OBJECT(dev), OBJECT(ram), "ram",
+                                 &error_abort);
+    }
+    qdev_init_nofail(dev);
+    memory_region_add_subregion_overlap(container, alias,
+                                        sysbus_mmio_get_region(SYS_BUS_DEVICE(dev), 0),
+                                        1);
+}
+
+static void mysoc_create_flash(MySocMachineState *mms)
+{
+    DeviceState *dev = qdev_create(NULL, TYPE_MYSOC_FLASH);
+
+    qdev_prop_set_uint32(dev, "base", MY_SOC_FLASH_START);
+    qdev_prop_set_uint32(dev, "size", MY_SOC_FLASH_SIZE);
+    if (mms->flash_image) {
+        qdev_prop_set_string(dev, "image", mms->flash_image);
+    }
+    qdev_init_nofail(dev);
+    sysbus_mmio_map(SYS_BUS_DEVICE(dev), 0, MY_SOC_FLASH_START);
+    sysbus_mmio_map(SYS_BUS_DEVICE(dev), 1, MYSOC_FLASH_CTRL_START);
+}
+
+/*
+ * With -kernel the ELF is loaded over the flash on every reset, so
+ * anything the firmware programmed is lost.  With only flash-image the
+ * core boots from whatever the image holds.
+ */
+static void mysoc_boot(MachineState *ms, ARMCPU *cpu)
+{
+    if (ms->kernel_filename || !MYSOC_MACHINE(ms)->flash_image) {
+        armv7m_load_kernel(cpu, ms->kernel_filename, MY_SOC_FLASH_SIZE);
+    } else {
+        qemu_register_reset(mysoc_cpu_reset, cpu);
+    }
+}
+
 static void mysoc_init(MachineState *ms)
 {
     DeviceState *nvic;
 
     MemoryRegion *sram = g_new(MemoryRegion, 1);
-    MemoryRegion *flash = g_new(MemoryRegion, 1);
     MemoryRegion *system_memory = get_system_memory();
 
-    /* Flash programming is done via the SCU, so pretend it is ROM.  */
-    memory_region_init_ram(flash, NULL, "mysoc.flash", MY_SOC_FLASH_SIZE, &error_fatal);
-    memory_region_set_readonly(flash, true);
-    memory_region_add_subregion(system_memory, MY_SOC_FLASH_START, flash);
+    mysoc_create_flash(MYSOC_MACHINE(ms));
 
     memory_region_init_ram(sram, NULL, "mysoc.sram", MY_SOC_SRAM_SIZE, &error_fatal);
     memory_region_add_subregion(system_memory, MY_SOC_SRAM_START, sram);
 
+    /* Bit-band is done by the board, see mysoc_bitband below */
+    mysoc_create_bitband(system_memory, MYSOC_SRAM_BB_ALIAS, sram, 0, sram);
+    mysoc_create_bitband(system_memory, MYSOC_PERIPH_BB_ALIAS, system_memory,
+                         MYSOC_PERIPH_BB_BASE, NULL);
+
     nvic = qdev_create(NULL, TYPE_ARMV7M);
     qdev_prop_set_uint32(nvic, "num-irq", NUM_IRQ_LINES);
     qdev_prop_set_string(nvic, "cpu-type", ms->cpu_type);
-    qdev_prop_set_bit(nvic, "enable-bitband", true);
     object_property_set_link(OBJECT(nvic), OBJECT(get_system_memory()), "memory", &error_abort);
 
     /* This will exit with an error if the user passed us a bad cpu_type */
@@ -70,9 +230,33 @@ static void mysoc_init(MachineState *ms)
 
     pl011_luminary_create(PL011_UART0_START , qdev_get_gpio_in(nvic, PL011_UART0_IRQn), serial_hd(0));
 
-    sysbus_create_simple(TYPE_TEST_IP, MY_TEST_IP_START, NULL);
+    sysbus_create_simple(TYPE_TEST_IP, MY_TEST_IP_START, qdev_get_gpio_in(nvic, MY_TEST_IP_IRQn));
+
+    mysoc_boot(ms, ARM_CPU(first_cpu));
+}
+
+static char *mysoc_get_flash_image(Object *obj, Error **errp)
+{
+    MySocMachineState *mms = MYSOC_MACHINE(obj);
+
+    return g_strdup(mms->flash_image);
+}
+
+static void mysoc_set_flash_image(Object *obj, const char *value, Error **errp)
+{
+    MySocMachineState *mms = MYSOC_MACHINE(obj);
 
-    armv7m_load_kernel(ARM_CPU(first_cpu), ms->kernel_filename, MY_SOC_FLASH_SIZE);
+    g_free(mms->flash_image);
+    mms->flash_image = g_strdup(value);
+}
+
+static void mysoc_instance_init(Object *obj)
+{
+    object_property_add_str(obj, "flash-image", mysoc_get_flash_image,
+                            mysoc_set_flash_image, NULL);
+    object_property_set_description(obj, "flash-image",
+                                    "Host file backing mysoc.flash, "
+                                    "programmed in place by the guest", NULL);
 }
 
 static void mysoc_class_init(ObjectClass *oc, void *data)
@@ -87,14 +271,168 @@ static void mysoc_class_init(ObjectClass *oc, void *data)
 }
 
 static const TypeInfo mysoc_type = {
-    .name = MACHINE_TYPE_NAME("mysoc_evb"),
+    .name = TYPE_MYSOC_MACHINE,
     .parent = TYPE_MACHINE,
+    .instance_size = sizeof(MySocMachineState),
+    .instance_init = mysoc_instance_init,
     .class_init = mysoc_class_init,
 };
 
+/*
+ * mysoc_evb_mp: the same SoC with N Cortex-M4 cores.  Every core gets its
+ * own ARMv7M container (CPU + NVIC) looking at a private view
+ * of memory: its own SRAM and SRAM bit-band alias in front of an alias of
+ * the shared system bus, which carries the flash, the shared SRAM and
+ * the peripherals.  With MTTCG (the default for Arm guests on hosts with
+ * a strong enough memory model) every core runs on its own host thread.
+ * The core count comes from -smp unless num-cores overrides it, and may
+ * not exceed the -smp maximum that MTTCG registers vCPU threads against.
+ */
+static void mysoc_mp_init(MachineState *ms)
+{
+    MySocMPMachineState *mms = MYSOC_MP_MACHINE(ms);
+    MemoryRegion *system_memory = get_system_memory();
+    MemoryRegion *sram = g_new(MemoryRegion, 1);
+    DeviceState *mailbox;
+    char *name;
+    int i;
+
+    if (!mms->num_cores) {
+        mms->num_cores = ms->smp.cpus;
+    }
+    if (mms->num_cores > ms->smp.max_cpus) {
+        error_report("num-cores=%u needs -smp %u or more", mms->num_cores,
+                     mms->num_cores);
+        exit(1);
+    }
+
+    mysoc_create_flash(&mms->parent);
+
+    memory_region_init_ram(sram, NULL, "mysoc.shared_sram", MYSOC_MP_SHARED_SIZE, &error_fatal);
+    memory_region_add_subregion(system_memory, MYSOC_MP_SHARED_START, sram);
+
+    mysoc_create_bitband(system_memory, MYSOC_PERIPH_BB_ALIAS, system_memory,
+                         MYSOC_PERIPH_BB_BASE, NULL);
+
+    for (i = 0; i < mms->num_cores; i++) {
+        DeviceState *nvic;
+
+        name = g_strdup_printf("mysoc.core%d", i);
+        memory_region_init(&mms->core_mem[i], NULL, name, UINT64_MAX);
+        g_free(name);
+
+        name = g_strdup_printf("mysoc.core%d.sram", i);
+        memory_region_init_ram(&mms->core_sram[i], NULL, name,
+                               MYSOC_MP_PRIV_SRAM_SIZE, &error_fatal);
+        g_free(name);
+        memory_region_add_subregion_overlap(&mms->core_mem[i], MY_SOC_SRAM_START,
+                                            &mms->core_sram[i], 1);
+
+        name = g_strdup_printf("mysoc.core%d.shared", i);
+        memory_region_init_alias(&mms->core_shared[i], NULL, name,
+                                 system_memory, 0, UINT64_MAX);
+        g_free(name);
+        memory_region_add_subregion_overlap(&mms->core_mem[i], 0,
+                                            &mms->core_shared[i], 0);
+
+        /* The SRAM bit-band range is exactly the private SRAM */
+        mysoc_create_bitband(&mms->core_mem[i], MYSOC_SRAM_BB_ALIAS,
+                             &mms->core_sram[i], 0, &mms->core_sram[i]);
+
+        nvic = qdev_create(NULL, TYPE_ARMV7M);
+        qdev_prop_set_uint32(nvic, "num-irq", NUM_IRQ_LINES);
+        qdev_prop_set_string(nvic, "cpu-type", ms->cpu_type);
+        object_property_set_link(OBJECT(nvic), OBJECT(&mms->core_mem[i]), "memory", &error_abort);
+
+        /* This will exit with an error if the user passed us a bad cpu_type */
+        qdev_init_nofail(nvic);
+        mms->armv7m[i] = nvic;
+    }
+
+    pl011_luminary_create(PL011_UART0_START, qdev_get_gpio_in(mms->armv7m[0], PL011_UART0_IRQn), serial_hd(0));
+
+    sysbus_create_simple(TYPE_TEST_IP, MY_TEST_IP_START, qdev_get_gpio_in(mms->armv7m[0], MY_TEST_IP_IRQn));
+
+    mailbox = qdev_create(NULL, TYPE_MYSOC_MAILBOX);
+    qdev_prop_set_uint32(mailbox, "num-cores", mms->num_cores);
+    qdev_init_nofail(mailbox);
+    sysbus_mmio_map(SYS_BUS_DEVICE(mailbox), 0, MYSOC_MAILBOX_START);
+    for (i = 0; i < mms->num_cores; i++) {
+        sysbus_connect_irq(SYS_BUS_DEVICE(mailbox), i,
+                           qdev_get_gpio_in(mms->armv7m[i], MYSOC_MAILBOX_IRQn));
+    }
+
+    /* Every core boots the same image and tells itself apart via CPUID */
+    mysoc_boot(ms, ARMV7M(mms->armv7m[0])->cpu);
+    for (i = 1; i < mms->num_cores; i++) {
+        qemu_register_reset(mysoc_cpu_reset, ARMV7M(mms->armv7m[i])->cpu);
+    }
+}
+
+static void mysoc_mp_get_num_cores(Object *obj, Visitor *v, const char *name,
+                                   void *opaque, Error **errp)
+{
+    MySocMPMachineState *mms = MYSOC_MP_MACHINE(obj);
+    uint32_t value = mms->num_cores;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void mysoc_mp_set_num_cores(Object *obj, Visitor *v, const char *name,
+                                   void *opaque, Error **errp)
+{
+    MySocMPMachineState *mms = MYSOC_MP_MACHINE(obj);
+    Error *err = NULL;
+    uint32_t value;
+
+    visit_type_uint32(v, name, &value, &err);
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    if (value < 1 || value > MYSOC_MP_MAX_CORES) {
+        error_setg(errp, "num-cores must be between 1 and %d",
+                   MYSOC_MP_MAX_CORES);
+        return;
+    }
+    mms->num_cores = value;
+}
+
+static void mysoc_mp_instance_init(Object *obj)
+{
+    MySocMPMachineState *mms = MYSOC_MP_MACHINE(obj);
+
+    object_property_add(obj, "num-cores", "uint32", mysoc_mp_get_num_cores,
+                        mysoc_mp_set_num_cores, NULL, NULL, NULL);
+    object_property_set_description(obj, "num-cores",
+                                    "Number of Cortex-M4 cores, "
+                                    "default the -smp count", NULL);
+}
+
+static void mysoc_mp_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+
+    mc->desc = "My SOC with N Cortex M4 cores";
+    mc->init = mysoc_mp_init;
+    mc->ignore_memory_transaction_failures = true;
+    mc->default_cpu_type = ARM_CPU_TYPE_NAME("cortex-m4");
+    mc->default_cpus = 2;
+    mc->max_cpus = MYSOC_MP_MAX_CORES;
+}
+
+static const TypeInfo mysoc_mp_type = {
+    .name = TYPE_MYSOC_MP_MACHINE,
+    .parent = TYPE_MYSOC_MACHINE,
+    .instance_size = sizeof(MySocMPMachineState),
+    .instance_init = mysoc_mp_instance_init,
+    .class_init = mysoc_mp_class_init,
+};
+
 static void mysoc_evb_init(void)
 {
     type_register_static(&mysoc_type);
+    type_register_static(&mysoc_mp_type);
 }
 
 type_init(mysoc_evb_init)
@@ -105,10 +443,22 @@ type_init(mysoc_evb_init)
 #define TEST_IP(obj) \
     OBJECT_CHECK(my_test_ip_state, (obj), TYPE_TEST_IP)
 
+#define TEST_IP_NOP         0x20    //< RAZ/WI, MMIO round trip timing
+#define TEST_IP_DB_DELAY    0x24    //< doorbell delay, virtual ns
+#define TEST_IP_DOORBELL    0x28    //< any write raises IRQ after DB_DELAY
+#define TEST_IP_IRQ_STATUS  0x2c    //< bit0 pending, write 1 to clear
+#define TEST_IP_HOST_LO     0x30    //< host monotonic ns, reading LO latches HI
+#define TEST_IP_HOST_HI     0x34
+#define TEST_IP_IRQ_LO      0x38    //< host ns when the doorbell IRQ fired
+#define TEST_IP_IRQ_HI      0x3c
+#define TEST_IP_VIRT_LO     0x40    //< guest virtual ns, reading LO latches HI
+#define TEST_IP_VIRT_HI     0x44
+#define TEST_IP_COUNTERS    0x48    //< guest counter table dumped on exit
+#define TEST_IP_STATUS      0x4c    //< 0x7E57 << 16 | code, exits QEMU
 
 static const VMStateDescription my_test_ip_vm = {
     .name = "my_test_ip",
-    .version_id = 1,
+    .version_id = 4,
     .minimum_version_id = 1,
     .fields = (VMStateField[]) {
         VMSTATE_UINT32(id0, my_test_ip_state),
@@ -119,16 +469,47 @@ static const VMStateDescription my_test_ip_vm = {
         VMSTATE_UINT32(id5, my_test_ip_state),
         VMSTATE_UINT32(id6, my_test_ip_state),
         VMSTATE_UINT32(test_reg, my_test_ip_state),
+        VMSTATE_TIMER_PTR_V(db_timer, my_test_ip_state, 2),
+        VMSTATE_UINT32_V(db_delay, my_test_ip_state, 2),
+        VMSTATE_UINT32_V(irq_pending, my_test_ip_state, 2),
+        VMSTATE_UINT32_V(host_hi, my_test_ip_state, 2),
+        VMSTATE_INT64_V(irq_time, my_test_ip_state, 2),
+        VMSTATE_UINT32_V(counters, my_test_ip_state, 3),
+        VMSTATE_UINT32_V(virt_hi, my_test_ip_state, 4),
         VMSTATE_END_OF_LIST()
     }
 };
 
+static void my_test_ip_doorbell(void *opaque)
+{
+    my_test_ip_state *s = (my_test_ip_state *)opaque;
+
+    s->irq_time = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    s->irq_pending = 1;
+    qemu_irq_raise(s->irq);
+}
+
+/*
+ * End the run at once with the guest's code as QEMU's exit status.
+ * TEST_IP_COUNTERS may point at { uint32_t n; uint32_t value[n]; } to
+ * print first.
+ */
+static void my_test_ip_exit(my_test_ip_state *s, uint32_t status)
+{
+    if ((status >> 16) != TEST_STATUS_MAGIC) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: bad status word 0x%x\n",
+                      __func__, status);
+        return;
+    }
+    imx_test_status_exit(status & 0xff, s->counters);
+}
+
 static uint64_t my_test_ip_read(void *opaque, hwaddr offset,
                                    unsigned size)
 {
     uint64_t ret = 0;
+    int64_t now;
     my_test_ip_state *s = (my_test_ip_state *)opaque;
-    printf("%s hwaddr:%lx, size:%x\n", __func__, offset, size);
     switch (offset) {
     case 0x0:
         ret = s->id0;
@@ -154,6 +535,39 @@ static uint64_t my_test_ip_read(void *opaque, hwaddr offset,
     case 0x1c:
         ret = s->test_reg;
         break;
+    case TEST_IP_NOP:
+        break;
+    case TEST_IP_DB_DELAY:
+        ret = s->db_delay;
+        break;
+    case TEST_IP_IRQ_STATUS:
+        ret = s->irq_pending;
+        break;
+    case TEST_IP_HOST_LO:
+        now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+        s->host_hi = now >> 32;
+        ret = (uint32_t)now;
+        break;
+    case TEST_IP_VIRT_LO:
+        now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        s->virt_hi = now >> 32;
+        ret = (uint32_t)now;
+        break;
+    case TEST_IP_HOST_HI:
+        ret = s->host_hi;
+        break;
+    case TEST_IP_VIRT_HI:
+        ret = s->virt_hi;
+        break;
+    case TEST_IP_IRQ_LO:
+        ret = (uint32_t)s->irq_time;
+        break;
+    case TEST_IP_IRQ_HI:
+        ret = (uint64_t)s->irq_time >> 32;
+        break;
+    case TEST_IP_COUNTERS:
+        ret = s->counters;
+        break;
     }
     return ret;
 }
@@ -163,7 +577,6 @@ static void my_test_ip_write(void *opaque, hwaddr offset,
 {
 
     my_test_ip_state *s = (my_test_ip_state *)opaque;
-    printf("%s hwaddr:%lx, size:%x, value:%lx\n", __func__, offset, size, value);
     switch(offset){
     case 0x0:
     case 0x4:
@@ -172,11 +585,33 @@ static void my_test_ip_write(void *opaque, hwaddr offset,
     case 0x10:
     case 0x14:
     case 0x18:
-        printf("%s: cannot write the read only register\n", __func__);
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: cannot write the read only register\n", __func__);
         break;
     case 0x1c:
         s->test_reg = value;
         break;
+    case TEST_IP_NOP:
+        break;
+    case TEST_IP_DB_DELAY:
+        s->db_delay = value;
+        break;
+    case TEST_IP_DOORBELL:
+        timer_mod(s->db_timer,
+                  qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + s->db_delay);
+        break;
+    case TEST_IP_IRQ_STATUS:
+        if (value & 1) {
+            s->irq_pending = 0;
+            qemu_irq_lower(s->irq);
+        }
+        break;
+    case TEST_IP_COUNTERS:
+        s->counters = value;
+        break;
+    case TEST_IP_STATUS:
+        my_test_ip_exit(s, value);
+        break;
     }
 }
 
@@ -188,12 +623,12 @@ static const MemoryRegionOps my_test_ip_ops = {
 
 static void my_test_ip_init(Object *obj)
 {
-    printf("%s \n", __func__);
-
     my_test_ip_state *s = TEST_IP(obj);
 
     memory_region_init_io(&s->iomem, obj, &my_test_ip_ops, s, TYPE_TEST_IP, 0x1000);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    s->db_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, my_test_ip_doorbell, s);
 
     s->id0 = 0x54;
     s->id1 = 0x45;
@@ -205,10 +640,22 @@ static void my_test_ip_init(Object *obj)
     s->test_reg = 0;
 }
 
+static void my_test_ip_reset(DeviceState *dev)
+{
+    my_test_ip_state *s = TEST_IP(dev);
+
+    timer_del(s->db_timer);
+    s->db_delay = 0;
+    s->irq_pending = 0;
+    s->irq_time = 0;
+    s->counters = 0;
+    qemu_irq_lower(s->irq);
+}
+
 static void my_test_ip_class_init(ObjectClass *klass, void *data)
 {
-    printf("%s \n", __func__);
     DeviceClass *dc = DEVICE_CLASS(klass);
+    dc->reset = my_test_ip_reset;
     dc->vmsd = &my_test_ip_vm;
 }
 
@@ -222,8 +669,740 @@ static const TypeInfo my_test_ip = {
 
 static void my_test_ip_types(void)
 {
-    printf("%s \n", __func__);
     type_register_static(&my_test_ip);
 }
 
 type_init(my_test_ip_types)
+
+
+/* Inter-core mailbox for mysoc_evb_mp */
+
+#define MYSOC_MAILBOX(obj) \
+    OBJECT_CHECK(mysoc_mailbox_state, (obj), TYPE_MYSOC_MAILBOX)
+
+#define MBOX_CPUID          0x0
+#define MBOX_NUM_CORES      0x4
+#define MBOX_INBOX_BASE     0x100
+#define MBOX_INBOX_DATA     0x0     //< write posts, read pops
+#define MBOX_INBOX_STATUS   0x4     //< FULL, OVF (w1c), sender
+#define MBOX_INBOX_DB_SET   0x8     //< doorbell bits, write 1 to set
+#define MBOX_INBOX_DB_CLR   0xc     //< doorbell bits, write 1 to clear
+
+#define MBOX_STATUS_FULL    (1 << 0)
+#define MBOX_STATUS_OVF     (1 << 1)
+
+static const VMStateDescription mysoc_mailbox_vm = {
+    .name = TYPE_MYSOC_MAILBOX,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(data, mysoc_mailbox_state, MYSOC_MP_MAX_CORES),
+        VMSTATE_UINT32_ARRAY(status, mysoc_mailbox_state, MYSOC_MP_MAX_CORES),
+        VMSTATE_UINT32_ARRAY(doorbell, mysoc_mailbox_state, MYSOC_MP_MAX_CORES),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static uint32_t mysoc_mailbox_cpuid(void)
+{
+    return current_cpu ? current_cpu->cpu_index : 0;
+}
+
+static void mysoc_mailbox_update(mysoc_mailbox_state *s, int core)
+{
+    qemu_set_irq(s->irq[core], (s->status[core] & MBOX_STATUS_FULL) ||
+                               s->doorbell[core]);
+}
+
+static uint64_t mysoc_mailbox_read(void *opaque, hwaddr offset,
+                                   unsigned size)
+{
+    mysoc_mailbox_state *s = (mysoc_mailbox_state *)opaque;
+    uint64_t ret = 0;
+    int core;
+
+    if (offset == MBOX_CPUID) {
+        return mysoc_mailbox_cpuid();
+    } else if (offset == MBOX_NUM_CORES) {
+        return s->num_cores;
+    } else if (offset < MBOX_INBOX_BASE) {
+        return 0;
+    }
+
+    core = (offset - MBOX_INBOX_BASE) / 0x10;
+    if (core >= s->num_cores) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: no core %d\n", __func__, core);
+        return 0;
+    }
+
+    switch (offset & 0xf) {
+    case MBOX_INBOX_DATA:
+        ret = s->data[core];
+        s->status[core] &= ~MBOX_STATUS_FULL;
+        mysoc_mailbox_update(s, core);
+        break;
+    case MBOX_INBOX_STATUS:
+        ret = s->status[core];
+        break;
+    case MBOX_INBOX_DB_SET:
+    case MBOX_INBOX_DB_CLR:
+        ret = s->doorbell[core];
+        break;
+    }
+    return ret;
+}
+
+static void mysoc_mailbox_write(void *opaque, hwaddr offset,
+                                uint64_t value, unsigned size)
+{
+    mysoc_mailbox_state *s = (mysoc_mailbox_state *)opaque;
+    int core;
+
+    if (offset < MBOX_INBOX_BASE) {
+        return;
+    }
+
+    core = (offset - MBOX_INBOX_BASE) / 0x10;
+    if (core >= s->num_cores) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: no core %d\n", __func__, core);
+        return;
+    }
+
+    switch (offset & 0xf) {
+    case MBOX_INBOX_DATA:
+        if (s->status[core] & MBOX_STATUS_FULL) {
+            s->status[core] |= MBOX_STATUS_OVF;
+            break;
+        }
+        s->data[core] = value;
+        s->status[core] = (s->status[core] & MBOX_STATUS_OVF) |
+                          MBOX_STATUS_FULL | (mysoc_mailbox_cpuid() << 8);
+        break;
+    case MBOX_INBOX_STATUS:
+        s->status[core] &= ~(value & MBOX_STATUS_OVF);
+        break;
+    case MBOX_INBOX_DB_SET:
+        s->doorbell[core] |= value;
+        break;
+    case MBOX_INBOX_DB_CLR:
+        s->doorbell[core] &= ~value;
+        break;
+    }
+    mysoc_mailbox_update(s, core);
+}
+
+static const MemoryRegionOps mysoc_mailbox_ops = {
+    .read = mysoc_mailbox_read,
+    .write = mysoc_mailbox_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static void mysoc_mailbox_init(Object *obj)
+{
+    mysoc_mailbox_state *s = MYSOC_MAILBOX(obj);
+
+    memory_region_init_io(&s->iomem, obj, &mysoc_mailbox_ops, s, TYPE_MYSOC_MAILBOX, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+}
+
+static void mysoc_mailbox_realize(DeviceState *dev, Error **errp)
+{
+    mysoc_mailbox_state *s = MYSOC_MAILBOX(dev);
+    int i;
+
+    if (s->num_cores < 1 || s->num_cores > MYSOC_MP_MAX_CORES) {
+        error_setg(errp, "%s: bad num-cores %u", TYPE_MYSOC_MAILBOX,
+                   s->num_cores);
+        return;
+    }
+    for (i = 0; i < s->num_cores; i++) {
+        sysbus_init_irq(SYS_BUS_DEVICE(dev), &s->irq[i]);
+    }
+}
+
+static void mysoc_mailbox_reset(DeviceState *dev)
+{
+    mysoc_mailbox_state *s = MYSOC_MAILBOX(dev);
+    int i;
+
+    for (i = 0; i < s->num_cores; i++) {
+        s->data[i] = 0;
+        s->status[i] = 0;
+        s->doorbell[i] = 0;
+        mysoc_mailbox_update(s, i);
+    }
+}
+
+static Property mysoc_mailbox_properties[] = {
+    DEFINE_PROP_UINT32("num-cores", mysoc_mailbox_state, num_cores, 1),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void mysoc_mailbox_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = mysoc_mailbox_realize;
+    dc->reset = mysoc_mailbox_reset;
+    dc->props = mysoc_mailbox_properties;
+    dc->vmsd = &mysoc_mailbox_vm;
+}
+
+static const TypeInfo mysoc_mailbox = {
+    .name          = TYPE_MYSOC_MAILBOX,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(mysoc_mailbox_state),
+    .instance_init = mysoc_mailbox_init,
+    .class_init    = mysoc_mailbox_class_init,
+};
+
+static void mysoc_mailbox_types(void)
+{
+    type_register_static(&mysoc_mailbox);
+}
+
+type_init(mysoc_mailbox_types)
+
+
+/*
+ * Flash controller for mysoc.flash
+ *
+ * The array is a romd region: reads and instruction fetches go straight
+ * to RAM and only writes trap into mysoc_flash_array_write().  Programming
+ * goes through address_space_write_rom(), which invalidates just the TBs
+ * on the pages that changed.  With an image file the array is mirrored in
+ * a shared mapping of the file, msync'd whenever the guest moves on to
+ * another erase block, erases, or locks the controller.
+ */
+
+#define MYSOC_FLASH(obj) \
+    OBJECT_CHECK(mysoc_flash_state, (obj), TYPE_MYSOC_FLASH)
+
+#define FLASH_KEYR          0x04
+#define FLASH_SR            0x0c
+#define FLASH_CR            0x10
+#define FLASH_AR            0x14
+
+#define FLASH_KEY1          0x45670123
+#define FLASH_KEY2          0xCDEF89AB
+
+#define FLASH_SR_BSY        (1 << 0)
+#define FLASH_SR_PGERR      (1 << 2)
+#define FLASH_SR_WRPRTERR   (1 << 4)
+#define FLASH_SR_EOP        (1 << 5)
+
+#define FLASH_CR_PG         (1 << 0)
+#define FLASH_CR_PER        (1 << 1)
+#define FLASH_CR_MER        (1 << 2)
+#define FLASH_CR_STRT       (1 << 6)
+#define FLASH_CR_LOCK       (1 << 7)
+
+static const VMStateDescription mysoc_flash_vm = {
+    .name = TYPE_MYSOC_FLASH,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(key_state, mysoc_flash_state),
+        VMSTATE_UINT32(sr, mysoc_flash_state),
+        VMSTATE_UINT32(cr, mysoc_flash_state),
+        VMSTATE_UINT32(ar, mysoc_flash_state),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void mysoc_flash_sync(mysoc_flash_state *s)
+{
+    uintptr_t page = qemu_real_host_page_size;
+    int64_t start;
+
+    if (!s->backing || s->dirty_end <= s->dirty_start) {
+        return;
+    }
+    start = QEMU_ALIGN_DOWN(s->dirty_start, page);
+    if (msync(s->backing + start, s->dirty_end - start, MS_SYNC) < 0) {
+        qemu_log_mask(LOG_UNIMP, "%s: msync failed: %s\n",
+                      __func__, strerror(errno));
+    }
+    s->dirty_start = s->dirty_end = 0;
+}
+
+/* Batch msync per erase block: flush when the guest moves to another */
+static void mysoc_flash_mark_dirty(mysoc_flash_state *s, uint32_t offset,
+                                   uint32_t len)
+{
+    if (!s->backing) {
+        return;
+    }
+    if (s->dirty_end > s->dirty_start &&
+        (s->dirty_start / s->sector_size != offset / s->sector_size ||
+         (offset + len - 1) / s->sector_size != offset / s->sector_size)) {
+        mysoc_flash_sync(s);
+    }
+    if (s->dirty_end <= s->dirty_start) {
+        s->dirty_start = offset;
+        s->dirty_end = offset + len;
+    } else {
+        s->dirty_start = MIN(s->dirty_start, offset);
+        s->dirty_end = MAX(s->dirty_end, offset + len);
+    }
+}
+
+static void mysoc_flash_store(mysoc_flash_state *s, uint32_t offset,
+                              const uint8_t *buf, uint32_t len)
+{
+    address_space_write_rom(&address_space_memory, s->base + offset,
+                            MEMTXATTRS_UNSPECIFIED, buf, len);
+    if (s->backing) {
+        memcpy(s->backing + offset, buf, len);
+        mysoc_flash_mark_dirty(s, offset, len);
+    }
+}
+
+static void mysoc_flash_erase(mysoc_flash_state *s, uint32_t offset,
+                              uint32_t len)
+{
+    uint8_t *buf = g_malloc(len);
+
+    memset(buf, 0xff, len);
+    mysoc_flash_store(s, offset, buf, len);
+    g_free(buf);
+    mysoc_flash_sync(s);
+}
+
+static uint64_t mysoc_flash_array_read(void *opaque, hwaddr offset,
+                                       unsigned size)
+{
+    mysoc_flash_state *s = (mysoc_flash_state *)opaque;
+
+    return ldn_le_p((uint8_t *)memory_region_get_ram_ptr(&s->array) + offset,
+                    size);
+}
+
+/* Programming can only clear bits, like real NOR */
+static void mysoc_flash_array_write(void *opaque, hwaddr offset,
+                                    uint64_t value, unsigned size)
+{
+    mysoc_flash_state *s = (mysoc_flash_state *)opaque;
+    uint8_t *ram = memory_region_get_ram_ptr(&s->array);
+    uint8_t buf[8];
+    int i;
+
+    if (s->cr & FLASH_CR_LOCK || !(s->cr & FLASH_CR_PG)) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: write to 0x%" HWADDR_PRIx " while not programming\n",
+                      __func__, offset);
+        s->sr |= FLASH_SR_WRPRTERR;
+        return;
+    }
+
+    stn_le_p(buf, size, value);
+    for (i = 0; i < size; i++) {
+        if (buf[i] & ~ram[offset + i]) {
+            s->sr |= FLASH_SR_PGERR;
+        }
+        buf[i] &= ram[offset + i];
+    }
+    mysoc_flash_store(s, offset, buf, size);
+    s->sr |= FLASH_SR_EOP;
+}
+
+static const MemoryRegionOps mysoc_flash_array_ops = {
+    .read = mysoc_flash_array_read,
+    .write = mysoc_flash_array_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 4,
+};
+
+static void mysoc_flash_start(mysoc_flash_state *s)
+{
+    if (s->cr & FLASH_CR_MER) {
+        mysoc_flash_erase(s, 0, s->size);
+    } else if (s->cr & FLASH_CR_PER) {
+        if (s->ar - s->base >= s->size) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: bad erase address 0x%x\n",
+                          __func__, s->ar);
+            s->sr |= FLASH_SR_PGERR;
+            return;
+        }
+        mysoc_flash_erase(s, QEMU_ALIGN_DOWN(s->ar - s->base, s->sector_size),
+                          s->sector_size);
+    } else {
+        return;
+    }
+    s->sr |= FLASH_SR_EOP;
+}
+
+static uint64_t mysoc_flash_read(void *opaque, hwaddr offset,
+                                 unsigned size)
+{
+    mysoc_flash_state *s = (mysoc_flash_state *)opaque;
+
+    switch (offset) {
+    case FLASH_SR:
+        return s->sr;
+    case FLASH_CR:
+        return s->cr;
+    case FLASH_AR:
+        return s->ar;
+    }
+    return 0;
+}
+
+static void mysoc_flash_write(void *opaque, hwaddr offset,
+                              uint64_t value, unsigned size)
+{
+    mysoc_flash_state *s = (mysoc_flash_state *)opaque;
+
+    switch (offset) {
+    case FLASH_KEYR:
+        if (s->key_state == 0 && value == FLASH_KEY1) {
+            s->key_state = 1;
+        } else if (s->key_state == 1 && value == FLASH_KEY2) {
+            s->key_state = 0;
+            s->cr &= ~FLASH_CR_LOCK;
+        } else {
+            /* A wrong sequence locks the controller until reset */
+            s->key_state = 2;
+        }
+        break;
+    case FLASH_SR:
+        s->sr &= ~(value & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR | FLASH_SR_EOP));
+        break;
+    case FLASH_CR:
+        if (s->cr & FLASH_CR_LOCK) {
+            s->sr |= FLASH_SR_WRPRTERR;
+            break;
+        }
+        s->cr = value & (FLASH_CR_PG | FLASH_CR_PER | FLASH_CR_MER |
+                         FLASH_CR_LOCK);
+        if (s->cr & FLASH_CR_LOCK) {
+            mysoc_flash_sync(s);
+        } else if (value & FLASH_CR_STRT) {
+            mysoc_flash_start(s);
+        }
+        break;
+    case FLASH_AR:
+        s->ar = value;
+        break;
+    }
+}
+
+static const MemoryRegionOps mysoc_flash_ops = {
+    .read = mysoc_flash_read,
+    .write = mysoc_flash_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static void mysoc_flash_init(Object *obj)
+{
+    mysoc_flash_state *s = MYSOC_FLASH(obj);
+
+    memory_region_init_io(&s->iomem, obj, &mysoc_flash_ops, s,
+                          TYPE_MYSOC_FLASH, 0x1000);
+}
+
+static void mysoc_flash_open_image(mysoc_flash_state *s, Error **errp)
+{
+    struct stat st;
+    off_t len;
+    void *p;
+    int fd;
+
+    fd = qemu_open(s->image, O_RDWR | O_CREAT | O_BINARY, 0644);
+    if (fd < 0) {
+        error_setg_errno(errp, errno, "%s: cannot open %s",
+                         TYPE_MYSOC_FLASH, s->image);
+        return;
+    }
+    if (fstat(fd, &st) < 0) {
+        error_setg_errno(errp, errno, "%s: cannot stat %s",
+                         TYPE_MYSOC_FLASH, s->image);
+        goto out;
+    }
+    len = st.st_size;
+    if (len < s->size && ftruncate(fd, s->size) < 0) {
+        error_setg_errno(errp, errno, "%s: cannot extend %s",
+                         TYPE_MYSOC_FLASH, s->image);
+        goto out;
+    }
+
+    p = mmap(NULL, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        error_setg_errno(errp, errno, "%s: cannot map %s",
+                         TYPE_MYSOC_FLASH, s->image);
+        goto out;
+    }
+    s->backing = p;
+
+    /* A new or short image reads back as erased flash */
+    if (len < s->size) {
+        memset(s->backing + len, 0xff, s->size - len);
+        s->dirty_start = len;
+        s->dirty_end = s->size;
+        mysoc_flash_sync(s);
+    }
+out:
+    qemu_close(fd);
+}
+
+static void mysoc_flash_realize(DeviceState *dev, Error **errp)
+{
+    mysoc_flash_state *s = MYSOC_FLASH(dev);
+    Error *err = NULL;
+    uint8_t *ram;
+
+    if (!s->size || !s->sector_size || s->size % s->sector_size) {
+        error_setg(errp, "%s: size must be a multiple of sector-size",
+                   TYPE_MYSOC_FLASH);
+        return;
+    }
+
+    memory_region_init_rom_device(&s->array, OBJECT(dev),
+                                  &mysoc_flash_array_ops, s, "mysoc.flash",
+                                  s->size, &err);
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    ram = memory_region_get_ram_ptr(&s->array);
+
+    if (s->image) {
+        mysoc_flash_open_image(s, &err);
+        if (err) {
+            error_propagate(errp, err);
+            return;
+        }
+        memcpy(ram, s->backing, s->size);
+    } else {
+        memset(ram, 0xff, s->size);
+    }
+
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->array);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->iomem);
+}
+
+static void mysoc_flash_reset(DeviceState *dev)
+{
+    mysoc_flash_state *s = MYSOC_FLASH(dev);
+
+    mysoc_flash_sync(s);
+    s->key_state = 0;
+    s->sr = 0;
+    s->cr = FLASH_CR_LOCK;
+    s->ar = 0;
+}
+
+static Property mysoc_flash_properties[] = {
+    DEFINE_PROP_STRING("image", mysoc_flash_state, image),
+    DEFINE_PROP_UINT32("base", mysoc_flash_state, base, 0),
+    DEFINE_PROP_UINT32("size", mysoc_flash_state, size, MY_SOC_FLASH_SIZE),
+    DEFINE_PROP_UINT32("sector-size", mysoc_flash_state, sector_size,
+                       MY_SOC_FLASH_SECTOR),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void mysoc_flash_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = mysoc_flash_realize;
+    dc->reset = mysoc_flash_reset;
+    dc->props = mysoc_flash_properties;
+    dc->vmsd = &mysoc_flash_vm;
+}
+
+static const TypeInfo mysoc_flash = {
+    .name          = TYPE_MYSOC_FLASH,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(mysoc_flash_state),
+    .instance_init = mysoc_flash_init,
+    .class_init    = mysoc_flash_class_init,
+};
+
+static void mysoc_flash_types(void)
+{
+    type_register_static(&mysoc_flash);
+}
+
+type_init(mysoc_flash_types)
+
+
+/*
+ * Bit-band alias regions for mysoc_evb
+ *
+ * Replaces the ARMv7M "enable-bitband" regions.  When the bit lives in
+ * RAM the alias sets or clears it with an atomic op on host memory, so
+ * the access needs neither the BQL nor a trip through the address space.
+ * A write updates the byte first and then, like a normal RAM store,
+ * invalidates any TBs on the page whose DIRTY_MEMORY_CODE bit is clean.
+ * Anything else (the peripheral alias) does the byte read-modify-write
+ * through the address space like armv7m.c.
+ */
+
+#define MYSOC_BITBAND(obj) \
+    OBJECT_CHECK(mysoc_bitband_state, (obj), TYPE_MYSOC_BITBAND)
+
+static inline hwaddr mysoc_bitband_byte(hwaddr offset)
+{
+    return offset >> 5;
+}
+
+static inline unsigned mysoc_bitband_bit(hwaddr offset)
+{
+    return (offset >> 2) & 7;
+}
+
+static uint8_t *mysoc_bitband_host(mysoc_bitband_state *s, hwaddr byte)
+{
+    if (!s->ram || byte >= memory_region_size(s->ram)) {
+        return NULL;
+    }
+    return (uint8_t *)memory_region_get_ram_ptr(s->ram) + byte;
+}
+
+static MemTxResult mysoc_bitband_slow(mysoc_bitband_state *s, hwaddr byte,
+                                      unsigned bit, uint64_t *data,
+                                      bool is_write, MemTxAttrs attrs)
+{
+    bool take_bql = !qemu_mutex_iothread_locked();
+    MemTxResult res;
+    uint8_t buf;
+
+    /* The fast alias runs without the BQL, the source might not */
+    if (take_bql) {
+        qemu_mutex_lock_iothread();
+    }
+    res = address_space_read(&s->source_as, s->base + byte, attrs, &buf, 1);
+    if (res == MEMTX_OK) {
+        if (is_write) {
+            buf = deposit32(buf, bit, 1, *data & 1);
+            res = address_space_write(&s->source_as, s->base + byte, attrs,
+                                      &buf, 1);
+        } else {
+            *data = (buf >> bit) & 1;
+        }
+    }
+    if (take_bql) {
+        qemu_mutex_unlock_iothread();
+    }
+    return res;
+}
+
+static MemTxResult mysoc_bitband_read(void *opaque, hwaddr offset,
+                                      uint64_t *data, unsigned size,
+                                      MemTxAttrs attrs)
+{
+    mysoc_bitband_state *s = (mysoc_bitband_state *)opaque;
+    hwaddr byte = mysoc_bitband_byte(offset);
+    unsigned bit = mysoc_bitband_bit(offset);
+    uint8_t *p = mysoc_bitband_host(s, byte);
+
+    if (p) {
+        *data = (atomic_read(p) >> bit) & 1;
+        return MEMTX_OK;
+    }
+    return mysoc_bitband_slow(s, byte, bit, data, false, attrs);
+}
+
+static MemTxResult mysoc_bitband_write(void *opaque, hwaddr offset,
+                                       uint64_t value, unsigned size,
+                                       MemTxAttrs attrs)
+{
+    mysoc_bitband_state *s = (mysoc_bitband_state *)opaque;
+    hwaddr byte = mysoc_bitband_byte(offset);
+    unsigned bit = mysoc_bitband_bit(offset);
+    uint8_t *p = mysoc_bitband_host(s, byte);
+    ram_addr_t addr;
+    uint8_t mask;
+
+    if (!p) {
+        return mysoc_bitband_slow(s, byte, bit, &value, true, attrs);
+    }
+    addr = memory_region_get_ram_addr(s->ram) + byte;
+    mask = memory_region_get_dirty_log_mask(s->ram);
+
+    if (value & 1) {
+        atomic_or(p, 1 << bit);
+    } else {
+        atomic_and(p, ~(1 << bit));
+    }
+    /*
+     * As invalidate_and_set_dirty() in exec.c, checked after the store: a
+     * TB translated from here on already sees the new value, one
+     * translated before it is invalidated.  A clean DIRTY_MEMORY_CODE bit
+     * means the page has TBs; it is left for the TB code to manage.
+     */
+    if ((mask & (1 << DIRTY_MEMORY_CODE)) &&
+        !cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_CODE)) {
+        tb_invalidate_phys_addr(&s->source_as, s->base + byte, attrs);
+    }
+    cpu_physical_memory_set_dirty_range(addr, 1,
+                                        mask & ~(1 << DIRTY_MEMORY_CODE));
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps mysoc_bitband_ops = {
+    .read_with_attrs = mysoc_bitband_read,
+    .write_with_attrs = mysoc_bitband_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .impl.min_access_size = 1,
+    .impl.max_access_size = 4,
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 4,
+};
+
+static void mysoc_bitband_init(Object *obj)
+{
+    mysoc_bitband_state *s = MYSOC_BITBAND(obj);
+
+    memory_region_init_io(&s->iomem, obj, &mysoc_bitband_ops, s,
+                          TYPE_MYSOC_BITBAND, MYSOC_BB_ALIAS_SIZE);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->iomem);
+}
+
+static void mysoc_bitband_realize(DeviceState *dev, Error **errp)
+{
+    mysoc_bitband_state *s = MYSOC_BITBAND(dev);
+
+    if (!s->source_memory) {
+        error_setg(errp, "%s: source-memory not set", TYPE_MYSOC_BITBAND);
+        return;
+    }
+    address_space_init(&s->source_as, s->source_memory, "bitband-source");
+    if (s->ram) {
+        memory_region_clear_global_locking(&s->iomem);
+    }
+}
+
+static Property mysoc_bitband_properties[] = {
+    DEFINE_PROP_UINT32("base", mysoc_bitband_state, base, 0),
+    DEFINE_PROP_LINK("source-memory", mysoc_bitband_state, source_memory,
+                     TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_LINK("ram", mysoc_bitband_state, ram,
+                     TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void mysoc_bitband_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = mysoc_bitband_realize;
+    dc->props = mysoc_bitband_properties;
+}
+
+static const TypeInfo mysoc_bitband = {
+    .name          = TYPE_MYSOC_BITBAND,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(mysoc_bitband_state),
+    .instance_init = mysoc_bitband_init,
+    .class_init    = mysoc_bitband_class_init,
+};
+
+static void mysoc_bitband_types(void)
+{
+    type_register_static(&mysoc_bitband);
+}
+
+type_init(mysoc_bitband_types)